@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+
+#include <editor/BrickOctree.h>
+#include <editor/Mesher.h>
+
+#include "Chambers.h"
+
+namespace {
+
+/// Edit cells of the chamber the rubble is sculpted on
+constexpr int DETAILED_CELLS = 16;
+
+void detailArgs(benchmark::internal::Benchmark* benchmark) {
+	// Half the width of the rubble patch in units
+	benchmark->ArgName("detail")->Arg(128)->Arg(512);
+}
+
+} // namespace
+
+// Bricks store the rubble densely and cull the faces between its voxels with bitmasks before the greedy merge
+template<typename Tree>
+static void BM_Detailed_mesh(benchmark::State& state) {
+	const auto chamber = getDetailedChamber<Tree>(DETAILED_CELLS, static_cast<int>(state.range(0)));
+	std::size_t quads = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		const auto mesh = Mesher::mesh(chamber);
+		quads = mesh.quads.size();
+		benchmark::DoNotOptimize(mesh.quads.data());
+	}
+	state.counters["bytes"] = static_cast<double>(chamber.memoryUsage());
+	state.counters["nodes"] = static_cast<double>(chamber.nodeCount());
+	state.counters["quads"] = static_cast<double>(quads);
+}
+BENCHMARK_TEMPLATE(BM_Detailed_mesh, ChamberOctree)->Apply(detailArgs)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Detailed_mesh, BrickOctree<VoxelData>)->Apply(detailArgs)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+#include "Chambers.h"
+
+namespace {
+
+std::filesystem::path getBenchPath() {
+	return std::filesystem::temp_directory_path() / "puzzlemaker_ce_bench.pzce";
+}
+
+std::int64_t getLeafCount(const ChamberOctree& chamber) {
+	std::int64_t leaves = 0;
+	chamber.forEachLeaf([&leaves](const ChamberOctree::Node&, Vec3i, int) {
+		leaves++;
+	});
+	return leaves;
+}
+
+} // namespace
+
+static void BM_ChamberFile_write(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber(static_cast<int>(state.range(0)));
+	std::size_t bytes = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		std::ostringstream stream;
+		benchmark::DoNotOptimize(ChamberFile::write(chamber, stream));
+		bytes = stream.str().size();
+		benchmark::DoNotOptimize(bytes);
+	}
+	state.SetItemsProcessed(state.iterations() * getLeafCount(chamber));
+	state.counters["fileBytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_ChamberFile_write)->Arg(64)->Arg(192)->Unit(benchmark::kMillisecond);
+
+static void BM_ChamberFile_read(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber(static_cast<int>(state.range(0)));
+	std::ostringstream stream;
+	if (!ChamberFile::write(chamber, stream)) {
+		state.SkipWithError("Unable to write the chamber");
+		return;
+	}
+	const auto data = stream.str();
+	ChamberOctree loaded(MAX_CHAMBER_SIZE);
+	for ([[maybe_unused]] auto _ : state) {
+		benchmark::DoNotOptimize(ChamberFile::read(loaded, {reinterpret_cast<const std::byte*>(data.data()), data.size()}));
+	}
+	state.SetItemsProcessed(state.iterations() * getLeafCount(chamber));
+}
+BENCHMARK(BM_ChamberFile_read)->Arg(64)->Arg(192)->Unit(benchmark::kMillisecond);
+
+static void BM_ChamberFile_save(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber(static_cast<int>(state.range(0)));
+	for ([[maybe_unused]] auto _ : state) {
+		benchmark::DoNotOptimize(ChamberFile::save(chamber, getBenchPath()));
+	}
+	state.SetItemsProcessed(state.iterations() * getLeafCount(chamber));
+	std::filesystem::remove(getBenchPath());
+}
+BENCHMARK(BM_ChamberFile_save)->Arg(64)->Arg(128)->Arg(192)->Unit(benchmark::kMillisecond);
+
+static void BM_ChamberFile_load(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber(static_cast<int>(state.range(0)));
+	if (!ChamberFile::save(chamber, getBenchPath())) {
+		state.SkipWithError("Unable to write the chamber");
+		return;
+	}
+	ChamberOctree loaded(MAX_CHAMBER_SIZE);
+	for ([[maybe_unused]] auto _ : state) {
+		benchmark::DoNotOptimize(ChamberFile::load(loaded, getBenchPath()));
+	}
+	state.SetItemsProcessed(state.iterations() * getLeafCount(chamber));
+	std::filesystem::remove(getBenchPath());
+}
+BENCHMARK(BM_ChamberFile_load)->Arg(64)->Arg(192)->Unit(benchmark::kMillisecond);
+
+// Saving a chamber and opening it again, as a user reopening their work would
+static void BM_ChamberFile_roundTrip(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber(static_cast<int>(state.range(0)));
+	ChamberOctree loaded(MAX_CHAMBER_SIZE);
+	for ([[maybe_unused]] auto _ : state) {
+		if (!ChamberFile::save(chamber, getBenchPath()) || !ChamberFile::load(loaded, getBenchPath())) {
+			state.SkipWithError("Unable to save and load the chamber");
+			break;
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * getLeafCount(chamber));
+	std::filesystem::remove(getBenchPath());
+}
+BENCHMARK(BM_ChamberFile_roundTrip)->Arg(64)->Arg(128)->Arg(192)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+#include <string_view>
+
+#include <editor/World.h>
+
+/// Voxel data of a texture. The palette of a benchmark never fills up
+inline VoxelData getVoxelData(std::string_view texture) {
+	return VoxelData::fromTexture(texture).value();
+}
+
+inline AABB getCellBox(Vec3i min, Vec3i max) {
+	return {
+		{min.x * DEFAULT_RESOLUTION, min.y * DEFAULT_RESOLUTION, min.z * DEFAULT_RESOLUTION},
+		{max.x * DEFAULT_RESOLUTION, max.y * DEFAULT_RESOLUTION, max.z * DEFAULT_RESOLUTION},
+	};
+}
+
+/// Build a solid block of edit cells carved into rooms and corridors, with scattered pillars. Works on anything
+/// with fill and clear, a tree or a whole world
+template<typename T>
+void buildSyntheticChamber(T& chamber, int cells) {
+	const int half = cells * DEFAULT_RESOLUTION / 2;
+	chamber.fill({{-half, -half / 2, -half}, {half, half / 2, half}}, getVoxelData("wall"));
+
+	std::mt19937 random{1};
+	std::uniform_int_distribution<int> position{-cells / 2 + 1, cells / 2 - 9};
+	std::uniform_int_distribution<int> size{3, 8};
+	for (int i = 0; i < cells * cells / 16; i++) {
+		const Vec3i min{position(random), position(random) / 2, position(random)};
+		const Vec3i max{min.x + size(random), min.y + size(random) / 2, min.z + size(random)};
+		chamber.clear(getCellBox(min, max));
+		const Vec3i pillar{min.x + 1, min.y, min.z + 1};
+		chamber.fill(getCellBox(pillar, {pillar.x + 1, max.y, pillar.z + 1}), getVoxelData(i % 2 ? "pillar" : "glass"));
+	}
+}
+
+template<typename Tree = ChamberOctree>
+Tree getSyntheticChamber(int cells) {
+	Tree chamber(MAX_CHAMBER_SIZE);
+	buildSyntheticChamber(chamber, cells);
+	return chamber;
+}
+
+/// The synthetic chamber with rubble sculpted in unit voxels on top of it, from -detail to detail along x and z.
+/// Heights and materials change from one column to the next, the worst case for nodes
+template<typename T>
+void buildDetailedChamber(T& chamber, int cells, int detail) {
+	buildSyntheticChamber(chamber, cells);
+	const int top = cells * DEFAULT_RESOLUTION / 4;
+	const VoxelData materials[3]{getVoxelData("wall"), getVoxelData("pillar"), getVoxelData("glass")};
+	std::mt19937 random{2};
+	std::uniform_int_distribution<int> jitter{-1, 1};
+	std::uniform_int_distribution<int> material{0, 2};
+	for (int x = -detail; x < detail; x += 2) {
+		for (int z = -detail; z < detail; z += 2) {
+			const auto height = 4 + static_cast<int>(2.f * std::sin(static_cast<float>(x) / 18.f) + 2.f * std::cos(static_cast<float>(z) / 14.f)) + jitter(random);
+			chamber.fill({{x, top, z}, {x + 2, top + height * 2, z + 2}}, materials[material(random)]);
+		}
+	}
+}
+
+template<typename Tree = ChamberOctree>
+Tree getDetailedChamber(int cells, int detail) {
+	Tree chamber(MAX_CHAMBER_SIZE);
+	buildDetailedChamber(chamber, cells, detail);
+	return chamber;
+}
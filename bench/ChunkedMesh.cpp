@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+#include "Chambers.h"
+
+namespace {
+
+void threadArgs(benchmark::internal::Benchmark* benchmark) {
+	for (int cells : {64, 192}) {
+		for (int threads = 1; threads < static_cast<int>(std::thread::hardware_concurrency()); threads *= 2) {
+			benchmark->Args({cells, threads});
+		}
+		benchmark->Args({cells, static_cast<int>(std::thread::hardware_concurrency())});
+	}
+}
+
+} // namespace
+
+static void BM_ChunkedMesh_update(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber(static_cast<int>(state.range(0)));
+	ThreadPool pool(static_cast<unsigned>(state.range(1)));
+	for ([[maybe_unused]] auto _ : state) {
+		ChunkedMesh<ChamberOctree> mesh(MAX_CHAMBER_SIZE, MAX_CHAMBER_SIZE >> DEFAULT_MESH_SPLIT_DEPTH);
+		mesh.invalidate({{-MAX_CHAMBER_SIZE / 2, -MAX_CHAMBER_SIZE / 2, -MAX_CHAMBER_SIZE / 2}, {MAX_CHAMBER_SIZE / 2, MAX_CHAMBER_SIZE / 2, MAX_CHAMBER_SIZE / 2}});
+		benchmark::DoNotOptimize(mesh.update(chamber, &pool));
+	}
+	state.counters["threads"] = static_cast<double>(pool.threadCount());
+}
+BENCHMARK(BM_ChunkedMesh_update)->Apply(threadArgs)->UseRealTime()->Unit(benchmark::kMillisecond);
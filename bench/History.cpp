@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+
+#include "Chambers.h"
+
+namespace {
+
+/// Undo steps recorded per run
+constexpr int STEPS = 64;
+
+/// Record STEPS edits as undo steps, reporting the memory each step keeps alive against a full copy of the chamber
+template<typename Edit>
+void benchmarkHistory(benchmark::State& state, Edit&& edit) {
+	for ([[maybe_unused]] auto _ : state) {
+		state.PauseTiming();
+		auto chamber = getSyntheticChamber(static_cast<int>(state.range(0)));
+		History<ChamberOctree> history(DEFAULT_HISTORY_MEMORY_BUDGET);
+		history.reset(chamber);
+		state.ResumeTiming();
+
+		for (int i = 0; i < STEPS; i++) {
+			edit(chamber, i);
+			history.commit(chamber);
+		}
+
+		state.PauseTiming();
+		state.counters["bytesPerStep"] = static_cast<double>(history.memoryUsage()) / STEPS;
+		state.counters["copyBytes"] = static_cast<double>(chamber.nodeCount() * sizeof(ChamberOctree::Node));
+		history.clear(chamber);
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * STEPS);
+}
+
+} // namespace
+
+static void BM_History_set(benchmark::State& state) {
+	const auto data = getVoxelData("dev/dev_measurewall01a");
+	benchmarkHistory(state, [&data](ChamberOctree& chamber, int i) {
+		benchmark::DoNotOptimize(chamber.set({(i % 8) * 2 + 1, 1, (i / 8) * 2 + 1}, data));
+	});
+}
+BENCHMARK(BM_History_set)->Arg(64)->Arg(128)->Arg(192)->Unit(benchmark::kMicrosecond);
+
+// A room of 8x4x8 edit cells carved out per step
+static void BM_History_room(benchmark::State& state) {
+	benchmarkHistory(state, [](ChamberOctree& chamber, int i) {
+		const Vec3i min{(i % 8) * 8 - 32, -2, (i / 8) * 8 - 32};
+		chamber.clear(getCellBox(min, {min.x + 8, min.y + 4, min.z + 8}));
+	});
+}
+BENCHMARK(BM_History_room)->Arg(64)->Arg(128)->Arg(192)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,40 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+
+#include "Chambers.h"
+
+namespace {
+
+/// Edits made between two saves
+constexpr int EDITS_PER_SAVE = 64;
+
+std::filesystem::path getBenchPath() {
+	return std::filesystem::temp_directory_path() / "puzzlemaker_ce_bench_journal.pzce";
+}
+
+} // namespace
+
+// Saving through the journal only writes the edits, compare with BM_ChamberFile_save for the same chambers
+static void BM_Journal_save(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber(static_cast<int>(state.range(0)));
+	const auto base = ChamberFile::save(chamber, getBenchPath()) ? ChamberFile::readChecksum(getBenchPath()) : std::nullopt;
+	Journal<VoxelData> journal;
+	if (!base || !journal.rebase(Journal<VoxelData>::getPath(getBenchPath()), *base, 0)) {
+		state.SkipWithError("Unable to write the chamber");
+		return;
+	}
+	const auto data = getVoxelData("dev/dev_measurewall01a");
+	int edit = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		for (int i = 0; i < EDITS_PER_SAVE; i++, edit++) {
+			journal.recordSet({(edit % 97) * 2 + 1, 1, (edit / 97 % 97) * 2 + 1}, data);
+		}
+		benchmark::DoNotOptimize(journal.flush(true));
+	}
+	state.SetItemsProcessed(state.iterations() * EDITS_PER_SAVE);
+	state.counters["journalBytes"] = static_cast<double>(journal.size());
+	std::filesystem::remove(getBenchPath());
+	std::filesystem::remove(Journal<VoxelData>::getPath(getBenchPath()));
+}
+BENCHMARK(BM_Journal_save)->Arg(64)->Arg(128)->Arg(192)->Unit(benchmark::kMicrosecond);
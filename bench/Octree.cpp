@@ -0,0 +1,284 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <editor/LinearOctree.h>
+#include <editor/Octree.h>
+#include <editor/World.h>
+
+#include "Chambers.h"
+
+namespace {
+
+/// Order in which positions are visited by the access benchmarks
+enum class Access {
+	/// Uniformly spread over the chamber
+	RANDOM,
+	/// Bursts of nearby cells, like a brush stroke
+	CLUSTERED,
+	/// Sorted along the Z-order curve, each visit is close to the previous one in memory
+	MORTON,
+};
+
+/// Edit cells visited per iteration of the access benchmarks
+constexpr int ACCESS_COUNT = 4096;
+/// Width in edit cells of the chamber the access benchmarks run on
+constexpr int ACCESS_CELLS = 64;
+
+/// Centers of edit cells inside the synthetic chamber, in the given order
+std::vector<Vec3i> getAccessPositions(Access access) {
+	std::mt19937 random{2};
+	std::uniform_int_distribution<int> coordinate{-ACCESS_CELLS / 2, ACCESS_CELLS / 2 - 1};
+	std::vector<Vec3i> cells;
+	cells.reserve(ACCESS_COUNT);
+	if (access == Access::CLUSTERED) {
+		std::uniform_int_distribution<int> offset{-3, 3};
+		while (cells.size() < ACCESS_COUNT) {
+			const Vec3i center{coordinate(random), coordinate(random) / 2, coordinate(random)};
+			for (int i = 0; i < 64; i++) {
+				cells.push_back({
+					std::clamp(center.x + offset(random), -ACCESS_CELLS / 2, ACCESS_CELLS / 2 - 1),
+					std::clamp(center.y + offset(random), -ACCESS_CELLS / 4, ACCESS_CELLS / 4 - 1),
+					std::clamp(center.z + offset(random), -ACCESS_CELLS / 2, ACCESS_CELLS / 2 - 1),
+				});
+			}
+		}
+	} else {
+		for (int i = 0; i < ACCESS_COUNT; i++) {
+			cells.push_back({coordinate(random), coordinate(random) / 2, coordinate(random)});
+		}
+	}
+	if (access == Access::MORTON) {
+		const auto getCode = [](Vec3i cell) {
+			return LinearOctree<VoxelData>::encode({cell.x + ACCESS_CELLS / 2, cell.y + ACCESS_CELLS / 2, cell.z + ACCESS_CELLS / 2});
+		};
+		std::sort(cells.begin(), cells.end(), [&getCode](Vec3i lhs, Vec3i rhs) {
+			return getCode(lhs) < getCode(rhs);
+		});
+	}
+	std::vector<Vec3i> positions;
+	positions.reserve(cells.size());
+	for (const auto& cell : cells) {
+		positions.push_back({cell.x * DEFAULT_RESOLUTION + DEFAULT_RESOLUTION / 2, cell.y * DEFAULT_RESOLUTION + DEFAULT_RESOLUTION / 2, cell.z * DEFAULT_RESOLUTION + DEFAULT_RESOLUTION / 2});
+	}
+	return positions;
+}
+
+void accessArgs(benchmark::internal::Benchmark* benchmark) {
+	benchmark->ArgName("access")->Arg(static_cast<int>(Access::RANDOM))->Arg(static_cast<int>(Access::CLUSTERED))->Arg(static_cast<int>(Access::MORTON));
+}
+
+/// A box of edit cells, offset from the chamber corner so it does not line up with large nodes
+AABB getCellBox(Vec3i cells) {
+	constexpr int min = -MAX_CHAMBER_SIZE / 2 + 3 * DEFAULT_RESOLUTION;
+	return {{min, min, min}, {min + cells.x * DEFAULT_RESOLUTION, min + cells.y * DEFAULT_RESOLUTION, min + cells.z * DEFAULT_RESOLUTION}};
+}
+
+void fillArgs(benchmark::internal::Benchmark* benchmark) {
+	// Room and chamber sized boxes
+	benchmark->Args({8, 6, 4})->Args({64, 48, 32});
+}
+
+} // namespace
+
+static void BM_Octree_fill(benchmark::State& state) {
+	const auto box = getCellBox({static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), static_cast<int>(state.range(2))});
+	for ([[maybe_unused]] auto _ : state) {
+		Octree<int> octree(MAX_CHAMBER_SIZE);
+		octree.fill(box, 1);
+		benchmark::DoNotOptimize(octree.nodeCount());
+	}
+}
+BENCHMARK(BM_Octree_fill)->Apply(fillArgs);
+
+static void BM_Octree_fillWithSet(benchmark::State& state) {
+	const auto box = getCellBox({static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), static_cast<int>(state.range(2))});
+	for ([[maybe_unused]] auto _ : state) {
+		Octree<int> octree(MAX_CHAMBER_SIZE);
+		for (int x = box.min.x + DEFAULT_RESOLUTION / 2; x < box.max.x; x += DEFAULT_RESOLUTION) {
+			for (int y = box.min.y + DEFAULT_RESOLUTION / 2; y < box.max.y; y += DEFAULT_RESOLUTION) {
+				for (int z = box.min.z + DEFAULT_RESOLUTION / 2; z < box.max.z; z += DEFAULT_RESOLUTION) {
+					benchmark::DoNotOptimize(octree.set({x, y, z}, 1));
+				}
+			}
+		}
+		benchmark::DoNotOptimize(octree.nodeCount());
+	}
+}
+BENCHMARK(BM_Octree_fillWithSet)->Apply(fillArgs);
+
+static void BM_LinearOctree_fill(benchmark::State& state) {
+	const auto box = getCellBox({static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), static_cast<int>(state.range(2))});
+	for ([[maybe_unused]] auto _ : state) {
+		LinearOctree<int> octree(MAX_CHAMBER_SIZE);
+		octree.fill(box, 1);
+		benchmark::DoNotOptimize(octree.nodeCount());
+	}
+}
+BENCHMARK(BM_LinearOctree_fill)->Apply(fillArgs);
+
+static void BM_LinearOctree_fillWithSet(benchmark::State& state) {
+	const auto box = getCellBox({static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), static_cast<int>(state.range(2))});
+	for ([[maybe_unused]] auto _ : state) {
+		LinearOctree<int> octree(MAX_CHAMBER_SIZE);
+		for (int x = box.min.x + DEFAULT_RESOLUTION / 2; x < box.max.x; x += DEFAULT_RESOLUTION) {
+			for (int y = box.min.y + DEFAULT_RESOLUTION / 2; y < box.max.y; y += DEFAULT_RESOLUTION) {
+				for (int z = box.min.z + DEFAULT_RESOLUTION / 2; z < box.max.z; z += DEFAULT_RESOLUTION) {
+					benchmark::DoNotOptimize(octree.set({x, y, z}, 1));
+				}
+			}
+		}
+		benchmark::DoNotOptimize(octree.nodeCount());
+	}
+}
+BENCHMARK(BM_LinearOctree_fillWithSet)->Apply(fillArgs);
+
+// Every set compares the voxel data of the siblings to see if they can merge
+static void BM_Octree_fillWithSetMaterial(benchmark::State& state) {
+	const auto box = getCellBox({static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), static_cast<int>(state.range(2))});
+	const auto data = getVoxelData("dev/dev_measurewall01a");
+	for ([[maybe_unused]] auto _ : state) {
+		Octree<VoxelData> octree(MAX_CHAMBER_SIZE);
+		for (int x = box.min.x + DEFAULT_RESOLUTION / 2; x < box.max.x; x += DEFAULT_RESOLUTION) {
+			for (int y = box.min.y + DEFAULT_RESOLUTION / 2; y < box.max.y; y += DEFAULT_RESOLUTION) {
+				for (int z = box.min.z + DEFAULT_RESOLUTION / 2; z < box.max.z; z += DEFAULT_RESOLUTION) {
+					benchmark::DoNotOptimize(octree.set({x, y, z}, data));
+				}
+			}
+		}
+		state.counters["nodeBytes"] = sizeof(Octree<VoxelData>::Node);
+		benchmark::DoNotOptimize(octree.nodeCount());
+	}
+}
+BENCHMARK(BM_Octree_fillWithSetMaterial)->Apply(fillArgs);
+
+template<typename Tree>
+static void BM_Access_set(benchmark::State& state) {
+	const auto positions = getAccessPositions(static_cast<Access>(state.range(0)));
+	auto chamber = getSyntheticChamber<Tree>(ACCESS_CELLS);
+	const VoxelData data[2]{getVoxelData("dev/dev_measurewall01a"), getVoxelData("dev/dev_measuregeneric01")};
+	int pass = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		// Alternate the data so every set changes the chamber
+		for (const auto& position : positions) {
+			benchmark::DoNotOptimize(chamber.set(position, data[pass % 2]));
+		}
+		pass++;
+	}
+	state.SetItemsProcessed(state.iterations() * ACCESS_COUNT);
+}
+BENCHMARK_TEMPLATE(BM_Access_set, Octree<VoxelData>)->Apply(accessArgs);
+BENCHMARK_TEMPLATE(BM_Access_set, Octree<VoxelData, MAX_CHAMBER_DEPTH>)->Apply(accessArgs);
+BENCHMARK_TEMPLATE(BM_Access_set, LinearOctree<VoxelData>)->Apply(accessArgs);
+
+template<typename Tree>
+static void BM_Access_get(benchmark::State& state) {
+	const auto positions = getAccessPositions(static_cast<Access>(state.range(0)));
+	const auto chamber = getSyntheticChamber<Tree>(ACCESS_CELLS);
+	for ([[maybe_unused]] auto _ : state) {
+		for (const auto& position : positions) {
+			benchmark::DoNotOptimize(chamber.get(position));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * ACCESS_COUNT);
+}
+BENCHMARK_TEMPLATE(BM_Access_get, Octree<VoxelData>)->Apply(accessArgs);
+BENCHMARK_TEMPLATE(BM_Access_get, Octree<VoxelData, MAX_CHAMBER_DEPTH>)->Apply(accessArgs);
+BENCHMARK_TEMPLATE(BM_Access_get, LinearOctree<VoxelData>)->Apply(accessArgs);
+
+template<typename Tree>
+static void BM_Access_exists(benchmark::State& state) {
+	const auto positions = getAccessPositions(static_cast<Access>(state.range(0)));
+	const auto chamber = getSyntheticChamber<Tree>(ACCESS_CELLS);
+	for ([[maybe_unused]] auto _ : state) {
+		for (const auto& position : positions) {
+			benchmark::DoNotOptimize(chamber.exists(position));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * ACCESS_COUNT);
+}
+BENCHMARK_TEMPLATE(BM_Access_exists, Octree<VoxelData>)->Apply(accessArgs);
+BENCHMARK_TEMPLATE(BM_Access_exists, Octree<VoxelData, MAX_CHAMBER_DEPTH>)->Apply(accessArgs);
+BENCHMARK_TEMPLATE(BM_Access_exists, LinearOctree<VoxelData>)->Apply(accessArgs);
+
+// The batch queries against the loops over get and exists above
+static void BM_Access_getBatch(benchmark::State& state) {
+	const auto positions = getAccessPositions(static_cast<Access>(state.range(0)));
+	const auto chamber = getSyntheticChamber<Octree<VoxelData>>(ACCESS_CELLS);
+	std::vector<const Octree<VoxelData>::Node*> nodes(positions.size());
+	for ([[maybe_unused]] auto _ : state) {
+		chamber.getBatch(positions, nodes);
+		benchmark::DoNotOptimize(nodes.data());
+	}
+	state.SetItemsProcessed(state.iterations() * ACCESS_COUNT);
+}
+BENCHMARK(BM_Access_getBatch)->Apply(accessArgs);
+
+static void BM_Access_existsBatch(benchmark::State& state) {
+	const auto positions = getAccessPositions(static_cast<Access>(state.range(0)));
+	const auto chamber = getSyntheticChamber<Octree<VoxelData>>(ACCESS_CELLS);
+	const auto exists = std::make_unique<bool[]>(positions.size());
+	for ([[maybe_unused]] auto _ : state) {
+		chamber.existsBatch(positions, {exists.get(), positions.size()});
+		benchmark::DoNotOptimize(exists.get());
+	}
+	state.SetItemsProcessed(state.iterations() * ACCESS_COUNT);
+}
+BENCHMARK(BM_Access_existsBatch)->Apply(accessArgs);
+
+static void BM_Octree_leaves(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber<Octree<VoxelData>>(static_cast<int>(state.range(0)));
+	std::int64_t leaves = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		chamber.forEachLeaf([&leaves](const Octree<VoxelData>::Node& node, Vec3i, int halfSize) {
+			leaves += halfSize;
+			benchmark::DoNotOptimize(node.data());
+		});
+	}
+	benchmark::DoNotOptimize(leaves);
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(chamber.nodeCount()));
+}
+BENCHMARK(BM_Octree_leaves)->ArgName("cells")->Arg(32)->Arg(128);
+
+static void BM_Octree_leafIterator(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber<Octree<VoxelData>>(static_cast<int>(state.range(0)));
+	std::int64_t leaves = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		for (const auto& [node, position, halfSize] : chamber.leaves()) {
+			leaves += halfSize;
+			benchmark::DoNotOptimize(node.data());
+		}
+	}
+	benchmark::DoNotOptimize(leaves);
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(chamber.nodeCount()));
+}
+BENCHMARK(BM_Octree_leafIterator)->ArgName("cells")->Arg(32)->Arg(128);
+
+static void BM_Octree_leavesInBox(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber<Octree<VoxelData>>(128);
+	// From one chunk of the mesher to a large selection
+	const auto cells = static_cast<int>(state.range(0));
+	const auto box = getCellBox(Vec3i{-cells / 2, -cells / 2, -cells / 2}, Vec3i{cells / 2, cells / 2, cells / 2});
+	for ([[maybe_unused]] auto _ : state) {
+		chamber.forEachLeaf(box, [](const Octree<VoxelData>::Node& node, Vec3i, int) {
+			benchmark::DoNotOptimize(node.data());
+		});
+	}
+}
+BENCHMARK(BM_Octree_leavesInBox)->ArgName("cells")->Arg(4)->Arg(32);
+
+static void BM_Octree_occupancy(benchmark::State& state) {
+	const auto chamber = getSyntheticChamber<Octree<VoxelData>>(128);
+	// Off the node grid, so every level has nodes crossing the boundary
+	const auto cells = static_cast<int>(state.range(0));
+	auto box = getCellBox(Vec3i{-cells / 2, -cells / 2, -cells / 2}, Vec3i{cells / 2, cells / 2, cells / 2});
+	box.min = {box.min.x + 3, box.min.y + 3, box.min.z + 3};
+	for ([[maybe_unused]] auto _ : state) {
+		benchmark::DoNotOptimize(chamber.occupancy(box));
+	}
+}
+BENCHMARK(BM_Octree_occupancy)->ArgName("cells")->Arg(4)->Arg(32)->Arg(128);
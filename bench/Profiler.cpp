@@ -0,0 +1,13 @@
+#include <benchmark/benchmark.h>
+
+#include <editor/Profiler.h>
+
+// The cost of one zone, compare with an empty loop to see what the clock reads take
+static void BM_Profiler_zone(benchmark::State& state) {
+	Profiler profiler;
+	for ([[maybe_unused]] auto _ : state) {
+		const Profiler::Zone zone("zone", profiler);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Profiler_zone)->ThreadRange(1, 4);
@@ -0,0 +1,157 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <editor/LinearOctree.h>
+
+#include "Chambers.h"
+
+namespace {
+
+constexpr int ROOM_CELLS = 64;
+constexpr int RAYS_PER_FRAME = 4096;
+
+/// One large room inside a solid shell, with scattered pillars and platforms
+template<typename Tree>
+Tree getPickingChamber() {
+	Tree chamber(MAX_CHAMBER_SIZE);
+	constexpr int half = ROOM_CELLS / 2;
+	chamber.fill(getCellBox({-half - 2, -half / 2 - 2, -half - 2}, {half + 2, half / 2 + 2, half + 2}), getVoxelData("wall"));
+	chamber.clear(getCellBox({-half, -half / 2, -half}, {half, half / 2, half}));
+
+	std::mt19937 random{3};
+	std::uniform_int_distribution<int> position{-half, half - 4};
+	std::uniform_int_distribution<int> size{1, 4};
+	for (int i = 0; i < ROOM_CELLS; i++) {
+		const Vec3i min{position(random), -half / 2, position(random)};
+		const Vec3i max{min.x + size(random), min.y + size(random) * 4, min.z + size(random)};
+		chamber.fill(getCellBox(min, max), getVoxelData(i % 2 ? "pillar" : "platform"));
+	}
+	return chamber;
+}
+
+/// Rays from open space inside the room in any direction, or from a camera circling outside the chamber
+template<typename Tree>
+std::vector<Ray> getPickingRays(const Tree& chamber, bool orbit) {
+	constexpr float half = ROOM_CELLS * DEFAULT_RESOLUTION / 2.f;
+	std::mt19937 random{2};
+	std::uniform_real_distribution<float> coordinate{-half, half};
+	std::uniform_real_distribution<float> angle{0.f, 6.2831853f};
+	std::normal_distribution<float> direction;
+	std::vector<Ray> rays;
+	while (rays.size() < RAYS_PER_FRAME) {
+		Vec3f origin{coordinate(random), coordinate(random) / 2.f, coordinate(random)};
+		Vec3f dir{direction(random), direction(random), direction(random)};
+		if (orbit) {
+			// Aim at a random point of the room from 3 room widths away
+			const auto theta = angle(random);
+			const Vec3f camera{std::cos(theta) * half * 6.f, half * 2.f, std::sin(theta) * half * 6.f};
+			dir = origin - camera;
+			origin = camera;
+		} else if (const auto* leaf = chamber.get({static_cast<int>(origin.x), static_cast<int>(origin.y), static_cast<int>(origin.z)}); !leaf || !(leaf->data() == VoxelData{})) {
+			continue;
+		}
+		const auto length = std::sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+		rays.push_back({origin, {dir.x / length, dir.y / length, dir.z / length}, static_cast<float>(MAX_CHAMBER_SIZE)});
+	}
+	return rays;
+}
+
+void rayArgs(benchmark::internal::Benchmark* benchmark) {
+	benchmark->ArgName("orbit")->Arg(0)->Arg(1);
+}
+
+/// The naive alternative, stepping from edit cell to edit cell and looking each one up
+bool marchRay(const ChamberOctree& chamber, const Ray& ray) {
+	constexpr float infinity = std::numeric_limits<float>::infinity();
+	const float cellSize = DEFAULT_RESOLUTION;
+
+	// Start where the ray enters the world, stepping from far outside it would only make this slower
+	constexpr int worldHalfSize = MAX_CHAMBER_SIZE / 2;
+	const auto world = ray.intersect({{-worldHalfSize, -worldHalfSize, -worldHalfSize}, {worldHalfSize, worldHalfSize, worldHalfSize}});
+	if (!world.isHit() || world.exit < 0.f) {
+		return false;
+	}
+	const float start = std::max(world.enter, 0.f) + 0.5f;
+	const float origin[3]{ray.origin.x + ray.direction.x * start, ray.origin.y + ray.direction.y * start, ray.origin.z + ray.direction.z * start};
+	const float direction[3]{ray.direction.x, ray.direction.y, ray.direction.z};
+	int cell[3], step[3];
+	float next[3], delta[3];
+	for (int axis = 0; axis < 3; axis++) {
+		cell[axis] = static_cast<int>(std::floor(origin[axis] / cellSize));
+		step[axis] = direction[axis] < 0.f ? -1 : 1;
+		delta[axis] = direction[axis] == 0.f ? infinity : cellSize / std::abs(direction[axis]);
+		const float boundary = static_cast<float>(cell[axis] + (step[axis] > 0)) * cellSize;
+		next[axis] = direction[axis] == 0.f ? infinity : (boundary - origin[axis]) / direction[axis];
+	}
+	float distance = start;
+	while (distance <= ray.maxDistance) {
+		const Vec3i center{cell[0] * DEFAULT_RESOLUTION + DEFAULT_RESOLUTION / 2, cell[1] * DEFAULT_RESOLUTION + DEFAULT_RESOLUTION / 2, cell[2] * DEFAULT_RESOLUTION + DEFAULT_RESOLUTION / 2};
+		const auto* leaf = chamber.get(center);
+		if (!leaf) {
+			return false;
+		}
+		if (!(leaf->data() == VoxelData{})) {
+			return true;
+		}
+		const int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+		distance = start + next[axis];
+		next[axis] += delta[axis];
+		cell[axis] += step[axis];
+	}
+	return false;
+}
+
+} // namespace
+
+static void BM_Octree_raycast(benchmark::State& state) {
+	const auto chamber = getPickingChamber<Octree<VoxelData>>();
+	const auto rays = getPickingRays(chamber, state.range(0));
+	for ([[maybe_unused]] auto _ : state) {
+		for (const auto& ray : rays) {
+			benchmark::DoNotOptimize(chamber.raycast(ray));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * RAYS_PER_FRAME);
+}
+BENCHMARK(BM_Octree_raycast)->Apply(rayArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_Octree_raycastBatch(benchmark::State& state) {
+	const auto chamber = getPickingChamber<Octree<VoxelData>>();
+	const auto rays = getPickingRays(chamber, state.range(0));
+	ThreadPool pool;
+	for ([[maybe_unused]] auto _ : state) {
+		benchmark::DoNotOptimize(chamber.raycast(rays, &pool));
+	}
+	state.SetItemsProcessed(state.iterations() * RAYS_PER_FRAME);
+	state.counters["threads"] = static_cast<double>(pool.threadCount());
+}
+BENCHMARK(BM_Octree_raycastBatch)->Apply(rayArgs)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_LinearOctree_raycast(benchmark::State& state) {
+	const auto chamber = getPickingChamber<LinearOctree<VoxelData>>();
+	const auto rays = getPickingRays(chamber, state.range(0));
+	for ([[maybe_unused]] auto _ : state) {
+		for (const auto& ray : rays) {
+			benchmark::DoNotOptimize(chamber.raycast(ray));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * RAYS_PER_FRAME);
+}
+BENCHMARK(BM_LinearOctree_raycast)->Apply(rayArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_Octree_raycastCellMarch(benchmark::State& state) {
+	const auto chamber = getPickingChamber<ChamberOctree>();
+	const auto rays = getPickingRays(chamber, state.range(0));
+	for ([[maybe_unused]] auto _ : state) {
+		for (const auto& ray : rays) {
+			benchmark::DoNotOptimize(marchRay(chamber, ray));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * RAYS_PER_FRAME);
+}
+BENCHMARK(BM_Octree_raycastCellMarch)->Apply(rayArgs)->Unit(benchmark::kMillisecond);
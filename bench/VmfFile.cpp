@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <sstream>
+
+#include "Chambers.h"
+
+// Reports the brush count before merging, one per solid leaf, and after
+static void BM_VmfFile_brushes(benchmark::State& state) {
+	const auto solids = VmfFile::getSolids(getSyntheticChamber(static_cast<int>(state.range(0))));
+	std::size_t brushes = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		const auto merged = VmfFile::getBrushes(solids);
+		brushes = merged.size();
+		benchmark::DoNotOptimize(merged.data());
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(solids.size()));
+	state.counters["leaves"] = static_cast<double>(solids.size());
+	state.counters["brushes"] = static_cast<double>(brushes);
+}
+BENCHMARK(BM_VmfFile_brushes)->Arg(64)->Arg(192)->Unit(benchmark::kMillisecond);
+
+static void BM_VmfFile_write(benchmark::State& state) {
+	const auto brushes = VmfFile::getBrushes(VmfFile::getSolids(getSyntheticChamber(static_cast<int>(state.range(0)))));
+	std::size_t bytes = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		std::ostringstream stream;
+		benchmark::DoNotOptimize(VmfFile::write(brushes, stream));
+		bytes = stream.str().size();
+		benchmark::DoNotOptimize(bytes);
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(brushes.size()));
+	state.counters["fileBytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_VmfFile_write)->Arg(64)->Arg(192)->Unit(benchmark::kMillisecond);
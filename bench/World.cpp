@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <vector>
+
+#include <editor/Frustum.h>
+
+#include "Chambers.h"
+
+namespace {
+
+/// Column-major projection * view of a 90 degree camera at the eye, looking down -z
+std::array<float, 16> getViewProjection(Vec3f eye, float near, float far) {
+	std::array<float, 16> matrix{};
+	matrix[0] = 1.f;
+	matrix[5] = 1.f;
+	matrix[10] = -(far + near) / (far - near);
+	matrix[11] = -1.f;
+	matrix[14] = -2.f * far * near / (far - near);
+	const std::array<float, 3> translation{-eye.x, -eye.y, -eye.z};
+	for (int row = 0; row < 4; row++) {
+		for (int column = 0; column < 3; column++) {
+			matrix[12 + row] += matrix[column * 4 + row] * translation[column];
+		}
+	}
+	return matrix;
+}
+
+} // namespace
+
+// The CPU side of a frame in the editor: one edit, remeshing what it touched, then culling the chunks.
+// The camera stands at the edge of the chamber looking across it
+static void BM_World_frame(benchmark::State& state) {
+	const int cells = static_cast<int>(state.range(0));
+	World world;
+	buildSyntheticChamber(world, cells);
+	world.update();
+
+	const Vec3f eye{0.f, 0.f, static_cast<float>(cells * DEFAULT_RESOLUTION / 2)};
+	const auto viewProjection = getViewProjection(eye, 1.f, static_cast<float>(MAX_CHAMBER_SIZE));
+	const auto frustum = Frustum::fromMatrix(viewProjection.data());
+	std::vector<ChunkedMesh<ChamberOctree>::Draw> draws;
+	ChunkedMesh<ChamberOctree>::CullStats stats;
+
+	const VoxelData data[2]{getVoxelData("dev/dev_measurewall01a"), getVoxelData("dev/dev_measuregeneric01")};
+	int frame = 0;
+	for ([[maybe_unused]] auto _ : state) {
+		benchmark::DoNotOptimize(world.set({DEFAULT_RESOLUTION / 2, DEFAULT_RESOLUTION / 2, DEFAULT_RESOLUTION / 2}, data[frame++ % 2]));
+		world.update();
+		stats = world.getMesh().cull(frustum, eye, DEFAULT_LOD_DISTANCE, draws);
+		benchmark::DoNotOptimize(draws.data());
+	}
+	state.counters["chunks"] = static_cast<double>(world.getMesh().chunkCount());
+	state.counters["drawnChunks"] = static_cast<double>(stats.drawnChunks);
+	state.counters["drawnTriangles"] = static_cast<double>(stats.drawnTriangles);
+}
+BENCHMARK(BM_World_frame)->Arg(32)->Arg(64)->Arg(128)->Arg(192)->UseRealTime()->Unit(benchmark::kMillisecond);
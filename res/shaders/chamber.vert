@@ -1,9 +1,11 @@
 #version 150
 
-attribute vec3 vPos;
-attribute vec2 vUV;
+in vec3 vPos;
+// Bits 0-2: face direction (axis * 2 + positive), bits 8-31: material index
+in uint vAttributes;
 
 uniform mat4 uMVP;
+uniform float uTextureSize;
 
 out float fDepth;
 out vec2 fUVMesh;
@@ -11,7 +13,11 @@ out vec2 fUVMesh;
 void main() {
     vec4 position = uMVP * vec4(vPos, 1.0);
     gl_Position = position;
-    fUVMesh = vUV;
+
+    // Faces span the two axes following their normal axis
+    uint axis = (vAttributes & 7u) >> 1u;
+    vec2 uv = axis == 0u ? vPos.yz : (axis == 1u ? vPos.zx : vPos.xy);
+    fUVMesh = uv / uTextureSize;
 
     // Unused right now
     fDepth = position.w;
@@ -21,6 +21,14 @@ void Options::setupOptions(QSettings& options) {
         options.setValue(OPT_START_MAXIMIZED, false);
     }
 
+    if (!options.contains(OPT_AUTOSAVE)) {
+        options.setValue(OPT_AUTOSAVE, true);
+    }
+
+    if (!options.contains(OPT_SHOW_FRAME_STATS)) {
+        options.setValue(OPT_SHOW_FRAME_STATS, false);
+    }
+
 	opts = &options;
 }
 
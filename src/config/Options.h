@@ -6,6 +6,8 @@
 
 constexpr std::string_view OPT_STYLE = "style";
 constexpr std::string_view OPT_START_MAXIMIZED = "start_maximized";
+constexpr std::string_view OPT_AUTOSAVE = "autosave";
+constexpr std::string_view OPT_SHOW_FRAME_STATS = "show_frame_stats";
 
 namespace Options {
 
@@ -1,4 +1,5 @@
 #include <memory>
+#include <string_view>
 
 #include <QApplication>
 #include <QSettings>
@@ -6,9 +7,18 @@
 
 #include "../config/Config.h"
 #include "../config/Options.h"
+#include "RenderBenchmark.h"
+#include "VmfExport.h"
 #include "Window.h"
 
 int main(int argc, char** argv) {
+    // Export a chamber before anything needs a display
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view{argv[i]} == VmfExport::FLAG) {
+            return VmfExport::run(argc, argv);
+        }
+    }
+
 	QSurfaceFormat format;
 	format.setDepthBufferSize(24);
 	format.setSamples(4);
@@ -24,6 +34,11 @@ int main(int argc, char** argv) {
     QGuiApplication::setDesktopFileName(PUZZLEMAKER_CE_PROJECT_NAME);
 #endif
 
+    // Time rendering a chamber offscreen instead of opening the editor
+    if (QApplication::arguments().contains(RenderBenchmark::FLAG)) {
+        return RenderBenchmark::run(QApplication::arguments());
+    }
+
     std::unique_ptr<QSettings> options;
     if (Options::isStandalone()) {
         auto configPath = QApplication::applicationDirPath() + "/config.ini";
@@ -0,0 +1,246 @@
+#include "RenderBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <numbers>
+#include <numeric>
+#include <optional>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QSurfaceFormat>
+
+#include "../editor/ChamberRenderer.h"
+#include "../editor/World.h"
+
+namespace {
+
+constexpr int DEFAULT_FRAME_COUNT = 240;
+constexpr auto DEFAULT_SIZE = "1280x720";
+/// Full turns the camera makes around the chamber over the run
+constexpr int ORBIT_COUNT = 2;
+/// Frames between edits, each one makes the next frame remesh and upload the chunks around the center of the chamber
+constexpr int EDIT_INTERVAL = 15;
+
+struct Frame {
+    ChamberRenderer::FrameTimes times;
+    /// Waiting for the GPU to finish drawing the frame
+    float finish = 0.f;
+    std::size_t drawnTriangles = 0;
+};
+
+[[nodiscard]] float getMillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printError(const QString& message) {
+    std::fprintf(stderr, "%s\n", qPrintable(message));
+}
+
+/// The box around every solid leaf, or nothing if the chamber is empty
+[[nodiscard]] std::optional<AABB> getSolidBounds(const ChamberOctree& chamber) {
+    std::optional<AABB> bounds;
+    chamber.forEachLeaf([&bounds](const ChamberOctree::Node& node, Vec3i position, int halfSize) {
+        if (node.data() == VoxelData{}) {
+            return;
+        }
+        const auto box = AABB::fromNode(position, halfSize);
+        if (!bounds) {
+            bounds = box;
+            return;
+        }
+        bounds->min = {std::min(bounds->min.x, box.min.x), std::min(bounds->min.y, box.min.y), std::min(bounds->min.z, box.min.z)};
+        bounds->max = {std::max(bounds->max.x, box.max.x), std::max(bounds->max.y, box.max.y), std::max(bounds->max.z, box.max.z)};
+    });
+    return bounds;
+}
+
+/// The camera of a frame orbits the center of the box, moving in and out of it and tilting up and down as it goes
+[[nodiscard]] QMatrix4x4 getView(const AABB& bounds, int frame, int frameCount) {
+    const QVector3D center(
+        static_cast<float>(bounds.min.x + bounds.max.x) / 2.f,
+        static_cast<float>(bounds.min.y + bounds.max.y) / 2.f,
+        static_cast<float>(bounds.min.z + bounds.max.z) / 2.f);
+    const auto extent = static_cast<float>(std::max({bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z}));
+    const auto progress = static_cast<float>(frame) / static_cast<float>(frameCount);
+    const auto angle = progress * ORBIT_COUNT * 2.f * std::numbers::pi_v<float>;
+    const auto distance = extent * (0.9f + 0.5f * std::cos(angle * 1.5f));
+    const auto height = extent * 0.4f * std::sin(angle * 0.5f);
+
+    QMatrix4x4 view;
+    view.lookAt(center + QVector3D(std::cos(angle) * distance, height, std::sin(angle) * distance), center, {0.f, 1.f, 0.f});
+    return view;
+}
+
+/// Mean, median, 95th percentile and maximum
+[[nodiscard]] QJsonObject summarize(std::vector<float> values) {
+    if (values.empty()) {
+        return {};
+    }
+    std::sort(values.begin(), values.end());
+    const auto at = [&values](float fraction) {
+        return values[static_cast<std::size_t>(fraction * static_cast<float>(values.size() - 1))];
+    };
+    return {
+        {"mean", std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size())},
+        {"median", at(0.5f)},
+        {"p95", at(0.95f)},
+        {"max", values.back()},
+    };
+}
+
+} // namespace
+
+int RenderBenchmark::run(const QStringList& arguments) {
+    QCommandLineParser parser;
+    const QCommandLineOption benchOption(QString(FLAG).mid(2), "Render a chamber offscreen and write the frame times as JSON.");
+    const QCommandLineOption framesOption("frames", "Frames to render.", "count", QString::number(DEFAULT_FRAME_COUNT));
+    const QCommandLineOption sizeOption("size", "Size of the framebuffer.", "WxH", DEFAULT_SIZE);
+    const QCommandLineOption outputOption("output", "Where to write the results, standard output if not given.", "path");
+    parser.addOptions({benchOption, framesOption, sizeOption, outputOption});
+    parser.addPositionalArgument("chamber", "The chamber file to render.");
+    if (!parser.parse(arguments) || parser.positionalArguments().size() != 1) {
+        printError(parser.errorText().isEmpty() ? parser.helpText() : parser.errorText());
+        return 2;
+    }
+
+    bool valid = false;
+    const auto frameCount = parser.value(framesOption).toInt(&valid);
+    const auto size = parser.value(sizeOption).split('x');
+    bool validWidth = false, validHeight = false;
+    const auto width = size.size() == 2 ? size[0].toInt(&validWidth) : 0;
+    const auto height = size.size() == 2 ? size[1].toInt(&validHeight) : 0;
+    if (!valid || frameCount <= 0 || !validWidth || !validHeight || width <= 0 || height <= 0) {
+        printError("Expected a positive frame count and a size like " + QString(DEFAULT_SIZE));
+        return 2;
+    }
+
+    // Read the chamber file alone, the benchmark must not touch its journal
+    const auto chamberPath = parser.positionalArguments()[0];
+    ChamberOctree chamber(MAX_CHAMBER_SIZE);
+    if (!ChamberFile::load(chamber, std::filesystem::path{chamberPath.toStdU16String()})) {
+        printError("Unable to load " + chamberPath);
+        return 1;
+    }
+    const auto bounds = getSolidBounds(chamber);
+    if (!bounds) {
+        printError(chamberPath + " is empty");
+        return 1;
+    }
+    const auto editData = VoxelData::fromTexture("dev/dev_measuregeneric01");
+    if (!editData) {
+        printError("The material palette is full");
+        return 1;
+    }
+    World world;
+    world.setChamber(std::move(chamber));
+
+    QSurfaceFormat format;
+    format.setVersion(3, 2);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    // Declared in this order so the GL objects are destroyed while the context is current, and the context before its surface
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!surface.isValid() || !context.create() || !context.makeCurrent(&surface)) {
+        printError("Unable to create an offscreen OpenGL context");
+        return 1;
+    }
+    ChamberRenderer renderer;
+    if (!renderer.initialize()) {
+        printError("Unable to initialize OpenGL 3.2 Core context");
+        return 1;
+    }
+    QOpenGLFramebufferObject framebuffer(width, height, QOpenGLFramebufferObject::Attachment::Depth);
+    framebuffer.bind();
+    auto* gl = context.functions();
+    gl->glViewport(0, 0, width, height);
+
+    QMatrix4x4 projection;
+    projection.perspective(30.f, static_cast<float>(width) / static_cast<float>(height), 0.015f, 32768.0f);
+
+    // Edits toggle a solid edit cell at the center of the chamber
+    const Vec3i editCell{
+        (bounds->min.x + bounds->max.x) / 2 / DEFAULT_RESOLUTION * DEFAULT_RESOLUTION,
+        (bounds->min.y + bounds->max.y) / 2 / DEFAULT_RESOLUTION * DEFAULT_RESOLUTION,
+        (bounds->min.z + bounds->max.z) / 2 / DEFAULT_RESOLUTION * DEFAULT_RESOLUTION,
+    };
+    const AABB editBox{editCell, {editCell.x + DEFAULT_RESOLUTION, editCell.y + DEFAULT_RESOLUTION, editCell.z + DEFAULT_RESOLUTION}};
+
+    std::vector<Frame> frames(static_cast<std::size_t>(frameCount));
+    for (int i = 0; i < frameCount; i++) {
+        if (i > 0 && i % EDIT_INTERVAL == 0) {
+            world.fill(editBox, i / EDIT_INTERVAL % 2 ? *editData : VoxelData{});
+        }
+        gl->glClearColor(0.f, 0.f, 0.f, 1.f);
+        gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderer.render(world, projection, getView(*bounds, i, frameCount));
+        const auto finishStart = std::chrono::steady_clock::now();
+        gl->glFinish();
+        frames[static_cast<std::size_t>(i)] = {renderer.getFrameTimes(), getMillisecondsSince(finishStart), renderer.getCullStats().drawnTriangles};
+    }
+    framebuffer.release();
+
+    QJsonArray frameResults;
+    std::vector<float> mesh, upload, draw, finish;
+    for (const auto& frame : frames) {
+        frameResults.append(QJsonObject{
+            {"mesh", frame.times.mesh},
+            {"upload", frame.times.upload},
+            {"draw", frame.times.draw},
+            {"finish", frame.finish},
+            {"drawnTriangles", static_cast<qint64>(frame.drawnTriangles)},
+        });
+        mesh.push_back(frame.times.mesh);
+        upload.push_back(frame.times.upload);
+        draw.push_back(frame.times.draw);
+        finish.push_back(frame.finish);
+    }
+    // The first frame meshes and uploads the whole chamber, it is kept out of the summary
+    const auto skipFirst = [](std::vector<float> values) {
+        values.erase(values.begin());
+        return values;
+    };
+    const QJsonObject results{
+        {"chamber", chamberPath},
+        {"renderer", QString(reinterpret_cast<const char*>(gl->glGetString(GL_RENDERER)))},
+        {"width", width},
+        {"height", height},
+        {"editInterval", EDIT_INTERVAL},
+        {"firstFrame", frameResults.first()},
+        {"summary", QJsonObject{
+            {"mesh", summarize(skipFirst(mesh))},
+            {"upload", summarize(skipFirst(upload))},
+            {"draw", summarize(skipFirst(draw))},
+            {"finish", summarize(skipFirst(finish))},
+        }},
+        {"frames", frameResults},
+    };
+
+    const auto json = QJsonDocument(results).toJson();
+    if (!parser.isSet(outputOption)) {
+        std::fwrite(json.constData(), 1, static_cast<std::size_t>(json.size()), stdout);
+        return 0;
+    }
+    QFile file(parser.value(outputOption));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+        printError("Unable to write " + parser.value(outputOption));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QStringList>
+
+/// Renders a chamber without a window: the editor's GL pipeline draws into a framebuffer object on an offscreen
+/// surface while a scripted camera orbits the chamber, editing it now and then. The CPU time of every frame is
+/// written as JSON. Run it under xvfb-run on machines without a display, Mesa's llvmpipe rasterizes it in software
+///
+///   puzzlemaker_ce --bench-render <chamber.pzce> [--frames N] [--size WxH] [--output results.json]
+namespace RenderBenchmark {
+
+/// The flag that selects the benchmark instead of the editor
+constexpr auto FLAG = "--bench-render";
+
+/// Needs a QGuiApplication. Returns the exit code of the process
+int run(const QStringList& arguments);
+
+} // namespace RenderBenchmark
@@ -0,0 +1,42 @@
+#include "VmfExport.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include "../editor/World.h"
+
+int VmfExport::run(int argc, const char* const* argv) {
+    std::vector<std::string_view> paths;
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view{argv[i]} != FLAG) {
+            paths.emplace_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2) {
+        std::fprintf(stderr, "Usage: %s %s <chamber.pzce> <map.vmf>\n", argc > 0 ? argv[0] : "puzzlemaker_ce", FLAG);
+        return 2;
+    }
+    const std::filesystem::path chamberPath{paths[0]};
+    const std::filesystem::path mapPath{paths[1]};
+
+    // The saved edits in the journal are part of the chamber, the unsaved ones a running editor may have are not
+    ChamberOctree chamber(MAX_CHAMBER_SIZE);
+    if (!ChamberFile::load(chamber, chamberPath)) {
+        std::fprintf(stderr, "Unable to load %s\n", chamberPath.string().c_str());
+        return 1;
+    }
+    if (const auto base = ChamberFile::readChecksum(chamberPath)) {
+        Journal<VoxelData>::applySaved(chamber, chamberPath, *base);
+    }
+
+    const auto solids = VmfFile::getSolids(chamber);
+    const auto brushes = VmfFile::getBrushes(solids);
+    if (!VmfFile::save(brushes, mapPath)) {
+        std::fprintf(stderr, "Unable to write %s\n", mapPath.string().c_str());
+        return 1;
+    }
+    std::printf("Merged %zu solid leaves into %zu brushes\n", solids.size(), brushes.size());
+    return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+/// Exports a chamber to a .vmf file without starting the editor, for build scripts. Needs no display or Qt
+/// application, the number of brushes before and after merging the leaves is printed to standard output
+///
+///   puzzlemaker_ce --export-vmf <chamber.pzce> <map.vmf>
+namespace VmfExport {
+
+/// The flag that selects the export instead of the editor
+constexpr auto FLAG = "--export-vmf";
+
+/// Returns the exit code of the process
+int run(int argc, const char* const* argv);
+
+} // namespace VmfExport
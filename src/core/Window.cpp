@@ -1,6 +1,11 @@
 #include "Window.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
 #include <optional>
+#include <system_error>
 
 #include <QActionGroup>
 #include <QApplication>
@@ -8,17 +13,63 @@
 #include <QDirIterator>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QFutureWatcher>
 #include <QHBoxLayout>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QLockFile>
+#include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QPromise>
+#include <QStandardPaths>
 #include <QStyle>
 #include <QStyleFactory>
+#include <QTimer>
+#include <QtConcurrent>
 
 #include "../config/Config.h"
 #include "../config/Options.h"
+#include "../editor/Editor.h"
+
+namespace {
+
+constexpr int PROGRESS_STEPS = 1000;
+constexpr int AUTOSAVE_INTERVAL_MS = 5 * 60 * 1000;
+/// Journals are folded into their chamber file once they outgrow it, but never while smaller than this
+constexpr std::uint64_t MIN_COMPACTION_SIZE = 1024 * 1024;
+
+std::filesystem::path toPath(const QString& path) {
+    return {path.toStdU16String()};
+}
+
+QString getDataDirectory() {
+    auto directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+    return directory;
+}
+
+/// Where untitled chambers are autosaved
+QString getAutosavePath() {
+    return getDataDirectory() + "/autosave" PUZZLEMAKER_CE_PROJECT_CHAMBER_SAVE_EXTENSION;
+}
+
+QString getSessionPath() {
+    return getDataDirectory() + "/session";
+}
+
+/// Forward file progress to a promise, scaled into [first, last) of the progress range
+ChamberFile::Progress getProgress(QPromise<bool>& promise, int first, int last) {
+    return [&promise, first, last](std::uint64_t done, std::uint64_t total) {
+        promise.setProgressValue(first + static_cast<int>(done * static_cast<std::uint64_t>(last - first) / std::max<std::uint64_t>(total, 1)));
+        return !promise.isCanceled();
+    };
+}
+
+} // namespace
 
 Window::Window(QWidget* parent)
         : QMainWindow(parent)
@@ -50,11 +101,29 @@ Window::Window(QWidget* parent)
     });
     this->closeFileAction->setDisabled(true);
 
+    fileMenu->addSeparator();
+    this->exportVmfAction = fileMenu->addAction(this->style()->standardIcon(QStyle::SP_DialogSaveButton), tr("&Export VMF..."), Qt::CTRL | Qt::Key_E, [this] {
+        this->exportVmf();
+    });
+    this->exportVmfAction->setDisabled(true);
+
     fileMenu->addSeparator();
     fileMenu->addAction(this->style()->standardIcon(QStyle::SP_DialogCancelButton), tr("&Exit"), Qt::ALT | Qt::Key_F4, [this] {
         this->close();
     });
 
+    // Edit menu
+    auto* editMenu = this->menuBar()->addMenu(tr("&Edit"));
+    this->undoAction = editMenu->addAction(this->style()->standardIcon(QStyle::SP_ArrowBack), tr("&Undo"), Qt::CTRL | Qt::Key_Z, [this] {
+        this->undo();
+    });
+    this->redoAction = editMenu->addAction(this->style()->standardIcon(QStyle::SP_ArrowForward), tr("&Redo"), Qt::CTRL | Qt::Key_Y, [this] {
+        this->redo();
+    });
+    QObject::connect(editMenu, &QMenu::aboutToShow, this, [this] {
+        this->updateEditActions();
+    });
+
     // Options menu
     auto* optionsMenu = this->menuBar()->addMenu(tr("&Options"));
 
@@ -80,6 +149,19 @@ Window::Window(QWidget* parent)
     optionStartMaximized->setCheckable(true);
     optionStartMaximized->setChecked(Options::get<bool>(OPT_START_MAXIMIZED));
 
+    auto* optionAutosave = optionsMenu->addAction(tr("&Autosave"), [=] {
+        Options::invert(OPT_AUTOSAVE);
+    });
+    optionAutosave->setCheckable(true);
+    optionAutosave->setChecked(Options::get<bool>(OPT_AUTOSAVE));
+
+    auto* optionShowFrameStats = optionsMenu->addAction(tr("Show &Frame Stats"), [this] {
+        Options::invert(OPT_SHOW_FRAME_STATS);
+        this->editor->setFrameStatsVisible(Options::get<bool>(OPT_SHOW_FRAME_STATS));
+    });
+    optionShowFrameStats->setCheckable(true);
+    optionShowFrameStats->setChecked(Options::get<bool>(OPT_SHOW_FRAME_STATS));
+
     // Help menu
     auto* helpMenu = this->menuBar()->addMenu(tr("&Help"));
     helpMenu->addAction(this->style()->standardIcon(QStyle::SP_DialogHelpButton), tr("&About"), Qt::Key_F1, [this] {
@@ -88,18 +170,35 @@ Window::Window(QWidget* parent)
     helpMenu->addAction(this->style()->standardIcon(QStyle::SP_DialogHelpButton), "About &Qt", Qt::ALT | Qt::Key_F1, [this] {
         this->aboutQt();
     });
+#ifdef PUZZLEMAKER_CE_PROFILER_ENABLED
+    helpMenu->addSeparator();
+    helpMenu->addAction(this->style()->standardIcon(QStyle::SP_DialogSaveButton), tr("Save Profiler &Trace..."), [this] {
+        this->saveProfilerTrace();
+    });
+#endif
 
     // Call after the menu is created, it controls the visibility of the save button
     this->markModified(false);
 
-    // todo: add widgets here
+    this->editor = new Editor(this);
+    this->editor->setFrameStatsVisible(Options::get<bool>(OPT_SHOW_FRAME_STATS));
+    this->setCentralWidget(this->editor);
+
+    this->autosaveTimer = new QTimer(this);
+    QObject::connect(this->autosaveTimer, &QTimer::timeout, this, &Window::autosave);
+    this->autosaveTimer->start(AUTOSAVE_INTERVAL_MS);
 
     this->clearContents();
 
-    // Load the VPK if given one through the command-line or double-clicking a file
-    // An error here means shut the application down
+    // Bring back the chamber that was open if the editor crashed, otherwise load the chamber if given one through
+    // the command-line or double-clicking a file
+    // Missing files shut the application down, files that fail to load are reported once loading finishes
+    const auto recoveryPath = this->startSession();
+    this->updateSession();
     const auto& args = QApplication::arguments();
-    if ((args.length() > 1 && args[1].endsWith(PUZZLEMAKER_CE_PROJECT_CHAMBER_SAVE_EXTENSION) && QFile::exists(args[1])) && !this->loadFile(args[1])) {
+    if (recoveryPath) {
+        this->loadFile(*recoveryPath, true);
+    } else if ((args.length() > 1 && args[1].endsWith(PUZZLEMAKER_CE_PROJECT_CHAMBER_SAVE_EXTENSION) && QFile::exists(args[1])) && !this->loadFile(args[1])) {
         exit(1);
     }
 }
@@ -119,20 +218,39 @@ void Window::openFile(const QString& startPath, const QString& filePath) {
     if (path.isEmpty()) {
         return;
     }
-    if (!this->loadFile(path)) {
-        this->clearContents();
-    }
+    // The open chamber stays as it is if the file is missing or the user keeps their modifications
+    this->loadFile(path);
 }
 
 bool Window::saveFile() {
-    // todo: save
-    this->markModified(false);
+    if (this->filePath.isEmpty()) {
+        return this->saveFileAs();
+    }
+    // The chamber file stays as it is, only the edits made since the last save are appended to its journal
+    auto& journal = this->editor->getWorld().getJournal();
+    if (journal.isOpen() && journal.flush(true)) {
+        this->markModified(false);
+        std::error_code error;
+        const auto chamberSize = std::filesystem::file_size(toPath(this->filePath), error);
+        if (!error && !this->saveFuture.isRunning() && journal.size() > std::max<std::uint64_t>(chamberSize, MIN_COMPACTION_SIZE)) {
+            // Replaying a journal larger than the chamber would slow down loading, write the chamber out in full
+            this->saveInBackground(this->filePath);
+        }
+        return true;
+    }
+    this->saveInBackground(this->filePath, tr("Saving %1...").arg(QFileInfo(this->filePath).fileName()));
     return true;
 }
 
 bool Window::saveFileAs() {
-    // todo: save as
-    this->markModified(false);
+    const auto path = QFileDialog::getSaveFileName(this, tr("Save " PUZZLEMAKER_CE_PROJECT_CHAMBER_SAVE_NAME), this->filePath, PUZZLEMAKER_CE_PROJECT_CHAMBER_SAVE_NAME " (*" PUZZLEMAKER_CE_PROJECT_CHAMBER_SAVE_EXTENSION ")");
+    if (path.isEmpty()) {
+        return false;
+    }
+    // The journal of the previous file does not apply to the new one, so it is written in full
+    this->filePath = path;
+    this->updateSession();
+    this->saveInBackground(this->filePath, tr("Saving %1...").arg(QFileInfo(this->filePath).fileName()));
     return true;
 }
 
@@ -140,6 +258,50 @@ void Window::closeFile() {
     this->clearContents();
 }
 
+void Window::exportVmf() {
+    // Next to the chamber file by default
+    QString startPath;
+    if (!this->filePath.isEmpty()) {
+        const QFileInfo chamberInfo(this->filePath);
+        startPath = chamberInfo.path() + '/' + chamberInfo.completeBaseName() + ".vmf";
+    }
+    const auto path = QFileDialog::getSaveFileName(this, tr("Export VMF"), startPath, tr("Valve Map Format") + " (*.vmf)");
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!this->editor->getWorld().exportVmf(toPath(path))) {
+        QMessageBox::critical(this, tr("Error"), tr("Unable to export the chamber to \"%1\"!").arg(path));
+    }
+}
+
+void Window::undo() {
+    if (this->loadFuture.isRunning() || !this->editor->getWorld().undo()) {
+        return;
+    }
+    this->markModified(true);
+    this->editor->update();
+    this->updateEditActions();
+}
+
+void Window::redo() {
+    if (this->loadFuture.isRunning() || !this->editor->getWorld().redo()) {
+        return;
+    }
+    this->markModified(true);
+    this->editor->update();
+    this->updateEditActions();
+}
+
+void Window::saveProfilerTrace() {
+    const auto path = QFileDialog::getSaveFileName(this, tr("Save Profiler Trace"), QString(), tr("Chrome Trace") + " (*.json)");
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!Profiler::get().writeChromeTrace(toPath(path))) {
+        QMessageBox::critical(this, tr("Error"), tr("Unable to save the profiler trace to \"%1\"!").arg(path));
+    }
+}
+
 void Window::about() {
     QString creditsText = "# " PUZZLEMAKER_CE_FULL_TITLE "\n"
                           "*Created by [craftablescience](https://github.com/craftablescience)*\n<br/>\n";
@@ -179,7 +341,7 @@ void Window::markModified(bool modified_) {
 bool Window::promptUserToKeepModifications() {
     auto response = QMessageBox::warning(this,
             tr("Save changes?"),
-            tr("This VPK has unsaved changes! Would you like to save these changes first?"),
+            tr("This chamber has unsaved changes! Would you like to save these changes first?"),
             QMessageBox::Ok | QMessageBox::Discard | QMessageBox::Cancel);
     switch (response) {
         case QMessageBox::Cancel:
@@ -187,20 +349,41 @@ bool Window::promptUserToKeepModifications() {
         case QMessageBox::Discard:
             return false;
         case QMessageBox::Ok:
-            this->saveFile();
-            return false;
+            // Keep the chamber if it wasn't saved, like when the save dialog of an untitled chamber is cancelled
+            return !this->saveFile();
         default:
             break;
     }
     return true;
 }
 
-void Window::clearContents() {
+bool Window::clearContents() {
     if (this->modified && this->promptUserToKeepModifications()) {
-        return;
+        return false;
     }
     this->markModified(false);
     this->freezeActions(true, false); // Leave create/open unfrozen
+
+    this->editor->getWorld().getJournal().discardUncommitted();
+    this->filePath.clear();
+    this->updateSession();
+    this->editor->getWorld().reset();
+    this->editor->update();
+    return true;
+}
+
+void Window::autosave() {
+    if (!this->modified || !Options::get<bool>(OPT_AUTOSAVE) || this->loadFuture.isRunning()) {
+        return;
+    }
+    // Edits flushed without a commit are not saved, they are only replayed to recover from a crash
+    if (auto& journal = this->editor->getWorld().getJournal(); journal.isOpen()) {
+        static_cast<void>(journal.flush(false));
+        return;
+    }
+    if (this->filePath.isEmpty() && !this->saveFuture.isRunning()) {
+        this->saveInBackground(getAutosavePath());
+    }
 }
 
 void Window::closeEvent(QCloseEvent* event) {
@@ -208,6 +391,17 @@ void Window::closeEvent(QCloseEvent* event) {
         event->ignore();
         return;
     }
+    // Let the last save finish, a half loaded chamber can be thrown away
+    this->loadFuture.cancel();
+    this->loadFuture.waitForFinished();
+    this->saveFuture.waitForFinished();
+    this->editor->getWorld().getJournal().discardUncommitted();
+
+    // A clean shutdown leaves nothing to recover
+    if (this->sessionLock) {
+        QFile::remove(getSessionPath());
+        this->sessionLock->unlock();
+    }
     event->accept();
 }
 
@@ -217,15 +411,168 @@ void Window::freezeActions(bool freeze, bool freezeCreationActions) const {
     this->saveFileAction->setDisabled(freeze || !this->modified);
     this->saveFileAsAction->setDisabled(freeze);
     this->closeFileAction->setDisabled(freeze);
+    this->exportVmfAction->setDisabled(freeze);
+    this->updateEditActions();
+}
+
+void Window::updateEditActions() const {
+    const auto& history = this->editor->getWorld().getHistory();
+    this->undoAction->setDisabled(this->loadFuture.isRunning() || !history.canUndo());
+    this->redoAction->setDisabled(this->loadFuture.isRunning() || !history.canRedo());
 }
 
-bool Window::loadFile(const QString& path) {
+bool Window::loadFile(const QString& path, bool recover) {
     QString fixedPath = QDir(path).absolutePath();
     fixedPath.replace('\\', '/');
+    if (!QFile::exists(fixedPath)) {
+        return false;
+    }
 
-    this->clearContents();
+    if (this->modified && this->promptUserToKeepModifications()) {
+        return false;
+    }
     this->freezeActions(true);
 
-    // todo: load file
+    // Reading and the first mesh build happen on a worker thread into a separate world,
+    // which replaces the editor's world in one step once it is complete. Until then the open chamber stays,
+    // cancelling or failing to load goes back to it
+    auto world = std::make_shared<World>();
+    auto* watcher = new QFutureWatcher<bool>(this);
+    auto* progressDialog = this->createProgressDialog(tr("Loading %1...").arg(QFileInfo(fixedPath).fileName()), watcher);
+    QObject::connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, progressDialog, world, fixedPath, recover] {
+        progressDialog->deleteLater();
+        watcher->deleteLater();
+        if (watcher->isCanceled()) {
+            this->freezeActions(false);
+            return;
+        }
+        if (watcher->future().resultCount() == 0 || !watcher->result()) {
+            QMessageBox::critical(this, tr("Error"), tr("Unable to load \"%1\"! It is not a valid chamber or it is corrupted.").arg(fixedPath));
+            this->freezeActions(false);
+            return;
+        }
+        // Unsaved edits of the chamber being replaced are gone, the user chose to discard them
+        this->editor->getWorld().getJournal().discardUncommitted();
+        this->editor->getWorld().reset();
+        this->editor->setWorld(world);
+        // A recovered untitled chamber stays untitled
+        this->filePath = recover && QFileInfo(fixedPath) == QFileInfo(getAutosavePath()) ? QString() : fixedPath;
+        this->updateSession();
+        this->markModified(recover);
+        this->freezeActions(false);
+    });
+    this->loadFuture = QtConcurrent::run([world, path = toPath(fixedPath), recover](QPromise<bool>& promise) {
+        promise.setProgressRange(0, PROGRESS_STEPS);
+        if (!world->load(path, getProgress(promise, 0, PROGRESS_STEPS / 2), recover)) {
+            promise.addResult(false);
+            return;
+        }
+        // Meshing a whole chamber takes longer than reading it
+        promise.setProgressValue(PROGRESS_STEPS / 2);
+        world->update();
+        promise.setProgressValue(PROGRESS_STEPS);
+        promise.addResult(true);
+    });
+    watcher->setFuture(this->loadFuture);
     return true;
 }
+
+void Window::saveInBackground(const QString& path, const QString& label) {
+    // Saves to the same path would share a temporary file
+    this->saveFuture.waitForFinished();
+
+    // The snapshot is what gets saved, editing can carry on while it is written. It keeps the world alive even if
+    // another chamber is opened meanwhile. Edits buffered so far are in the snapshot, the ones made in the meantime
+    // are carried over to the journal of the new file
+    auto snapshot = World::getChamberSnapshot(this->editor->getSharedWorld());
+    const auto journalOffset = this->editor->getWorld().getJournal().snapshot();
+    const bool rebase = path == this->filePath;
+    const std::weak_ptr<World> savedWorld = this->editor->getSharedWorld();
+    const bool interactive = !label.isEmpty();
+    if (interactive) {
+        this->freezeActions(true);
+        this->markModified(false);
+    }
+    auto* watcher = new QFutureWatcher<bool>(this);
+    auto* progressDialog = interactive ? this->createProgressDialog(label, watcher) : nullptr;
+    QObject::connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, progressDialog, interactive, path, rebase, journalOffset, savedWorld] {
+        watcher->deleteLater();
+        const bool saved = !watcher->isCanceled() && watcher->future().resultCount() > 0 && watcher->result();
+        // Skipped if another chamber was opened in the meantime. Without a journal the next save is a full one
+        if (const auto world = savedWorld.lock(); world == this->editor->getSharedWorld()) {
+            if (saved && rebase && path == this->filePath) {
+                const auto base = ChamberFile::readChecksum(toPath(path));
+                if (!base || !world->getJournal().rebase(Journal<VoxelData>::getPath(toPath(path)), *base, journalOffset)) {
+                    world->getJournal().close();
+                }
+            } else {
+                world->getJournal().abandonSnapshot();
+            }
+        }
+        if (!interactive) {
+            return;
+        }
+        progressDialog->deleteLater();
+        this->freezeActions(false);
+        if (!saved) {
+            if (!watcher->isCanceled()) {
+                QMessageBox::critical(this, tr("Error"), tr("Unable to save the chamber to \"%1\"!").arg(path));
+            }
+            // A chamber closed or opened in the meantime has nothing to do with the failed save
+            if (savedWorld.lock() == this->editor->getSharedWorld() && path == this->filePath) {
+                this->markModified(true);
+            }
+        }
+    });
+    this->saveFuture = QtConcurrent::run([snapshot, path = toPath(path)](QPromise<bool>& promise) {
+        promise.setProgressRange(0, PROGRESS_STEPS);
+        promise.addResult(ChamberFile::save(*snapshot, path, getProgress(promise, 0, PROGRESS_STEPS)));
+    });
+    watcher->setFuture(this->saveFuture);
+}
+
+std::optional<QString> Window::startSession() {
+    this->sessionLock = std::make_unique<QLockFile>(getDataDirectory() + "/session.lock");
+    // Another instance is running and owns the session
+    if (!this->sessionLock->tryLock(0)) {
+        this->sessionLock.reset();
+        return std::nullopt;
+    }
+    QFile session(getSessionPath());
+    if (!session.open(QIODevice::ReadOnly)) {
+        return std::nullopt;
+    }
+    const auto crashedPath = QString::fromUtf8(session.readAll());
+    session.close();
+    const auto path = crashedPath.isEmpty() ? getAutosavePath() : crashedPath;
+    if (!QFile::exists(path)) {
+        return std::nullopt;
+    }
+    const auto response = QMessageBox::question(this,
+            tr("Recover changes?"),
+            tr("The editor did not shut down properly. Would you like to recover the unsaved changes to %1?").arg(crashedPath.isEmpty() ? tr("the untitled chamber") : QFileInfo(crashedPath).fileName()));
+    if (response != QMessageBox::Yes) {
+        return std::nullopt;
+    }
+    return path;
+}
+
+void Window::updateSession() const {
+    if (!this->sessionLock) {
+        return;
+    }
+    QFile session(getSessionPath());
+    if (session.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        session.write(this->filePath.toUtf8());
+    }
+}
+
+QProgressDialog* Window::createProgressDialog(const QString& label, QFutureWatcher<bool>* watcher) {
+    auto* progressDialog = new QProgressDialog(label, tr("Cancel"), 0, PROGRESS_STEPS, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    // Small chambers finish before the dialog would show up
+    progressDialog->setMinimumDuration(500);
+    QObject::connect(watcher, &QFutureWatcher<bool>::progressValueChanged, progressDialog, &QProgressDialog::setValue);
+    QObject::connect(progressDialog, &QProgressDialog::canceled, watcher, &QFutureWatcher<bool>::cancel);
+    return progressDialog;
+}
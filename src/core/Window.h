@@ -1,12 +1,21 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <optional>
 #include <vector>
 
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QLockFile>
 #include <QMainWindow>
 
 class QAction;
 class QCloseEvent;
+class QProgressDialog;
+class QTimer;
+
+class Editor;
 
 class Window : public QMainWindow {
     Q_OBJECT;
@@ -24,6 +33,16 @@ public:
 
     void closeFile();
 
+    /// Export the chamber as a map to open in Hammer
+    void exportVmf();
+
+    void undo();
+
+    void redo();
+
+    /// Write the zones the profiler recorded to a Chrome trace, open it in chrome://tracing or ui.perfetto.dev
+    void saveProfilerTrace();
+
     void about();
 
     void aboutQt();
@@ -32,7 +51,11 @@ public:
 
     [[nodiscard]] bool promptUserToKeepModifications();
 
-    void clearContents();
+    /// Returns false if the user chose to keep the modifications, nothing is cleared then
+    bool clearContents();
+
+    /// Flush the edits to the journal of the open file, or write a snapshot of an untitled chamber without blocking editing
+    void autosave();
 
 protected:
     void closeEvent(QCloseEvent* event) override;
@@ -43,10 +66,40 @@ private:
     QAction* saveFileAction;
     QAction* saveFileAsAction;
     QAction* closeFileAction;
+    QAction* exportVmfAction;
+    QAction* undoAction;
+    QAction* redoAction;
+
+    Editor* editor;
+    QTimer* autosaveTimer;
 
+    QString filePath;
     bool modified;
 
+    // Held while running, a session file left behind without it means the editor crashed
+    std::unique_ptr<QLockFile> sessionLock;
+
+    // Loading and saving run on worker threads
+    QFuture<bool> loadFuture;
+    QFuture<bool> saveFuture;
+
     void freezeActions(bool freeze, bool freezeCreationActions = true) const;
 
-    bool loadFile(const QString& path);
+    /// Enable undo and redo when the history has steps to take
+    void updateEditActions() const;
+
+    /// Load a chamber on a worker thread, along with its unsaved edits if recovering from a crash
+    bool loadFile(const QString& path, bool recover = false);
+
+    /// Save a copy of the chamber on a worker thread, with a progress dialog if given a label.
+    /// Saving to the open file starts a new journal for it
+    void saveInBackground(const QString& path, const QString& label = QString());
+
+    /// Lock the session of this instance. Returns the chamber to recover if the last session crashed
+    [[nodiscard]] std::optional<QString> startSession();
+
+    /// Remember which chamber is open, to recover it after a crash
+    void updateSession() const;
+
+    [[nodiscard]] QProgressDialog* createProgressDialog(const QString& label, QFutureWatcher<bool>* watcher);
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+
+#include <sourcepp/math/Vector.h>
+
+using namespace sourcepp::math;
+
+/// Axis-aligned box covering [min, max) in world units
+struct AABB {
+	Vec3i min;
+	Vec3i max;
+
+	/// The box covered by an octree node
+	[[nodiscard]] static AABB fromNode(Vec3i position, int halfSize) {
+		return {
+			{position.x - halfSize, position.y - halfSize, position.z - halfSize},
+			{position.x + halfSize, position.y + halfSize, position.z + halfSize},
+		};
+	}
+
+	[[nodiscard]] bool isEmpty() const {
+		return this->min.x >= this->max.x || this->min.y >= this->max.y || this->min.z >= this->max.z;
+	}
+
+	[[nodiscard]] bool contains(Vec3i position) const {
+		return position.x >= this->min.x && position.x < this->max.x &&
+		       position.y >= this->min.y && position.y < this->max.y &&
+		       position.z >= this->min.z && position.z < this->max.z;
+	}
+
+	[[nodiscard]] bool encloses(const AABB& other) const {
+		return other.min.x >= this->min.x && other.max.x <= this->max.x &&
+		       other.min.y >= this->min.y && other.max.y <= this->max.y &&
+		       other.min.z >= this->min.z && other.max.z <= this->max.z;
+	}
+
+	/// True if the boxes share some volume, touching faces do not count
+	[[nodiscard]] bool intersects(const AABB& other) const {
+		return other.min.x < this->max.x && other.max.x > this->min.x &&
+		       other.min.y < this->max.y && other.max.y > this->min.y &&
+		       other.min.z < this->max.z && other.max.z > this->min.z;
+	}
+
+	/// The volume shared by both boxes, empty if they don't intersect
+	[[nodiscard]] AABB intersection(const AABB& other) const {
+		return {
+			{std::max(this->min.x, other.min.x), std::max(this->min.y, other.min.y), std::max(this->min.z, other.min.z)},
+			{std::min(this->max.x, other.max.x), std::min(this->max.y, other.max.y), std::min(this->max.z, other.max.z)},
+		};
+	}
+};
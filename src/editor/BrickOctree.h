@@ -0,0 +1,525 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "Octree.h"
+
+/// Octree whose nodes of BRICK_HALF_SIZE store their unit voxels densely in a brick instead of splitting further:
+/// a bitmask of the solid voxels and a palette index per voxel. Finely edited areas then cost a brick each rather
+/// than a node per voxel, while coarse areas stay as tree nodes. Every voxel of a brick is a unit leaf, the smaller
+/// nodes inside a brick all exist and are split. Exposes the editing and leaf walking surface of Octree, not
+/// versions or raycasts. The octree must be at least twice as wide as a brick
+template<typename D, int BRICK_DEPTH = 3>
+class BrickOctree {
+	static_assert(BRICK_DEPTH >= 1 && BRICK_DEPTH <= 3, "a slice of a brick must fit in 64 bits");
+
+public:
+	/// Index of a block of 8 sibling nodes, or of a brick
+	using Index = std::uint32_t;
+	/// Index of voxel data in the palette the bricks share, 0 is empty space
+	using MaterialIndex = std::uint16_t;
+
+	static constexpr Index NO_CHILDREN = ~Index{0};
+	/// Flags the children of a node as a brick rather than a block of nodes
+	static constexpr Index BRICK = Index{1} << 31;
+	/// Half size of the nodes holding bricks
+	static constexpr int BRICK_HALF_SIZE = 1 << BRICK_DEPTH;
+
+	class Node {
+	public:
+		[[nodiscard]] bool hasChildren() const {
+			return this->children_ != NO_CHILDREN;
+		}
+
+		/// The unit voxels under this node are in a brick
+		[[nodiscard]] bool isBrick() const {
+			return this->hasChildren() && (this->children_ & BRICK);
+		}
+
+		[[nodiscard]] const D& data() const {
+			return this->data_;
+		}
+
+	private:
+		friend class BrickOctree;
+
+		D data_{};
+		Index children_ = NO_CHILDREN;
+	};
+
+	using Block = std::array<Node, 8>;
+
+	/// The unit voxels of a node of BRICK_HALF_SIZE. Voxel (x, y, z) counts from the lowest corner
+	struct Brick {
+		/// Unit voxels along each side
+		static constexpr int WIDTH = 1 << BRICK_DEPTH;
+		static constexpr int VOLUME = WIDTH * WIDTH * WIDTH;
+		/// Voxels with x == 0 in a slice
+		static constexpr std::uint64_t FIRST_X = [] {
+			std::uint64_t bits = 0;
+			for (int y = 0; y < WIDTH; y++) {
+				bits |= std::uint64_t{1} << (y * WIDTH);
+			}
+			return bits;
+		}();
+		static constexpr std::uint64_t LAST_X = FIRST_X << (WIDTH - 1);
+		static constexpr std::uint64_t SLICE = WIDTH * WIDTH == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << (WIDTH * WIDTH)) - 1;
+
+		/// One word per slice along z, bit x + y * WIDTH is set if the voxel is solid
+		std::array<std::uint64_t, WIDTH> solid;
+		/// Palette index of voxel x + y * WIDTH + z * WIDTH * WIDTH
+		std::array<MaterialIndex, VOLUME> materials;
+
+		/// The solid voxels with no solid neighbour in the given direction, axis 0 for x, 1 for y and 2 for z. Faces
+		/// on the surface of the brick are kept, the voxels across them are in another node
+		[[nodiscard]] std::array<std::uint64_t, WIDTH> getVisibleFaces(int axis, bool positive) const {
+			std::array<std::uint64_t, WIDTH> visible; // NOLINT(*-member-init)
+			for (int z = 0; z < WIDTH; z++) {
+				const auto slice = this->solid[z];
+				std::uint64_t neighbors;
+				if (axis == 0) {
+					neighbors = positive ? (slice >> 1) & ~LAST_X : (slice << 1) & ~FIRST_X;
+				} else if (axis == 1) {
+					neighbors = positive ? slice >> WIDTH : (slice << WIDTH) & SLICE;
+				} else {
+					neighbors = positive ? (z + 1 < WIDTH ? this->solid[z + 1] : 0) : (z > 0 ? this->solid[z - 1] : 0);
+				}
+				visible[z] = slice & ~neighbors;
+			}
+			return visible;
+		}
+
+		[[nodiscard]] static int getIndex(int x, int y, int z) {
+			return x + y * WIDTH + z * WIDTH * WIDTH;
+		}
+	};
+
+	explicit BrickOctree(int size)
+		: rootHalfSize_(size / 2) {
+		this->clear();
+	}
+
+	BrickOctree(BrickOctree&&) noexcept = default;
+	BrickOctree& operator=(BrickOctree&&) noexcept = default;
+
+	/// Set voxel data in the octree. Siblings left holding equal data are merged back into their parent, and bricks
+	/// left holding a single material back into a leaf. Nodes smaller than a brick are split unless forceMerge is set
+	[[nodiscard]] bool set(Vec3i position, const D& data, bool forceMerge = false) {
+		const auto targetHalfSize = Octree<D>::getHalfSizeFromPosition(this->rootHalfSize_, position);
+		if (!targetHalfSize) {
+			return false;
+		}
+		std::array<Node*, Octree<D>::MAX_DEPTH> path; // NOLINT(*-member-init)
+		int depth = 0;
+		Node* node = &this->root_;
+		Vec3i nodePosition = Vec3i::zero();
+		int halfSize = this->rootHalfSize_;
+		for (; halfSize > targetHalfSize && halfSize > BRICK_HALF_SIZE; halfSize /= 2) {
+			if (!node->hasChildren()) {
+				if (node->data_ == data) {
+					// Already covered by a leaf holding this data
+					return true;
+				}
+				this->subdivide(*node);
+			}
+			path[depth++] = node;
+			const auto index = Octree<D>::getIndexFromPosition(nodePosition, position);
+			nodePosition = Octree<D>::getPositionFromIndex(nodePosition, halfSize, index);
+			node = &this->block(node->children_)[index];
+		}
+		if (halfSize == targetHalfSize) {
+			if (node->hasChildren() && !forceMerge) {
+				return false;
+			}
+			this->assign(*node, data);
+		} else {
+			if (!node->isBrick()) {
+				if (node->data_ == data) {
+					return true;
+				}
+				this->makeBrick(*node);
+			} else if (targetHalfSize > 1 && !forceMerge) {
+				return false;
+			}
+			this->fillBrick(this->brick(node->children_), nodePosition, AABB::fromNode(position, targetHalfSize), this->intern(data));
+			if (!this->tryCollapse(*node)) {
+				return true;
+			}
+		}
+		while (depth > 0 && this->tryMerge(*path[depth - 1])) {
+			depth--;
+		}
+		return true;
+	}
+
+	/// Get the leaf containing the given position, a unit voxel inside bricks. Returns nullptr if the position lies
+	/// on a node boundary. Voxels of bricks share the palette node of their data. Invalidated by any modification
+	[[nodiscard]] const Node* get(Vec3i position) const {
+		const Node* node = &this->root_;
+		Vec3i nodePosition = Vec3i::zero();
+		int halfSize = this->rootHalfSize_;
+		while (!Octree<D>::isPositionOnBounds(nodePosition, halfSize, position)) {
+			if (!node->hasChildren()) {
+				return node;
+			}
+			if (node->isBrick()) {
+				// Unit voxel centers are at odd offsets from the corner of the brick
+				const Vec3i offset{position.x - nodePosition.x + halfSize, position.y - nodePosition.y + halfSize, position.z - nodePosition.z + halfSize};
+				if (!(offset.x & offset.y & offset.z & 1)) {
+					return nullptr;
+				}
+				return &this->palette_[this->brick(node->children_).materials[Brick::getIndex(offset.x / 2, offset.y / 2, offset.z / 2)]];
+			}
+			const auto index = Octree<D>::getIndexFromPosition(nodePosition, position);
+			nodePosition = Octree<D>::getPositionFromIndex(nodePosition, halfSize, index);
+			halfSize /= 2;
+			node = &this->block(node->children_)[index];
+		}
+		return nullptr;
+	}
+
+	/// Check if a node centered on the given position exists
+	[[nodiscard]] bool exists(Vec3i position) const {
+		const auto targetHalfSize = Octree<D>::getHalfSizeFromPosition(this->rootHalfSize_, position);
+		if (!targetHalfSize) {
+			return false;
+		}
+		const Node* node = &this->root_;
+		Vec3i nodePosition = Vec3i::zero();
+		for (int halfSize = this->rootHalfSize_; halfSize > targetHalfSize; halfSize /= 2) {
+			if (!node->hasChildren()) {
+				return false;
+			}
+			if (node->isBrick()) {
+				return true;
+			}
+			const auto index = Octree<D>::getIndexFromPosition(nodePosition, position);
+			nodePosition = Octree<D>::getPositionFromIndex(nodePosition, halfSize, index);
+			node = &this->block(node->children_)[index];
+		}
+		return true;
+	}
+
+	/// Set every voxel inside the box. Nodes fully inside the box are assigned in one step, bricks crossing its
+	/// boundary get the unit voxels with their center inside it
+	void fill(const AABB& box, const D& data) {
+		this->fill(this->root_, Vec3i::zero(), this->rootHalfSize_, box, data);
+	}
+
+	/// Reset every voxel inside the box to empty
+	void clear(const AABB& box) {
+		this->fill(box, D{});
+	}
+
+	/// Call func(node, position, halfSize) for every leaf outside the bricks and brickFunc(brick, position)
+	/// for every brick, in Morton order
+	template<typename F, typename B>
+	void forEachLeafOrBrick(F&& func, B&& brickFunc) const {
+		this->forEachLeafOrBrick(func, brickFunc, this->root_, Vec3i::zero(), this->rootHalfSize_);
+	}
+
+	/// Call func(node, position, halfSize) for every leaf, the voxels of bricks included
+	template<typename F>
+	void forEachLeaf(F&& func) const {
+		this->forEachLeafOrBrick(func, [this, &func](const Brick& brick, Vec3i position) {
+			this->forEachVoxel(brick, position, AABB::fromNode(position, BRICK_HALF_SIZE), func);
+		});
+	}
+
+	/// Call func(node, position, halfSize) for every leaf intersecting the box, the voxels of bricks included
+	template<typename F>
+	void forEachLeaf(const AABB& box, F&& func) const {
+		this->forEachLeaf(func, this->root_, Vec3i::zero(), this->rootHalfSize_, box);
+	}
+
+	/// Free every node and brick at once, leaving a single empty root
+	void clear() {
+		this->root_ = Node{};
+		this->pages_.clear();
+		this->blockCount_ = 0;
+		this->freeBlocks_.clear();
+		this->bricks_.clear();
+		this->freeBricks_.clear();
+		this->palette_.assign(1, Node{});
+	}
+
+	/// The data of a palette index of a brick
+	[[nodiscard]] const D& getMaterial(MaterialIndex material) const {
+		return this->palette_[material].data_;
+	}
+
+	[[nodiscard]] const Node& root() const {
+		return this->root_;
+	}
+
+	[[nodiscard]] int size() const {
+		return this->rootHalfSize_ * 2;
+	}
+
+	/// The number of live nodes including the root, bricks count as one node each
+	[[nodiscard]] std::size_t nodeCount() const {
+		return (this->blockCount_ - this->freeBlocks_.size()) * 8 + 1;
+	}
+
+	[[nodiscard]] std::size_t brickCount() const {
+		return this->bricks_.size() - this->freeBricks_.size();
+	}
+
+	/// Bytes reserved by the nodes, bricks and palette
+	[[nodiscard]] std::size_t memoryUsage() const {
+		return sizeof(BrickOctree) + this->pages_.size() * PAGE_SIZE * sizeof(Block) + this->bricks_.capacity() * sizeof(Brick) +
+		       this->palette_.capacity() * sizeof(Node) + (this->freeBlocks_.capacity() + this->freeBricks_.capacity()) * sizeof(Index);
+	}
+
+private:
+	// 256 blocks per page, pages never move once allocated
+	static constexpr Index PAGE_BITS = 8;
+	static constexpr Index PAGE_SIZE = 1 << PAGE_BITS;
+
+	[[nodiscard]] const Block& block(Index index) const {
+		return this->pages_[index >> PAGE_BITS][index & (PAGE_SIZE - 1)];
+	}
+
+	[[nodiscard]] Block& block(Index index) {
+		return this->pages_[index >> PAGE_BITS][index & (PAGE_SIZE - 1)];
+	}
+
+	[[nodiscard]] const Brick& brick(Index children) const {
+		return this->bricks_[children & ~BRICK];
+	}
+
+	[[nodiscard]] Brick& brick(Index children) {
+		return this->bricks_[children & ~BRICK];
+	}
+
+	/// The palette index of the data, added if new. Once the palette is full, new data is left empty
+	[[nodiscard]] MaterialIndex intern(const D& data) {
+		const auto entry = std::find_if(this->palette_.begin(), this->palette_.end(), [&data](const Node& node) {
+			return node.data_ == data;
+		});
+		if (entry != this->palette_.end()) {
+			return static_cast<MaterialIndex>(entry - this->palette_.begin());
+		}
+		if (this->palette_.size() > std::numeric_limits<MaterialIndex>::max()) {
+			return 0;
+		}
+		this->palette_.emplace_back().data_ = data;
+		return static_cast<MaterialIndex>(this->palette_.size() - 1);
+	}
+
+	/// Split voxel into 8 subvoxels holding the same data
+	void subdivide(Node& node) {
+		Index index;
+		if (!this->freeBlocks_.empty()) {
+			index = this->freeBlocks_.back();
+			this->freeBlocks_.pop_back();
+		} else {
+			if (this->blockCount_ == this->pages_.size() * PAGE_SIZE) {
+				this->pages_.push_back(std::make_unique<Block[]>(PAGE_SIZE));
+			}
+			index = this->blockCount_++;
+		}
+		for (auto& child : this->block(index)) {
+			child.data_ = node.data_;
+			child.children_ = NO_CHILDREN;
+		}
+		node.children_ = index;
+	}
+
+	/// Replace a leaf of BRICK_HALF_SIZE with a brick of unit voxels holding its data
+	void makeBrick(Node& node) {
+		Index index;
+		if (!this->freeBricks_.empty()) {
+			index = this->freeBricks_.back();
+			this->freeBricks_.pop_back();
+		} else {
+			index = static_cast<Index>(this->bricks_.size());
+			this->bricks_.emplace_back();
+		}
+		auto& brick = this->bricks_[index];
+		const auto material = this->intern(node.data_);
+		brick.materials.fill(material);
+		brick.solid.fill(material ? Brick::SLICE : 0);
+		node.children_ = index | BRICK;
+	}
+
+	/// Set the unit voxels of the brick with their center inside the box
+	static void fillBrick(Brick& brick, Vec3i position, const AABB& box, MaterialIndex material) {
+		const auto bounds = AABB::fromNode(position, BRICK_HALF_SIZE);
+		// Unit voxel centers sit at odd offsets from the corner, halving the clamped offsets of the box gives the range
+		const auto first = [](int min, int corner) {
+			return std::clamp(min - corner, 0, Brick::WIDTH * 2) / 2;
+		};
+		for (int z = first(box.min.z, bounds.min.z); z < first(box.max.z, bounds.min.z); z++) {
+			for (int y = first(box.min.y, bounds.min.y); y < first(box.max.y, bounds.min.y); y++) {
+				for (int x = first(box.min.x, bounds.min.x); x < first(box.max.x, bounds.min.x); x++) {
+					brick.materials[Brick::getIndex(x, y, z)] = material;
+					const auto bit = std::uint64_t{1} << (x + y * Brick::WIDTH);
+					brick.solid[z] = material ? brick.solid[z] | bit : brick.solid[z] & ~bit;
+				}
+			}
+		}
+	}
+
+	/// Turn the brick of the node back into a leaf if all of its voxels hold the same data
+	bool tryCollapse(Node& node) {
+		const auto& brick = this->brick(node.children_);
+		const auto empty = std::all_of(brick.solid.begin(), brick.solid.end(), [](std::uint64_t slice) {
+			return slice == 0;
+		});
+		const auto full = std::all_of(brick.solid.begin(), brick.solid.end(), [](std::uint64_t slice) {
+			return slice == Brick::SLICE;
+		});
+		// Empty voxels all hold palette index 0, a solid one needs every material compared
+		if (!empty && !(full && std::all_of(brick.materials.begin(), brick.materials.end(), [&brick](MaterialIndex material) {
+			return material == brick.materials[0];
+		}))) {
+			return false;
+		}
+		this->assign(node, this->palette_[brick.materials[0]].data_);
+		return true;
+	}
+
+	/// Merge the children of the node if they are all leaves holding equal data
+	bool tryMerge(Node& node) {
+		const auto& children = this->block(node.children_);
+		for (const auto& child : children) {
+			if (child.hasChildren() || !(child.data_ == children[0].data_)) {
+				return false;
+			}
+		}
+		this->assign(node, children[0].data_);
+		return true;
+	}
+
+	/// Make the node a leaf holding the data, freeing what was under it
+	void assign(Node& node, D data) {
+		this->release(node);
+		node.data_ = std::move(data);
+		node.children_ = NO_CHILDREN;
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	void release(const Node& node) {
+		if (!node.hasChildren()) {
+			return;
+		}
+		if (node.isBrick()) {
+			this->freeBricks_.push_back(node.children_ & ~BRICK);
+			return;
+		}
+		for (auto& child : this->block(node.children_)) {
+			this->release(child);
+			child = Node{};
+		}
+		this->freeBlocks_.push_back(node.children_);
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	void fill(Node& node, Vec3i position, int halfSize, const AABB& box, const D& data) {
+		const auto bounds = AABB::fromNode(position, halfSize);
+		if (!box.intersects(bounds)) {
+			return;
+		}
+		if (box.encloses(bounds)) {
+			this->assign(node, data);
+			return;
+		}
+		if (halfSize == BRICK_HALF_SIZE) {
+			if (!node.isBrick()) {
+				if (node.data_ == data) {
+					return;
+				}
+				this->makeBrick(node);
+			}
+			this->fillBrick(this->brick(node.children_), position, box, this->intern(data));
+			this->tryCollapse(node);
+			return;
+		}
+		if (!node.hasChildren()) {
+			if (node.data_ == data) {
+				return;
+			}
+			this->subdivide(node);
+		}
+		auto& children = this->block(node.children_);
+		for (int i = 0; i < 8; i++) {
+			this->fill(children[i], Octree<D>::getPositionFromIndex(position, halfSize, i), halfSize / 2, box, data);
+		}
+		this->tryMerge(node);
+	}
+
+	/// Call func(node, position, 1) for the voxels of the brick intersecting the box
+	template<typename F>
+	void forEachVoxel(const Brick& brick, Vec3i position, const AABB& box, F& func) const {
+		const auto bounds = AABB::fromNode(position, BRICK_HALF_SIZE);
+		const auto first = [](int min, int corner) {
+			return std::clamp(min - corner, 0, Brick::WIDTH * 2) / 2;
+		};
+		const auto last = [](int max, int corner) {
+			return (std::clamp(max - corner, 0, Brick::WIDTH * 2) + 1) / 2;
+		};
+		for (int z = first(box.min.z, bounds.min.z); z < last(box.max.z, bounds.min.z); z++) {
+			for (int y = first(box.min.y, bounds.min.y); y < last(box.max.y, bounds.min.y); y++) {
+				for (int x = first(box.min.x, bounds.min.x); x < last(box.max.x, bounds.min.x); x++) {
+					func(this->palette_[brick.materials[Brick::getIndex(x, y, z)]], Vec3i{bounds.min.x + x * 2 + 1, bounds.min.y + y * 2 + 1, bounds.min.z + z * 2 + 1}, 1);
+				}
+			}
+		}
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	template<typename F, typename B>
+	void forEachLeafOrBrick(F& func, B& brickFunc, const Node& node, Vec3i position, int halfSize) const {
+		if (!node.hasChildren()) {
+			func(node, position, halfSize);
+			return;
+		}
+		if (node.isBrick()) {
+			brickFunc(this->brick(node.children_), position);
+			return;
+		}
+		const auto& children = this->block(node.children_);
+		for (int i = 0; i < 8; i++) {
+			this->forEachLeafOrBrick(func, brickFunc, children[i], Octree<D>::getPositionFromIndex(position, halfSize, i), halfSize / 2);
+		}
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	template<typename F>
+	void forEachLeaf(F& func, const Node& node, Vec3i position, int halfSize, const AABB& box) const {
+		if (!box.intersects(AABB::fromNode(position, halfSize))) {
+			return;
+		}
+		if (!node.hasChildren()) {
+			func(node, position, halfSize);
+			return;
+		}
+		if (node.isBrick()) {
+			this->forEachVoxel(this->brick(node.children_), position, box, func);
+			return;
+		}
+		const auto& children = this->block(node.children_);
+		for (int i = 0; i < 8; i++) {
+			this->forEachLeaf(func, children[i], Octree<D>::getPositionFromIndex(position, halfSize, i), halfSize / 2, box);
+		}
+	}
+
+	Node root_;
+	int rootHalfSize_;
+
+	std::vector<std::unique_ptr<Block[]>> pages_;
+	Index blockCount_ = 0;
+	std::vector<Index> freeBlocks_;
+	std::vector<Brick> bricks_;
+	std::vector<Index> freeBricks_;
+	/// Data of every palette index, as nodes so voxels of bricks have a leaf to return
+	std::vector<Node> palette_;
+};
@@ -0,0 +1,513 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <sourcepp/math/Vector.h>
+
+#include "MappedFile.h"
+#include "Profiler.h"
+
+using namespace sourcepp::math;
+
+/// How a voxel data type is stored in the palette of a chamber file. Specialize for every type that gets saved
+template<typename D>
+struct PaletteEntry;
+
+/// The .pzce chamber format. Every integer is little endian.
+///
+///   header    "PZCE", u32 version, i32 octree size, u32 palette size, u64 node count, u64 stream size in bytes
+///   palette   every distinct leaf data once, as written by PaletteEntry<D>
+///   stream    every node in preorder with children in Morton order, packed from the lowest bit of each byte:
+///             1 bit set if the node is split, followed for leaves by their palette index in as few bits as it takes
+///   checksum  u64 hash of everything before it
+namespace ChamberFile {
+
+constexpr std::array<char, 4> MAGIC{'P', 'Z', 'C', 'E'};
+constexpr std::uint32_t VERSION = 1;
+
+/// Called with the number of nodes handled so far and the total, returns false to cancel
+using Progress = std::function<bool(std::uint64_t done, std::uint64_t total)>;
+
+/// Nodes handled between two progress reports
+constexpr std::uint64_t PROGRESS_INTERVAL = 1 << 16;
+
+/// FNV-1a over 64-bit words, any change to a single word always changes the result
+class Checksum {
+public:
+	void update(std::span<const std::byte> bytes) {
+		std::size_t i = 0;
+		for (; i < bytes.size() && this->pendingBytes_ > 0; i++) {
+			this->add(bytes[i]);
+		}
+		// Whole words are hashed straight from the input
+		for (; i + 8 <= bytes.size(); i += 8) {
+			this->pending_ = Checksum::load(bytes.data() + i);
+			this->mix();
+		}
+		for (; i < bytes.size(); i++) {
+			this->add(bytes[i]);
+		}
+	}
+
+	[[nodiscard]] std::uint64_t value() const {
+		auto hash = this->hash_;
+		if (this->pendingBytes_ > 0) {
+			hash = (hash ^ this->pending_) * PRIME;
+		}
+		return hash;
+	}
+
+	[[nodiscard]] static std::uint64_t load(const std::byte* bytes) {
+		std::uint64_t value;
+		if constexpr (std::endian::native == std::endian::little) {
+			std::memcpy(&value, bytes, sizeof(value));
+		} else {
+			value = 0;
+			for (int i = 0; i < 8; i++) {
+				value |= static_cast<std::uint64_t>(bytes[i]) << (i * 8);
+			}
+		}
+		return value;
+	}
+
+private:
+	static constexpr std::uint64_t PRIME = 0x100000001b3;
+
+	void add(std::byte byte) {
+		this->pending_ |= static_cast<std::uint64_t>(byte) << (this->pendingBytes_ * 8);
+		if (++this->pendingBytes_ == 8) {
+			this->mix();
+		}
+	}
+
+	void mix() {
+		this->hash_ = (this->hash_ ^ this->pending_) * PRIME;
+		this->pending_ = 0;
+		this->pendingBytes_ = 0;
+	}
+
+	std::uint64_t hash_ = 0xcbf29ce484222325;
+	std::uint64_t pending_ = 0;
+	unsigned pendingBytes_ = 0;
+};
+
+/// Buffered output that hashes everything written through it. Files go through a 64 KiB buffer, a few bytes at a
+/// time are better off with a small one
+template<std::size_t BUFFER_SIZE = 64 * 1024>
+class BasicWriter {
+public:
+	explicit BasicWriter(std::ostream& stream)
+		: stream_(stream) {}
+
+	void write(const void* data, std::size_t size) {
+		const auto* bytes = static_cast<const std::byte*>(data);
+		while (size > 0) {
+			const auto count = std::min(size, this->buffer_.size() - this->used_);
+			std::memcpy(this->buffer_.data() + this->used_, bytes, count);
+			this->used_ += count;
+			bytes += count;
+			size -= count;
+			if (this->used_ == this->buffer_.size()) {
+				this->flush();
+			}
+		}
+	}
+
+	template<std::integral T>
+	void writeInt(T value) {
+		std::array<std::byte, sizeof(T)> bytes; // NOLINT(*-member-init)
+		for (std::size_t i = 0; i < sizeof(T); i++) {
+			bytes[i] = static_cast<std::byte>(static_cast<std::make_unsigned_t<T>>(value) >> (i * 8));
+		}
+		this->write(bytes.data(), bytes.size());
+	}
+
+	/// Append the checksum of everything written so far
+	void finish() {
+		this->flush();
+		const auto checksum = this->checksum_.value();
+		this->writeInt(checksum);
+		this->flush();
+		this->stream_.flush();
+	}
+
+private:
+	void flush() {
+		this->checksum_.update({this->buffer_.data(), this->used_});
+		this->stream_.write(reinterpret_cast<const char*>(this->buffer_.data()), static_cast<std::streamsize>(this->used_));
+		this->used_ = 0;
+	}
+
+	std::ostream& stream_;
+	std::array<std::byte, BUFFER_SIZE> buffer_; // NOLINT(*-member-init)
+	std::size_t used_ = 0;
+	Checksum checksum_;
+};
+
+using Writer = BasicWriter<>;
+
+/// Bounds checked input over bytes in memory
+class Reader {
+public:
+	explicit Reader(std::span<const std::byte> data)
+		: data_(data) {}
+
+	[[nodiscard]] bool read(void* data, std::size_t size) {
+		if (size > this->data_.size()) {
+			return false;
+		}
+		std::memcpy(data, this->data_.data(), size);
+		this->data_ = this->data_.subspan(size);
+		return true;
+	}
+
+	template<std::integral T>
+	[[nodiscard]] bool readInt(T& value) {
+		std::array<std::byte, sizeof(T)> bytes; // NOLINT(*-member-init)
+		if (!this->read(bytes.data(), bytes.size())) {
+			return false;
+		}
+		std::make_unsigned_t<T> result = 0;
+		for (std::size_t i = 0; i < sizeof(T); i++) {
+			result |= static_cast<std::make_unsigned_t<T>>(static_cast<std::make_unsigned_t<T>>(bytes[i]) << (i * 8));
+		}
+		value = static_cast<T>(result);
+		return true;
+	}
+
+	/// Everything not read yet
+	[[nodiscard]] std::span<const std::byte> remaining() const {
+		return this->data_;
+	}
+
+private:
+	std::span<const std::byte> data_;
+};
+
+/// Packs values of up to 32 bits, lowest bit first
+class BitWriter {
+public:
+	explicit BitWriter(Writer& writer)
+		: writer_(writer) {}
+
+	void write(std::uint32_t value, int bits) {
+		this->bits_ |= static_cast<std::uint64_t>(value) << this->count_;
+		this->count_ += bits;
+		if (this->count_ >= 64) {
+			this->writer_.writeInt(this->bits_);
+			this->count_ -= 64;
+			// The bits of the value that did not fit
+			this->bits_ = this->count_ > 0 ? static_cast<std::uint64_t>(value) >> (bits - this->count_) : 0;
+		}
+	}
+
+	/// Write the bits of the last partial byte
+	void finish() {
+		for (; this->count_ > 0; this->count_ -= 8) {
+			this->writer_.writeInt(static_cast<std::uint8_t>(this->bits_));
+			this->bits_ >>= 8;
+		}
+		this->count_ = 0;
+	}
+
+private:
+	Writer& writer_;
+	std::uint64_t bits_ = 0;
+	int count_ = 0;
+};
+
+/// Unpacks values written by BitWriter
+class BitReader {
+public:
+	explicit BitReader(std::span<const std::byte> data)
+		: data_(data) {}
+
+	[[nodiscard]] bool read(std::uint32_t& value, int bits) {
+		if (this->position_ + bits > this->data_.size() * 8) {
+			return false;
+		}
+		const auto byte = this->position_ / 8;
+		std::uint64_t window;
+		if (byte + 8 <= this->data_.size()) {
+			window = Checksum::load(this->data_.data() + byte);
+		} else {
+			window = 0;
+			for (std::size_t i = byte; i < this->data_.size(); i++) {
+				window |= static_cast<std::uint64_t>(this->data_[i]) << ((i - byte) * 8);
+			}
+		}
+		// At most 7 + 32 bits are needed from the window
+		value = static_cast<std::uint32_t>((window >> (this->position_ % 8)) & ((std::uint64_t{1} << bits) - 1));
+		this->position_ += bits;
+		return true;
+	}
+
+	/// True once every byte but the padding of the last one has been read
+	[[nodiscard]] bool isAtEnd() const {
+		return (this->position_ + 7) / 8 == this->data_.size();
+	}
+
+private:
+	std::span<const std::byte> data_;
+	std::size_t position_ = 0;
+};
+
+/// Bits needed to store any index into a palette of the given size
+[[nodiscard]] inline int getIndexBits(std::size_t paletteSize) {
+	return paletteSize > 1 ? static_cast<int>(std::bit_width(paletteSize - 1)) : 0;
+}
+
+/// Write the octree to a stream, check the stream for errors afterwards. The tree is read twice, once for the palette
+/// and the header and once for the nodes, so nothing but the palette is kept in memory.
+/// Returns false if cancelled, the stream is left without a checksum
+template<typename Tree>
+[[nodiscard]] bool write(const Tree& tree, std::ostream& stream, const Progress& progress = {}) {
+	using D = std::remove_cvref_t<decltype(std::declval<const typename Tree::Node&>().data())>;
+
+	std::vector<D> palette;
+	std::size_t last = 0;
+	const auto getIndex = [&palette, &last](const D& data) {
+		// Neighbouring leaves usually hold the same data
+		if (last < palette.size() && palette[last] == data) {
+			return last;
+		}
+		last = static_cast<std::size_t>(std::find(palette.begin(), palette.end(), data) - palette.begin());
+		if (last == palette.size()) {
+			palette.push_back(data);
+		}
+		return last;
+	};
+	std::uint64_t leafCount = 0;
+	tree.forEachLeaf([&getIndex, &leafCount](const typename Tree::Node& node, Vec3i, int) {
+		getIndex(node.data());
+		leafCount++;
+	});
+
+	// Every split node has 8 children, so the node count follows from the leaf count
+	const auto nodeCount = leafCount + (leafCount - 1) / 7;
+	const int indexBits = ChamberFile::getIndexBits(palette.size());
+	const auto streamBits = nodeCount + leafCount * indexBits;
+
+	Writer writer(stream);
+	writer.write(MAGIC.data(), MAGIC.size());
+	writer.writeInt(VERSION);
+	writer.writeInt(static_cast<std::int32_t>(tree.size()));
+	writer.writeInt(static_cast<std::uint32_t>(palette.size()));
+	writer.writeInt(nodeCount);
+	writer.writeInt((streamBits + 7) / 8);
+	for (const auto& data : palette) {
+		PaletteEntry<D>::write(writer, data);
+	}
+
+	BitWriter bits(writer);
+	const int rootHalfSize = tree.size() / 2;
+	std::uint64_t leaves = 0;
+	bool cancelled = false;
+	tree.forEachLeaf([&](const typename Tree::Node& node, Vec3i position, int halfSize) {
+		if (cancelled) {
+			return;
+		}
+		if (progress && ++leaves % PROGRESS_INTERVAL == 0 && !progress(leaves, leafCount)) {
+			cancelled = true;
+			return;
+		}
+		// In preorder a split node comes right before its first leaf. This leaf is the first leaf of every
+		// ancestor it is the first child of, which are the levels its corner is aligned to
+		const int depth = std::countr_zero(static_cast<unsigned>(rootHalfSize / halfSize));
+		const auto corner = static_cast<unsigned>(((position.x - halfSize + rootHalfSize) | (position.y - halfSize + rootHalfSize) | (position.z - halfSize + rootHalfSize)) / (halfSize * 2));
+		const int splits = std::min(depth, std::countr_zero(corner));
+		for (int i = 0; i < splits; i++) {
+			bits.write(1, 1);
+		}
+		bits.write(0, 1);
+		bits.write(static_cast<std::uint32_t>(getIndex(node.data())), indexBits);
+	});
+	if (cancelled) {
+		return false;
+	}
+	bits.finish();
+	writer.finish();
+	return true;
+}
+
+/// Replace the octree with one read from bytes in memory, in a single pass over the nodes.
+/// Returns false and leaves the octree empty if the data is not a valid chamber of the same size, or if cancelled
+template<typename Tree>
+[[nodiscard]] bool read(Tree& tree, std::span<const std::byte> data, const Progress& progress = {}) {
+	using D = std::remove_cvref_t<decltype(std::declval<const typename Tree::Node&>().data())>;
+
+	const auto fail = [&tree] {
+		tree.clear();
+		return false;
+	};
+	if (data.size() < MAGIC.size() + sizeof(std::uint64_t)) {
+		return fail();
+	}
+	const auto body = data.first(data.size() - sizeof(std::uint64_t));
+	Checksum checksum;
+	checksum.update(body);
+	if (checksum.value() != Checksum::load(data.data() + body.size())) {
+		return fail();
+	}
+
+	Reader reader(body);
+	std::array<char, 4> magic; // NOLINT(*-member-init)
+	std::uint32_t version, paletteSize;
+	std::int32_t size;
+	std::uint64_t nodeCount, streamSize;
+	if (!reader.read(magic.data(), magic.size()) || magic != MAGIC || !reader.readInt(version) || version != VERSION) {
+		return fail();
+	}
+	if (!reader.readInt(size) || size != tree.size() || !reader.readInt(paletteSize) || paletteSize == 0 || !reader.readInt(nodeCount) || !reader.readInt(streamSize)) {
+		return fail();
+	}
+	std::vector<D> palette(std::min<std::size_t>(paletteSize, reader.remaining().size()));
+	if (palette.size() != paletteSize) {
+		return fail();
+	}
+	for (auto& entry : palette) {
+		if (!PaletteEntry<D>::read(reader, entry)) {
+			return fail();
+		}
+	}
+	if (reader.remaining().size() != streamSize) {
+		return fail();
+	}
+
+	BitReader bits(reader.remaining());
+	const int indexBits = ChamberFile::getIndexBits(palette.size());
+	std::uint64_t nodes = 0;
+	const bool valid = tree.readPreorder([&](const D*& leaf) {
+		std::uint32_t split;
+		if (nodes++ == nodeCount || !bits.read(split, 1)) {
+			return false;
+		}
+		if (progress && nodes % PROGRESS_INTERVAL == 0 && !progress(nodes, nodeCount)) {
+			return false;
+		}
+		if (split) {
+			leaf = nullptr;
+			return true;
+		}
+		std::uint32_t index;
+		if (!bits.read(index, indexBits) || index >= palette.size()) {
+			return false;
+		}
+		leaf = &palette[index];
+		return true;
+	});
+	if (!valid || nodes != nodeCount || !bits.isAtEnd()) {
+		return fail();
+	}
+	return true;
+}
+
+/// Write the octree to a file. The file is written next to the destination first and moved over it once
+/// complete, so a failed save never leaves a truncated chamber behind
+template<typename Tree>
+[[nodiscard]] bool save(const Tree& tree, const std::filesystem::path& path, const Progress& progress = {}) {
+	PUZZLEMAKER_CE_PROFILE_ZONE("ChamberFile::save");
+	auto temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+		if (!ChamberFile::write(tree, file, progress) || !file) {
+			file.close();
+			std::error_code error;
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
+
+/// Replace the octree with one read from a file, mapped into memory rather than read into a buffer
+template<typename Tree>
+[[nodiscard]] bool load(Tree& tree, const std::filesystem::path& path, const Progress& progress = {}) {
+	PUZZLEMAKER_CE_PROFILE_ZONE("ChamberFile::load");
+	const MappedFile file(path);
+	if (!file) {
+		tree.clear();
+		return false;
+	}
+	return ChamberFile::read(tree, file.data(), progress);
+}
+
+/// The checksum stored at the end of a chamber file, which identifies the chamber without reading all of it
+[[nodiscard]] inline std::optional<std::uint64_t> readChecksum(const std::filesystem::path& path) {
+	std::ifstream file(path, std::ios::binary);
+	std::array<std::byte, sizeof(std::uint64_t)> bytes; // NOLINT(*-member-init)
+	if (!file.seekg(-static_cast<std::streamoff>(bytes.size()), std::ios::end) || !file.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+		return std::nullopt;
+	}
+	return Checksum::load(bytes.data());
+}
+
+} // namespace ChamberFile
+
+/// Numbers are stored as they are in memory, in little endian
+template<typename D>
+requires std::is_arithmetic_v<D> && (!std::is_same_v<D, bool>)
+struct PaletteEntry<D> {
+	template<std::size_t BUFFER_SIZE>
+	static void write(ChamberFile::BasicWriter<BUFFER_SIZE>& writer, const D& data) {
+		if constexpr (std::is_floating_point_v<D>) {
+			writer.writeInt(std::bit_cast<std::conditional_t<sizeof(D) == 4, std::uint32_t, std::uint64_t>>(data));
+		} else {
+			writer.writeInt(data);
+		}
+	}
+
+	[[nodiscard]] static bool read(ChamberFile::Reader& reader, D& data) {
+		if constexpr (std::is_floating_point_v<D>) {
+			std::conditional_t<sizeof(D) == 4, std::uint32_t, std::uint64_t> bits;
+			if (!reader.readInt(bits)) {
+				return false;
+			}
+			data = std::bit_cast<D>(bits);
+			return true;
+		} else {
+			return reader.readInt(data);
+		}
+	}
+};
+
+/// Strings are stored as a u32 length followed by their bytes
+template<>
+struct PaletteEntry<std::string> {
+	template<std::size_t BUFFER_SIZE>
+	static void write(ChamberFile::BasicWriter<BUFFER_SIZE>& writer, const std::string& data) {
+		writer.writeInt(static_cast<std::uint32_t>(data.size()));
+		writer.write(data.data(), data.size());
+	}
+
+	[[nodiscard]] static bool read(ChamberFile::Reader& reader, std::string& data) {
+		std::uint32_t size;
+		if (!reader.readInt(size) || size > reader.remaining().size()) {
+			return false;
+		}
+		data.resize(size);
+		return reader.read(data.data(), size);
+	}
+};
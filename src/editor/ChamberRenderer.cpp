@@ -0,0 +1,98 @@
+#include "ChamberRenderer.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <QVector3D>
+
+namespace {
+
+[[nodiscard]] float getMillisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+bool ChamberRenderer::initialize() {
+	if (!this->initializeOpenGLFunctions()) {
+		return false;
+	}
+
+	this->shaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/chamber.vert");
+	this->shaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/chamber.frag");
+	this->shaderProgram.link();
+
+	this->chamberVertices.create();
+	this->chamberIndices.create();
+	return true;
+}
+
+void ChamberRenderer::render(World& world, const QMatrix4x4& projection, const QMatrix4x4& view) {
+	// testing
+	this->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+	this->shaderProgram.bind();
+
+	const auto eye = view.inverted().map(QVector3D());
+	this->shaderProgram.setUniformValue("uMVP", projection * view);
+	this->shaderProgram.setUniformValue("uMV", view);
+	this->shaderProgram.setUniformValue("uNormalMatrix", view.normalMatrix());
+	this->shaderProgram.setUniformValue("uEyePosition", view.column(3).toVector3D());
+	this->shaderProgram.setUniformValue("uMeshTexture", 0);
+	this->shaderProgram.setUniformValue("uMatCapTexture", 1);
+
+	this->shaderProgram.setUniformValue("uTextureSize", static_cast<float>(world.getEditResolution()));
+
+	this->chamberVertices.bind();
+	this->chamberIndices.bind();
+	this->upload(world);
+
+	const auto drawStart = std::chrono::steady_clock::now();
+	int vertexPosLocation = this->shaderProgram.attributeLocation("vPos");
+	this->shaderProgram.enableAttributeArray(vertexPosLocation);
+	this->shaderProgram.setAttributeBuffer(vertexPosLocation, GL_SHORT, offsetof(MeshVertex, x), 3, sizeof(MeshVertex));
+
+	// Integer attributes need the I variant, the program wrapper only binds float attributes
+	int vertexAttributesLocation = this->shaderProgram.attributeLocation("vAttributes");
+	this->glEnableVertexAttribArray(vertexAttributesLocation);
+	this->glVertexAttribIPointer(vertexAttributesLocation, 1, GL_UNSIGNED_INT, sizeof(MeshVertex), reinterpret_cast<const void*>(offsetof(MeshVertex, attributes)));
+
+	const auto frustum = Frustum::fromMatrix((projection * view).constData());
+	this->chamberCullStats = world.getMesh().cull(frustum, {eye.x(), eye.y(), eye.z()}, DEFAULT_LOD_DISTANCE, this->chamberDraws);
+	for (const auto& draw : this->chamberDraws) {
+		const auto indexOffset = static_cast<std::uintptr_t>(draw.firstIndex) * sizeof(std::uint32_t);
+		this->glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(draw.indexCount), GL_UNSIGNED_INT, reinterpret_cast<void*>(indexOffset), static_cast<GLint>(draw.baseVertex));
+	}
+
+	this->chamberIndices.release();
+	this->chamberVertices.release();
+
+	this->shaderProgram.release();
+	this->frameTimes.draw = getMillisecondsSince(drawStart);
+}
+
+const ChunkedMesh<ChamberOctree>::CullStats& ChamberRenderer::getCullStats() const {
+	return this->chamberCullStats;
+}
+
+const ChamberRenderer::FrameTimes& ChamberRenderer::getFrameTimes() const {
+	return this->frameTimes;
+}
+
+void ChamberRenderer::upload(World& world) {
+	PUZZLEMAKER_CE_PROFILE_ZONE("ChamberRenderer::upload");
+	const auto meshStart = std::chrono::steady_clock::now();
+	world.update();
+	this->frameTimes.mesh = getMillisecondsSince(meshStart);
+
+	const auto uploadStart = std::chrono::steady_clock::now();
+	world.getMesh().upload([this](std::uint32_t vertexCount, std::uint32_t indexCount) {
+		this->chamberVertices.allocate(static_cast<int>(vertexCount * sizeof(MeshVertex)));
+		this->chamberIndices.allocate(static_cast<int>(indexCount * sizeof(std::uint32_t)));
+	}, [this](const auto& chunk) {
+		this->chamberVertices.write(static_cast<int>(chunk.vertices.offset * sizeof(MeshVertex)), chunk.mesh.vertices.data(), static_cast<int>(chunk.mesh.vertices.size() * sizeof(MeshVertex)));
+		this->chamberIndices.write(static_cast<int>(chunk.indices.offset * sizeof(std::uint32_t)), chunk.mesh.indices.data(), static_cast<int>(chunk.mesh.indices.size() * sizeof(std::uint32_t)));
+	});
+	this->frameTimes.upload = getMillisecondsSince(uploadStart);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLShaderProgram>
+
+#include "World.h"
+
+/// Draws the chamber of a world with the chamber shaders, keeping its mesh uploaded to the GPU. Everything but
+/// the constructor needs its OpenGL 3.2 core context current, whether it belongs to a widget or an offscreen surface
+class ChamberRenderer : protected QOpenGLFunctions_3_2_Core {
+public:
+	/// Milliseconds the CPU spent on each part of a frame
+	struct FrameTimes {
+		/// Remeshing the chunks changed since the last frame
+		float mesh = 0.f;
+		/// Writing the new chunk meshes to the GPU buffers
+		float upload = 0.f;
+		/// Culling the chunks and issuing the draw calls
+		float draw = 0.f;
+	};
+
+	/// Compile the shaders and create the buffers. Returns false if the context has no OpenGL 3.2 core
+	[[nodiscard]] bool initialize();
+
+	/// Bring the GPU copy of the world's mesh up to date and draw the chunks visible from the view
+	void render(World& world, const QMatrix4x4& projection, const QMatrix4x4& view);
+
+	/// What frustum culling and levels of detail skipped in the last frame
+	[[nodiscard]] const ChunkedMesh<ChamberOctree>::CullStats& getCullStats() const;
+
+	[[nodiscard]] const FrameTimes& getFrameTimes() const;
+
+private:
+	/// Remesh the chunks changed since the last frame and upload them, expects both chamber buffers to be bound
+	void upload(World& world);
+
+	QOpenGLShaderProgram shaderProgram;
+	QOpenGLBuffer chamberVertices{QOpenGLBuffer::Type::VertexBuffer};
+	QOpenGLBuffer chamberIndices{QOpenGLBuffer::Type::IndexBuffer};
+	std::vector<ChunkedMesh<ChamberOctree>::Draw> chamberDraws;
+	ChunkedMesh<ChamberOctree>::CullStats chamberCullStats;
+	FrameTimes frameTimes;
+};
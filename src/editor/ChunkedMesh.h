@@ -0,0 +1,389 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Frustum.h"
+#include "Mesher.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+/// A chamber mesh split into cubic chunks aligned to octree nodes. Every chunk caches its mesh and its
+/// range in the GPU buffers, so an edit only remeshes and reuploads the chunks whose faces it touched
+template<typename Tree>
+class ChunkedMesh {
+public:
+	using D = std::remove_cvref_t<decltype(std::declval<const typename Tree::Node&>().data())>;
+
+	/// Every chunk is meshed at full resolution and at coarser levels of detail for distant views
+	static constexpr int LOD_LEVELS = 3;
+
+	/// Indices of one level of detail inside a chunk's mesh
+	struct Lod {
+		std::uint32_t firstIndex = 0;
+		std::uint32_t indexCount = 0;
+	};
+
+	/// A slice of a GPU buffer, in elements
+	struct Range {
+		std::uint32_t offset = 0;
+		std::uint32_t capacity = 0;
+	};
+
+	struct Chunk {
+		/// Minimum corner of the chunk
+		Vec3i position;
+		/// Every level of detail one after the other, sharing the base vertex of the chunk.
+		/// Vertex materials index into ChunkedMesh::materials()
+		IndexedMesh mesh;
+		std::array<Lod, LOD_LEVELS> lods;
+		Range vertices;
+		Range indices;
+		bool dirty = true;
+		bool uploaded = false;
+	};
+
+	/// A chunk drawn with one of its levels of detail, in elements of the GPU buffers
+	struct Draw {
+		std::uint32_t firstIndex;
+		std::uint32_t indexCount;
+		std::uint32_t baseVertex;
+		int lod;
+	};
+
+	/// What a call to cull() skipped and kept
+	struct CullStats {
+		/// Nodes above the chunks count too, a culled node skips every chunk under it
+		std::size_t visitedNodes = 0;
+		std::size_t culledNodes = 0;
+		std::size_t culledChunks = 0;
+		std::size_t culledTriangles = 0;
+		std::size_t drawnChunks = 0;
+		std::size_t drawnTriangles = 0;
+		/// Triangles not drawn because a coarser level of detail was used
+		std::size_t lodTriangles = 0;
+	};
+
+	ChunkedMesh(int worldSize, int chunkSize)
+		: worldHalfSize_(worldSize / 2)
+		, chunkSize_(chunkSize)
+		, chunksPerAxis_(worldSize / chunkSize) {
+		while ((1 << this->splitDepth_) < this->chunksPerAxis_) {
+			this->splitDepth_++;
+		}
+	}
+
+	/// Mark the chunks whose faces change when the voxels inside the box change
+	void invalidate(const AABB& box) {
+		this->mark(box);
+		// Faces on the far planes of the box belong to the chunks after it
+		for (int axis = 0; axis < 3; axis++) {
+			const auto plane = Mesher::getComponent(box.max, axis);
+			const auto u = (axis + 1) % 3;
+			const auto v = (axis + 2) % 3;
+			this->mark({
+				Mesher::fromPlane(axis, plane, Mesher::getComponent(box.min, u), Mesher::getComponent(box.min, v)),
+				Mesher::fromPlane(axis, plane + 1, Mesher::getComponent(box.max, u), Mesher::getComponent(box.max, v)),
+			});
+		}
+	}
+
+	/// Remesh every dirty chunk, spread over the pool if one is given. The result is the same for
+	/// any number of threads. Returns the number of chunks rebuilt
+	std::size_t update(const Tree& tree, ThreadPool* pool = nullptr) {
+		PUZZLEMAKER_CE_PROFILE_ZONE("ChunkedMesh::update");
+		std::vector<Chunk*> dirty;
+		for (auto& [key, chunk] : this->chunks_) {
+			if (chunk.dirty) {
+				dirty.push_back(&chunk);
+			}
+		}
+		const auto run = [pool](std::size_t count, const auto& func) {
+			if (pool) {
+				pool->parallelFor(count, func);
+			} else {
+				for (std::size_t i = 0; i < count; i++) {
+					func(i);
+				}
+			}
+		};
+
+		std::vector<QuadMesh<D>> meshes(dirty.size() * LOD_LEVELS);
+		run(meshes.size(), [this, &tree, &dirty, &meshes](std::size_t i) {
+			PUZZLEMAKER_CE_PROFILE_ZONE("Mesher::mesh");
+			const auto& position = dirty[i / LOD_LEVELS]->position;
+			const AABB region{position, {position.x + this->chunkSize_, position.y + this->chunkSize_, position.z + this->chunkSize_}};
+			meshes[i] = Mesher::mesh(tree, region, this->getLodHalfSize(static_cast<int>(i % LOD_LEVELS)));
+		});
+
+		// Materials are numbered in chunk order, whichever thread found them first
+		for (auto& mesh : meshes) {
+			std::vector<std::size_t> materials;
+			for (const auto& data : mesh.materials) {
+				materials.push_back(this->getMaterial(data));
+			}
+			for (auto& quad : mesh.quads) {
+				quad.material = materials[quad.material];
+			}
+		}
+		run(dirty.size(), [&dirty, &meshes](std::size_t i) {
+			auto& chunk = *dirty[i];
+			chunk.mesh = {};
+			for (int level = 0; level < LOD_LEVELS; level++) {
+				auto lod = Mesher::index(meshes[i * LOD_LEVELS + level].quads);
+				const auto firstVertex = static_cast<std::uint32_t>(chunk.mesh.vertices.size());
+				chunk.lods[level] = {static_cast<std::uint32_t>(chunk.mesh.indices.size()), static_cast<std::uint32_t>(lod.indices.size())};
+				chunk.mesh.vertices.insert(chunk.mesh.vertices.end(), lod.vertices.begin(), lod.vertices.end());
+				for (auto index : lod.indices) {
+					chunk.mesh.indices.push_back(firstVertex + index);
+				}
+			}
+		});
+
+		for (auto it = this->chunks_.begin(); it != this->chunks_.end();) {
+			auto& chunk = it->second;
+			if (chunk.dirty && chunk.mesh.indices.empty()) {
+				// Its buffer ranges are reclaimed by the next layout
+				it = this->chunks_.erase(it);
+				continue;
+			}
+			if (chunk.dirty) {
+				chunk.dirty = false;
+				chunk.uploaded = false;
+				this->allocate(chunk);
+			}
+			++it;
+		}
+		if (this->needsLayout_) {
+			this->layout();
+		}
+		this->rebuiltChunks_ = dirty.size();
+		this->totalRebuiltChunks_ += dirty.size();
+		return dirty.size();
+	}
+
+	/// Hand every chunk changed since the last call to write(chunk). When the buffers had to grow,
+	/// resize(vertexCount, indexCount) is called first and every chunk is written again
+	template<typename Resize, typename Write>
+	void upload(Resize&& resize, Write&& write) {
+		if (this->resized_) {
+			resize(this->vertexCapacity_, this->indexCapacity_);
+			this->resized_ = false;
+		}
+		for (auto& [key, chunk] : this->chunks_) {
+			if (!chunk.uploaded) {
+				write(static_cast<const Chunk&>(chunk));
+				chunk.uploaded = true;
+			}
+		}
+	}
+
+	/// Collect the chunks inside the frustum, skipping whole octree nodes outside it. Chunks further than
+	/// lodDistance from the eye use the next level of detail, every doubling of the distance a coarser one
+	CullStats cull(const Frustum& frustum, Vec3f eye, float lodDistance, std::vector<Draw>& draws) const {
+		PUZZLEMAKER_CE_PROFILE_ZONE("ChunkedMesh::cull");
+		draws.clear();
+		CullStats stats;
+		this->cullNode(frustum, eye, lodDistance, 0, 0, {-this->worldHalfSize_, -this->worldHalfSize_, -this->worldHalfSize_}, draws, stats);
+		return stats;
+	}
+
+	/// Half size of the cells a level of detail is meshed with
+	[[nodiscard]] int getLodHalfSize(int level) const {
+		return level == 0 ? 1 : std::max(this->chunkSize_ >> (LOD_LEVELS + 1 - level), 1);
+	}
+
+	/// Call func(chunk) for every chunk holding faces
+	template<typename F>
+	void forEachChunk(F&& func) const {
+		for (const auto& [key, chunk] : this->chunks_) {
+			func(chunk);
+		}
+	}
+
+	[[nodiscard]] const std::vector<D>& materials() const {
+		return this->materials_;
+	}
+
+	[[nodiscard]] std::size_t chunkCount() const {
+		return this->chunks_.size();
+	}
+
+	[[nodiscard]] int chunkSize() const {
+		return this->chunkSize_;
+	}
+
+	/// Chunks rebuilt by the last update
+	[[nodiscard]] std::size_t rebuiltChunks() const {
+		return this->rebuiltChunks_;
+	}
+
+	/// Chunks rebuilt by every update so far
+	[[nodiscard]] std::size_t totalRebuiltChunks() const {
+		return this->totalRebuiltChunks_;
+	}
+
+private:
+	/// Chunks are keyed by the Morton code of their coordinates, so the chunks under an octree node are contiguous
+	[[nodiscard]] std::uint64_t getKey(int x, int y, int z) const {
+		std::uint64_t key = 0;
+		for (int bit = this->splitDepth_ - 1; bit >= 0; bit--) {
+			key = (key << 3) | (((x >> bit) & 1) << 2) | (((y >> bit) & 1) << 1) | ((z >> bit) & 1);
+		}
+		return key;
+	}
+
+	/// The node at the given depth holds the chunks keyed [prefix << shift, (prefix + 1) << shift)
+	// NOLINTNEXTLINE(*-no-recursion)
+	void cullNode(const Frustum& frustum, Vec3f eye, float lodDistance, std::uint64_t prefix, int depth, Vec3i min, std::vector<Draw>& draws, CullStats& stats) const {
+		const int shift = (this->splitDepth_ - depth) * 3;
+		const auto first = this->chunks_.lower_bound(prefix << shift);
+		const auto last = this->chunks_.lower_bound((prefix + 1) << shift);
+		if (first == last) {
+			return;
+		}
+		stats.visitedNodes++;
+		const int size = this->chunkSize_ << (this->splitDepth_ - depth);
+		const auto containment = frustum.classify({min, {min.x + size, min.y + size, min.z + size}});
+		if (containment == Frustum::Containment::OUTSIDE) {
+			stats.culledNodes++;
+			for (auto it = first; it != last; ++it) {
+				stats.culledChunks++;
+				stats.culledTriangles += it->second.lods[0].indexCount / 3;
+			}
+			return;
+		}
+		if (containment == Frustum::Containment::INSIDE || depth == this->splitDepth_) {
+			for (auto it = first; it != last; ++it) {
+				this->select(it->second, eye, lodDistance, draws, stats);
+			}
+			return;
+		}
+		const int half = size / 2;
+		for (int child = 0; child < 8; child++) {
+			const Vec3i childMin{min.x + (child & 4 ? half : 0), min.y + (child & 2 ? half : 0), min.z + (child & 1 ? half : 0)};
+			this->cullNode(frustum, eye, lodDistance, (prefix << 3) | child, depth + 1, childMin, draws, stats);
+		}
+	}
+
+	/// Pick the level of detail of a visible chunk by the distance from the eye to the closest point of the chunk
+	void select(const Chunk& chunk, Vec3f eye, float lodDistance, std::vector<Draw>& draws, CullStats& stats) const {
+		const auto getDistance = [this](float coordinate, int min) {
+			return std::max({static_cast<float>(min) - coordinate, coordinate - static_cast<float>(min + this->chunkSize_), 0.f});
+		};
+		const auto dx = getDistance(eye.x, chunk.position.x);
+		const auto dy = getDistance(eye.y, chunk.position.y);
+		const auto dz = getDistance(eye.z, chunk.position.z);
+		const auto distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+		int level = 0;
+		for (auto threshold = lodDistance; level + 1 < LOD_LEVELS && threshold > 0.f && distance >= threshold; threshold *= 2.f) {
+			level++;
+		}
+		const auto& lod = chunk.lods[level];
+		draws.push_back({chunk.indices.offset + lod.firstIndex, lod.indexCount, chunk.vertices.offset, level});
+		stats.drawnChunks++;
+		stats.drawnTriangles += lod.indexCount / 3;
+		stats.lodTriangles += (chunk.lods[0].indexCount - std::min(chunk.lods[0].indexCount, lod.indexCount)) / 3;
+	}
+
+	/// Mark every chunk intersecting the box
+	void mark(const AABB& box) {
+		const AABB world{{-this->worldHalfSize_, -this->worldHalfSize_, -this->worldHalfSize_}, {this->worldHalfSize_, this->worldHalfSize_, this->worldHalfSize_}};
+		if (!box.intersects(world)) {
+			return;
+		}
+		const auto area = box.intersection(world);
+		const auto min = this->getChunkCoordinates(area.min);
+		const auto max = this->getChunkCoordinates({area.max.x - 1, area.max.y - 1, area.max.z - 1});
+		for (int x = min.x; x <= max.x; x++) {
+			for (int y = min.y; y <= max.y; y++) {
+				for (int z = min.z; z <= max.z; z++) {
+					auto& chunk = this->chunks_[this->getKey(x, y, z)];
+					chunk.position = {
+						x * this->chunkSize_ - this->worldHalfSize_,
+						y * this->chunkSize_ - this->worldHalfSize_,
+						z * this->chunkSize_ - this->worldHalfSize_,
+					};
+					chunk.dirty = true;
+				}
+			}
+		}
+	}
+
+	[[nodiscard]] Vec3i getChunkCoordinates(Vec3i position) const {
+		return {
+			(position.x + this->worldHalfSize_) / this->chunkSize_,
+			(position.y + this->worldHalfSize_) / this->chunkSize_,
+			(position.z + this->worldHalfSize_) / this->chunkSize_,
+		};
+	}
+
+	[[nodiscard]] std::size_t getMaterial(const D& data) {
+		const std::size_t material = std::find(this->materials_.begin(), this->materials_.end(), data) - this->materials_.begin();
+		if (material == this->materials_.size()) {
+			this->materials_.push_back(data);
+		}
+		return material;
+	}
+
+	/// Keep the chunk's ranges if its mesh still fits, otherwise append new ones at the end of the buffers
+	void allocate(Chunk& chunk) {
+		const auto vertexCount = static_cast<std::uint32_t>(chunk.mesh.vertices.size());
+		const auto indexCount = static_cast<std::uint32_t>(chunk.mesh.indices.size());
+		if (chunk.vertices.capacity >= vertexCount && chunk.indices.capacity >= indexCount) {
+			return;
+		}
+		if (this->vertexEnd_ + vertexCount > this->vertexCapacity_ || this->indexEnd_ + indexCount > this->indexCapacity_) {
+			this->needsLayout_ = true;
+			return;
+		}
+		chunk.vertices = {this->vertexEnd_, vertexCount};
+		chunk.indices = {this->indexEnd_, indexCount};
+		this->vertexEnd_ += vertexCount;
+		this->indexEnd_ += indexCount;
+	}
+
+	/// Pack every chunk at the start of new buffers, leaving room to append as many again
+	void layout() {
+		this->vertexEnd_ = 0;
+		this->indexEnd_ = 0;
+		for (auto& [key, chunk] : this->chunks_) {
+			chunk.vertices = {this->vertexEnd_, static_cast<std::uint32_t>(chunk.mesh.vertices.size())};
+			chunk.indices = {this->indexEnd_, static_cast<std::uint32_t>(chunk.mesh.indices.size())};
+			chunk.uploaded = false;
+			this->vertexEnd_ += chunk.vertices.capacity;
+			this->indexEnd_ += chunk.indices.capacity;
+		}
+		this->vertexCapacity_ = this->vertexEnd_ * 2;
+		this->indexCapacity_ = this->indexEnd_ * 2;
+		this->needsLayout_ = false;
+		this->resized_ = true;
+	}
+
+	int worldHalfSize_;
+	int chunkSize_;
+	int chunksPerAxis_;
+	/// Depth of the octree nodes the chunks are aligned to
+	int splitDepth_ = 0;
+
+	std::map<std::uint64_t, Chunk> chunks_;
+	std::vector<D> materials_;
+
+	std::uint32_t vertexEnd_ = 0;
+	std::uint32_t vertexCapacity_ = 0;
+	std::uint32_t indexEnd_ = 0;
+	std::uint32_t indexCapacity_ = 0;
+	bool needsLayout_ = false;
+	bool resized_ = false;
+
+	std::size_t rebuiltChunks_ = 0;
+	std::size_t totalRebuiltChunks_ = 0;
+};
@@ -1,24 +1,45 @@
 #include "Editor.h"
 
+#include <chrono>
+#include <utility>
+
 #include <QMessageBox>
+#include <QPainter>
 #include <QStyleOption>
 
+namespace {
+
+[[nodiscard]] float getMillisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
 Editor::Editor(QWidget* parent)
 	: QOpenGLWidget(parent)
 	, QOpenGLFunctions_3_2_Core()
-	, chamberVertexCount(0)
+	, world(std::make_shared<World>())
 	, distance(0)
 	, fov(30.f) {}
 
+World& Editor::getWorld() {
+	return *this->world;
+}
+
+std::shared_ptr<World> Editor::getSharedWorld() const {
+	return this->world;
+}
+
+void Editor::setWorld(std::shared_ptr<World> world_) {
+	this->world = std::move(world_);
+	this->update();
+}
+
 void Editor::initializeGL() {
-	if (!this->initializeOpenGLFunctions()) {
+	if (!this->initializeOpenGLFunctions() || !this->renderer.initialize()) {
 		QMessageBox::critical(this, tr("Error"), tr("Unable to initialize OpenGL 3.2 Core context! Please upgrade your computer to preview models."));
 		return; // and probably crash right after
 	}
-
-	this->shaderProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/chamber.vert");
-	this->shaderProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/chamber.frag");
-	this->shaderProgram.link();
 }
 
 void Editor::resizeGL(int w, int h) {
@@ -31,6 +52,9 @@ void Editor::resizeGL(int w, int h) {
 }
 
 void Editor::paintGL() {
+	PUZZLEMAKER_CE_PROFILE_ZONE("Editor::paintGL");
+	const auto frameStart = std::chrono::steady_clock::now();
+
 	QStyleOption opt;
 	opt.initFrom(this);
 
@@ -42,37 +66,31 @@ void Editor::paintGL() {
 	//this->glEnable(GL_DEPTH_TEST);
 	//this->glEnable(GL_CULL_FACE);
 
-	// testing
-	this->glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-	this->shaderProgram.bind();
-
 	QMatrix4x4 view;
-	QVector3D translation(this->target.x(), this->target.y(), -this->target.z() - this->distance);
-	view.translate(translation);
+	view.translate(this->target.x(), this->target.y(), -this->target.z() - this->distance);
 	view.rotate(this->rotation);
-	this->shaderProgram.setUniformValue("uMVP", this->projection * view);
-	this->shaderProgram.setUniformValue("uMV", view);
-	this->shaderProgram.setUniformValue("uNormalMatrix", view.normalMatrix());
-	this->shaderProgram.setUniformValue("uEyePosition", translation);
-	this->shaderProgram.setUniformValue("uMeshTexture", 0);
-	this->shaderProgram.setUniformValue("uMatCapTexture", 1);
-
-	this->chamberVertices.bind();
-
-	int offset = 0;
-	int vertexPosLocation = this->shaderProgram.attributeLocation("vPos");
-	this->shaderProgram.enableAttributeArray(vertexPosLocation);
-	this->shaderProgram.setAttributeBuffer(vertexPosLocation, GL_FLOAT, offset, 3, sizeof(Vec3f));
-
-	offset += sizeof(QVector3D);
-	int vertexNormalLocation = this->shaderProgram.attributeLocation("vUV");
-	this->shaderProgram.enableAttributeArray(vertexNormalLocation);
-	this->shaderProgram.setAttributeBuffer(vertexNormalLocation, GL_FLOAT, offset, 2, sizeof(Vec2f));
-
-	this->glDrawArrays(GL_TRIANGLES, 0, this->chamberVertexCount);
+	this->renderer.render(*this->world, this->projection, view);
+
+	if (this->frameStatsVisible) {
+		// The time of this frame is only known once it is drawn, show the last one
+		const auto& stats = this->renderer.getCullStats();
+		QPainter painter(this);
+		painter.setPen(opt.palette.color(QPalette::ColorRole::WindowText));
+		painter.drawText(this->rect().adjusted(8, 8, -8, -8), Qt::AlignLeft | Qt::AlignTop, tr("Frame: %1 ms\nMesh: %2 ms\nTriangles: %3 drawn, %4 culled, %5 skipped by LOD")
+			.arg(this->frameTime, 0, 'f', 2)
+			.arg(this->renderer.getFrameTimes().mesh, 0, 'f', 2)
+			.arg(stats.drawnTriangles)
+			.arg(stats.culledTriangles)
+			.arg(stats.lodTriangles));
+	}
+	this->frameTime = getMillisecondsSince(frameStart);
+}
 
-	this->chamberVertices.release();
+const ChunkedMesh<ChamberOctree>::CullStats& Editor::getCullStats() const {
+	return this->renderer.getCullStats();
+}
 
-	this->shaderProgram.release();
+void Editor::setFrameStatsVisible(bool visible) {
+	this->frameStatsVisible = visible;
+	this->update();
 }
@@ -1,11 +1,12 @@
 #pragma once
 
-#include <QOpenGLBuffer>
+#include <memory>
+
 #include <QOpenGLFunctions_3_2_Core>
-#include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
 #include <QOpenGLWidget>
 
+#include "ChamberRenderer.h"
 #include "World.h"
 
 class Editor : public QOpenGLWidget, protected QOpenGLFunctions_3_2_Core {
@@ -14,6 +15,20 @@ class Editor : public QOpenGLWidget, protected QOpenGLFunctions_3_2_Core {
 public:
 	explicit Editor(QWidget* parent = nullptr);
 
+	[[nodiscard]] World& getWorld();
+
+	/// The world shared with background work, which checks it is still the one being edited when it finishes
+	[[nodiscard]] std::shared_ptr<World> getSharedWorld() const;
+
+	/// Swap in a world built elsewhere, it is uploaded from scratch on the next frame
+	void setWorld(std::shared_ptr<World> world_);
+
+	/// What frustum culling and levels of detail skipped in the last frame
+	[[nodiscard]] const ChunkedMesh<ChamberOctree>::CullStats& getCullStats() const;
+
+	/// Draw the frame time, mesh time and triangle counts over the chamber
+	void setFrameStatsVisible(bool visible);
+
 protected:
 	void initializeGL() override;
 
@@ -22,11 +37,13 @@ protected:
 	void paintGL() override;
 
 private:
-	World world;
+	std::shared_ptr<World> world;
+
+	ChamberRenderer renderer;
 
-	QOpenGLShaderProgram shaderProgram;
-	QOpenGLBuffer chamberVertices{QOpenGLBuffer::Type::VertexBuffer};
-	int chamberVertexCount;
+	bool frameStatsVisible = false;
+	/// Milliseconds the CPU spent on the last frame
+	float frameTime = 0.f;
 
 	QMatrix4x4 projection;
 	float distance;
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <utility>
+
+/// Epoch based reclamation for one writer and any number of reader threads. Readers pin the epoch while they hold
+/// shared objects, the writer tags what it unlinks with the epoch and only reuses it once every reader pinned
+/// at or before that epoch has left. Pinning claims a reader slot with a compare-exchange, no locks are taken
+class EpochDomain {
+public:
+	/// Readers pinned at the same time, more spin until one leaves
+	static constexpr std::size_t MAX_READERS = 64;
+
+	/// Keeps its epoch pinned until destroyed
+	class Guard {
+	public:
+		Guard() = default;
+
+		Guard(const Guard&) = delete;
+		Guard& operator=(const Guard&) = delete;
+
+		Guard(Guard&& other) noexcept
+			: slot_(std::exchange(other.slot_, nullptr)) {}
+
+		Guard& operator=(Guard&& other) noexcept {
+			if (this != &other) {
+				this->reset();
+				this->slot_ = std::exchange(other.slot_, nullptr);
+			}
+			return *this;
+		}
+
+		~Guard() {
+			this->reset();
+		}
+
+		/// Leave the epoch, nothing loaded under the guard may be touched afterwards
+		void reset() {
+			if (this->slot_) {
+				this->slot_->store(0, std::memory_order_release);
+				this->slot_ = nullptr;
+			}
+		}
+
+	private:
+		friend class EpochDomain;
+
+		explicit Guard(std::atomic<std::uint64_t>& slot)
+			: slot_(&slot) {}
+
+		std::atomic<std::uint64_t>* slot_ = nullptr;
+	};
+
+	/// Pin the current epoch, from any thread. Load the shared objects after this, they stay valid while the guard lives
+	[[nodiscard]] Guard pin() {
+		const auto start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+		while (true) {
+			for (std::size_t i = 0; i < MAX_READERS; i++) {
+				auto& slot = this->slots_[(start + i) % MAX_READERS].epoch;
+				// Sequentially consistent like the writer's scan: either it sees this slot,
+				// or this reader's loads see everything the writer unlinked before scanning
+				std::uint64_t empty = 0;
+				if (slot.load(std::memory_order_relaxed) == 0 && slot.compare_exchange_strong(empty, this->epoch_.load())) {
+					return Guard(slot);
+				}
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	/// The epoch the writer tags retired objects with
+	[[nodiscard]] std::uint64_t getEpoch() const {
+		return this->epoch_.load();
+	}
+
+	/// Start a new epoch, call it after unlinking objects and before retiring them
+	void advance() {
+		this->epoch_.fetch_add(1);
+	}
+
+	/// Objects retired in an epoch below this one are out of reach of every reader
+	[[nodiscard]] std::uint64_t getSafeEpoch() const {
+		auto safe = this->epoch_.load() + 1;
+		for (const auto& slot : this->slots_) {
+			if (const auto epoch = slot.epoch.load(); epoch != 0) {
+				safe = std::min(safe, epoch);
+			}
+		}
+		return safe;
+	}
+
+private:
+	/// A cache line each, so readers pinning don't contend with each other
+	struct alignas(64) Slot {
+		/// The pinned epoch, or 0 if the slot is free
+		std::atomic<std::uint64_t> epoch{0};
+	};
+
+	std::atomic<std::uint64_t> epoch_{1};
+	std::array<Slot, MAX_READERS> slots_;
+};
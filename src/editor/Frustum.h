@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+
+#include <sourcepp/math/Vector.h>
+
+#include "AABB.h"
+
+using namespace sourcepp::math;
+
+/// The six clip planes of a view, pointing inwards
+struct Frustum {
+	struct Plane {
+		Vec3f normal;
+		float distance;
+
+		[[nodiscard]] float getSignedDistance(Vec3f point) const {
+			return this->normal.x * point.x + this->normal.y * point.y + this->normal.z * point.z + this->distance;
+		}
+	};
+
+	enum class Containment {
+		OUTSIDE,
+		INTERSECTS,
+		INSIDE,
+	};
+
+	std::array<Plane, 6> planes;
+
+	/// Extract the planes of a column-major OpenGL clip matrix, usually projection * view
+	[[nodiscard]] static Frustum fromMatrix(const float* matrix) {
+		const auto row = [matrix](int i) {
+			return std::array<float, 4>{matrix[i], matrix[4 + i], matrix[8 + i], matrix[12 + i]};
+		};
+		const auto w = row(3);
+		Frustum frustum; // NOLINT(*-member-init)
+		for (int axis = 0; axis < 3; axis++) {
+			const auto r = row(axis);
+			frustum.planes[axis * 2] = {{w[0] + r[0], w[1] + r[1], w[2] + r[2]}, w[3] + r[3]};
+			frustum.planes[axis * 2 + 1] = {{w[0] - r[0], w[1] - r[1], w[2] - r[2]}, w[3] - r[3]};
+		}
+		return frustum;
+	}
+
+	/// Conservative test, boxes near the corners of the frustum may be reported as intersecting while outside
+	[[nodiscard]] Containment classify(const AABB& box) const {
+		auto containment = Containment::INSIDE;
+		for (const auto& plane : this->planes) {
+			// The corners furthest along and against the plane normal
+			const Vec3f positive{
+				static_cast<float>(plane.normal.x >= 0.f ? box.max.x : box.min.x),
+				static_cast<float>(plane.normal.y >= 0.f ? box.max.y : box.min.y),
+				static_cast<float>(plane.normal.z >= 0.f ? box.max.z : box.min.z),
+			};
+			if (plane.getSignedDistance(positive) < 0.f) {
+				return Containment::OUTSIDE;
+			}
+			const Vec3f negative{
+				static_cast<float>(plane.normal.x >= 0.f ? box.min.x : box.max.x),
+				static_cast<float>(plane.normal.y >= 0.f ? box.min.y : box.max.y),
+				static_cast<float>(plane.normal.z >= 0.f ? box.min.z : box.max.z),
+			};
+			if (plane.getSignedDistance(negative) < 0.f) {
+				containment = Containment::INTERSECTS;
+			}
+		}
+		return containment;
+	}
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <vector>
+
+/// Undo and redo through saved versions of a tree. An Octree shares every block an edit did not touch between
+/// versions, so a step costs about as much memory as the blocks its edits copied. Once the steps use more memory
+/// than the budget, the oldest ones are forgotten. Versions die with their tree, clear the history before replacing it
+template<typename Tree>
+class History {
+public:
+	using Version = typename Tree::Version;
+
+	explicit History(std::size_t memoryBudget)
+		: memoryBudget_(memoryBudget) {}
+
+	History(const History&) = delete;
+	History& operator=(const History&) = delete;
+
+	/// Forget every step, the current tree is where undoing stops
+	void reset(Tree& tree) {
+		this->clear(tree);
+		this->lastMemoryUsage_ = tree.liveMemoryUsage();
+		this->current_ = Step{tree.saveVersion(), 0};
+	}
+
+	/// Release every version, the history records nothing until it is reset
+	void clear(Tree& tree) {
+		for (const auto& step : this->undo_) {
+			tree.releaseVersion(step.version);
+		}
+		for (const auto& step : this->redo_) {
+			tree.releaseVersion(step.version);
+		}
+		if (this->current_) {
+			tree.releaseVersion(this->current_->version);
+		}
+		this->undo_.clear();
+		this->redo_.clear();
+		this->current_.reset();
+		this->memoryUsage_ = 0;
+	}
+
+	/// Record the edits made since the last step as a new step. Steps that were undone can't be redone anymore
+	void commit(Tree& tree) {
+		if (!this->current_) {
+			return;
+		}
+		// Blocks copied by the edits, the previous version keeps the originals alive
+		const auto memoryUsage = tree.liveMemoryUsage();
+		const auto cost = memoryUsage > this->lastMemoryUsage_ ? memoryUsage - this->lastMemoryUsage_ : 0;
+		this->current_->cost += cost;
+		this->memoryUsage_ += cost;
+		this->undo_.push_back(std::move(*this->current_));
+		// Saving a version may take memory too, the step is charged for it once it is committed
+		this->lastMemoryUsage_ = memoryUsage;
+		this->current_ = Step{tree.saveVersion(), 0};
+
+		for (const auto& step : this->redo_) {
+			this->release(tree, step);
+		}
+		this->redo_.clear();
+		this->trim(tree);
+	}
+
+	/// Return the tree to the previous step. Edits must be committed first.
+	/// Returns the version the tree was in, or nullptr if there is nothing to undo
+	const Version* undo(Tree& tree) {
+		if (this->undo_.empty()) {
+			return nullptr;
+		}
+		this->redo_.push_back(std::move(*this->current_));
+		this->current_ = std::move(this->undo_.back());
+		this->undo_.pop_back();
+		tree.restoreVersion(this->current_->version);
+		return &this->redo_.back().version;
+	}
+
+	/// Return the tree to the step that was last undone.
+	/// Returns the version the tree was in, or nullptr if there is nothing to redo
+	const Version* redo(Tree& tree) {
+		if (this->redo_.empty()) {
+			return nullptr;
+		}
+		this->undo_.push_back(std::move(*this->current_));
+		this->current_ = std::move(this->redo_.back());
+		this->redo_.pop_back();
+		tree.restoreVersion(this->current_->version);
+		return &this->undo_.back().version;
+	}
+
+	[[nodiscard]] bool canUndo() const {
+		return !this->undo_.empty();
+	}
+
+	[[nodiscard]] bool canRedo() const {
+		return !this->redo_.empty();
+	}
+
+	[[nodiscard]] std::size_t undoCount() const {
+		return this->undo_.size();
+	}
+
+	[[nodiscard]] std::size_t redoCount() const {
+		return this->redo_.size();
+	}
+
+	/// Bytes kept alive only for undo and redo
+	[[nodiscard]] std::size_t memoryUsage() const {
+		return this->memoryUsage_;
+	}
+
+	[[nodiscard]] std::size_t memoryBudget() const {
+		return this->memoryBudget_;
+	}
+
+	void setMemoryBudget(Tree& tree, std::size_t memoryBudget) {
+		this->memoryBudget_ = memoryBudget;
+		this->trim(tree);
+	}
+
+private:
+	struct Step {
+		Version version;
+		/// Bytes the version keeps alive that newer versions don't use
+		std::size_t cost;
+	};
+
+	/// Forget the oldest steps until the rest fit in the budget
+	void trim(Tree& tree) {
+		while (this->memoryUsage_ > this->memoryBudget_ && !this->undo_.empty()) {
+			this->release(tree, this->undo_.front());
+			this->undo_.pop_front();
+		}
+	}
+
+	void release(Tree& tree, const Step& step) {
+		const auto memoryUsage = tree.liveMemoryUsage();
+		tree.releaseVersion(step.version);
+		// Memory freed now is not part of the next step
+		const auto freed = memoryUsage - tree.liveMemoryUsage();
+		this->lastMemoryUsage_ -= std::min(this->lastMemoryUsage_, freed);
+		this->memoryUsage_ -= std::min(this->memoryUsage_, step.cost);
+	}
+
+	std::deque<Step> undo_;
+	std::vector<Step> redo_;
+	std::optional<Step> current_;
+	std::size_t memoryUsage_ = 0;
+	std::size_t memoryBudget_;
+	std::size_t lastMemoryUsage_ = 0;
+};
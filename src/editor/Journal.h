@@ -0,0 +1,382 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include <sourcepp/math/Vector.h>
+
+#include "AABB.h"
+#include "ChamberFile.h"
+#include "MappedFile.h"
+
+using namespace sourcepp::math;
+
+/// Append-only log of the edits made to a chamber since its .pzce file was last written in full, kept next to it.
+/// Saving appends the new records instead of rewriting the chamber, loading applies them on top of the chamber.
+/// Every integer is little endian.
+///
+///   header   "PZCJ", u32 version, u64 checksum of the chamber file the records apply to, u64 checksum
+///   records  u8 type, the fields of the type, u64 checksum of the record
+///
+/// Only records followed by a commit are part of the saved chamber. Records after the last commit were flushed
+/// while editing and are only applied to recover from a crash
+template<typename D>
+class Journal {
+public:
+	enum class RecordType : std::uint8_t {
+		/// i32 x, y, z of the node, then its data as written by PaletteEntry<D>
+		SET,
+		/// i32 min x, y, z and max x, y, z of the box, then the data it was filled with
+		FILL,
+		/// Everything before is saved
+		COMMIT,
+	};
+
+	struct Record {
+		RecordType type = RecordType::COMMIT;
+		Vec3i position;
+		AABB box;
+		D data;
+	};
+
+	static constexpr std::array<char, 4> MAGIC{'P', 'Z', 'C', 'J'};
+	static constexpr std::uint32_t VERSION = 1;
+	static constexpr std::uint64_t HEADER_SIZE = MAGIC.size() + sizeof(std::uint32_t) + sizeof(std::uint64_t) * 2;
+
+	/// Where the journal of a chamber file lives
+	[[nodiscard]] static std::filesystem::path getPath(const std::filesystem::path& chamberPath) {
+		auto path = chamberPath;
+		path += ".journal";
+		return path;
+	}
+
+	/// Buffer an edit for the next flush. Without a journal file the next save is a full one, so nothing is buffered
+	/// unless a snapshot is being written, the edits made meanwhile go to the journal it is rebased onto
+	void recordSet(Vec3i position, const D& data) {
+		if (!this->isRecording()) {
+			return;
+		}
+		RecordWriter writer(this->pending_);
+		writer.writeInt(static_cast<std::uint8_t>(RecordType::SET));
+		Journal::writePosition(writer, position);
+		PaletteEntry<D>::write(writer, data);
+		writer.finish();
+	}
+
+	void recordFill(const AABB& box, const D& data) {
+		if (!this->isRecording()) {
+			return;
+		}
+		RecordWriter writer(this->pending_);
+		writer.writeInt(static_cast<std::uint8_t>(RecordType::FILL));
+		Journal::writePosition(writer, box.min);
+		Journal::writePosition(writer, box.max);
+		PaletteEntry<D>::write(writer, data);
+		writer.finish();
+	}
+
+	/// True if records are appended to a journal file, otherwise the chamber has to be saved in full
+	[[nodiscard]] bool isOpen() const {
+		return !this->path_.empty();
+	}
+
+	/// Records not written to the journal file yet
+	[[nodiscard]] bool hasPending() const {
+		return !this->pending_.view().empty();
+	}
+
+	/// Bytes in the journal file
+	[[nodiscard]] std::uint64_t size() const {
+		return this->size_;
+	}
+
+	/// Append the buffered records to the journal file. If committing, they become part of the saved chamber
+	/// along with every record flushed before. Records that could not be written stay buffered
+	[[nodiscard]] bool flush(bool commit) {
+		if (!this->isOpen()) {
+			return false;
+		}
+		if (commit && (this->hasPending() || this->committed_ < this->size_)) {
+			RecordWriter writer(this->pending_);
+			writer.writeInt(static_cast<std::uint8_t>(RecordType::COMMIT));
+			writer.finish();
+		}
+		const auto records = this->pending_.view();
+		if (records.empty()) {
+			return true;
+		}
+		{
+			std::ofstream file(this->path_, std::ios::binary | std::ios::app);
+			if (file.write(records.data(), static_cast<std::streamsize>(records.size())) && file.flush()) {
+				this->size_ += records.size();
+				if (commit) {
+					this->committed_ = this->size_;
+				}
+				this->pending_.str({});
+				return true;
+			}
+		}
+		// Records appended after a partial one would never be read
+		std::error_code error;
+		std::filesystem::resize_file(this->path_, this->size_, error);
+		return false;
+	}
+
+	/// Drop the buffered records, they are part of a snapshot of the chamber about to be written in full. Edits are
+	/// buffered from then on until the journal is rebased onto the snapshot or closed, even without a journal file.
+	/// Returns the size of the journal file the snapshot covers, to rebase onto the snapshot once it is written
+	std::uint64_t snapshot() {
+		this->pending_.str({});
+		this->snapshotPending_ = true;
+		return this->size_;
+	}
+
+	/// Start over with a journal at the given path for the chamber file with the given checksum, written from a
+	/// snapshot taken when this journal was offset bytes long. Records flushed after the snapshot are carried over.
+	/// The journal is closed if the new one can't be written
+	[[nodiscard]] bool rebase(const std::filesystem::path& path, std::uint64_t base, std::uint64_t offset) {
+		std::ostringstream contents;
+		{
+			RecordWriter writer(contents);
+			writer.write(MAGIC.data(), MAGIC.size());
+			writer.writeInt(VERSION);
+			writer.writeInt(base);
+			writer.finish();
+		}
+		auto committed = HEADER_SIZE;
+		if (this->isOpen() && offset >= HEADER_SIZE && offset < this->size_) {
+			const MappedFile file(this->path_);
+			if (!file || file.data().size() < this->size_) {
+				this->close();
+				return false;
+			}
+			const auto tail = file.data().subspan(offset, this->size_ - offset);
+			contents.write(reinterpret_cast<const char*>(tail.data()), static_cast<std::streamsize>(tail.size()));
+			if (this->committed_ > offset) {
+				committed += this->committed_ - offset;
+			}
+		}
+
+		// Written next to the journal first, so a crash leaves either the old journal or the new one
+		auto temporary = path;
+		temporary += ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			const auto bytes = contents.view();
+			if (!file.write(bytes.data(), static_cast<std::streamsize>(bytes.size())) || !file.flush()) {
+				file.close();
+				std::error_code error;
+				std::filesystem::remove(temporary, error);
+				this->close();
+				return false;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(temporary, path, error);
+		if (error) {
+			this->close();
+			return false;
+		}
+		this->path_ = path;
+		this->size_ = contents.view().size();
+		this->committed_ = committed;
+		this->snapshotPending_ = false;
+		return true;
+	}
+
+	/// The snapshot won't be rebased onto. Without a journal file the edits buffered for it are dropped, the next
+	/// save is a full one
+	void abandonSnapshot() {
+		this->snapshotPending_ = false;
+		if (!this->isOpen()) {
+			this->pending_.str({});
+		}
+	}
+
+	/// Stop appending to the journal file, the chamber has to be saved in full from now on. Buffered records are
+	/// dropped, including the ones kept for a snapshot that won't be rebased onto
+	void close() {
+		this->path_.clear();
+		this->pending_.str({});
+		this->snapshotPending_ = false;
+	}
+
+	/// Forget the edits that were never saved, buffered or flushed. Call when the chamber is closed without saving
+	void discardUncommitted() {
+		this->pending_.str({});
+		if (!this->isOpen() || this->committed_ == this->size_) {
+			return;
+		}
+		std::error_code error;
+		std::filesystem::resize_file(this->path_, this->committed_, error);
+		if (!error) {
+			this->size_ = this->committed_;
+		}
+	}
+
+	/// Apply the journal of a chamber file to the tree loaded from it, records are appended to this journal from then on.
+	/// Records after the last commit are only applied when recovering, otherwise they are dropped. A journal for
+	/// another version of the chamber file is replaced by an empty one. Returns the number of records applied
+	template<typename Tree>
+	std::size_t replay(Tree& tree, const std::filesystem::path& chamberPath, std::uint64_t base, bool recover) {
+		const auto path = Journal::getPath(chamberPath);
+		this->close();
+		this->pending_.str({});
+
+		std::uint64_t end = 0;
+		std::uint64_t committed = HEADER_SIZE;
+		std::size_t applied = 0;
+		{
+			const MappedFile file(path);
+			if (file) {
+				applied = Journal::apply(tree, file.data(), base, recover, end, committed);
+			}
+		}
+		if (end == 0) {
+			// Nothing worth keeping, the records would not apply to this chamber
+			static_cast<void>(this->rebase(path, base, 0));
+			return 0;
+		}
+
+		// Damaged records at the end, and unsaved ones unless recovering, are cut off
+		const auto keep = recover ? end : committed;
+		std::error_code error;
+		std::filesystem::resize_file(path, keep, error);
+		if (error) {
+			return applied;
+		}
+		this->path_ = path;
+		this->size_ = keep;
+		this->committed_ = committed;
+		return applied;
+	}
+
+	/// Apply the saved edits in the journal of a chamber file to the tree loaded from it, leaving the journal
+	/// as it is for the editor. Returns the number of records applied
+	template<typename Tree>
+	static std::size_t applySaved(Tree& tree, const std::filesystem::path& chamberPath, std::uint64_t base) {
+		const MappedFile file(Journal::getPath(chamberPath));
+		if (!file) {
+			return 0;
+		}
+		std::uint64_t end = 0;
+		std::uint64_t committed = HEADER_SIZE;
+		return Journal::apply(tree, file.data(), base, false, end, committed);
+	}
+
+	/// Call a function with every record of a journal for the given chamber checksum and the offset right after it,
+	/// in order up to the first damaged record. Returns the offset after the last good record, or 0 if the header
+	/// is damaged or for another chamber file
+	template<typename F>
+	static std::uint64_t forEachRecord(std::span<const std::byte> data, std::uint64_t base, F&& callback) {
+		if (data.size() < HEADER_SIZE) {
+			return 0;
+		}
+		ChamberFile::Checksum headerChecksum;
+		headerChecksum.update(data.first(HEADER_SIZE - sizeof(std::uint64_t)));
+		ChamberFile::Reader header(data.first(HEADER_SIZE));
+		std::array<char, 4> magic; // NOLINT(*-member-init)
+		std::uint32_t version;
+		std::uint64_t fileBase, checksum;
+		if (!header.read(magic.data(), magic.size()) || magic != MAGIC || !header.readInt(version) || version != VERSION ||
+		    !header.readInt(fileBase) || fileBase != base || !header.readInt(checksum) || checksum != headerChecksum.value()) {
+			return 0;
+		}
+
+		ChamberFile::Reader reader(data.subspan(HEADER_SIZE));
+		auto end = HEADER_SIZE;
+		while (!reader.remaining().empty()) {
+			const auto start = reader.remaining();
+			Record record;
+			std::uint8_t type;
+			if (!reader.readInt(type)) {
+				break;
+			}
+			record.type = static_cast<RecordType>(type);
+			bool valid = false;
+			switch (record.type) {
+				case RecordType::SET:
+					valid = Journal::readPosition(reader, record.position) && PaletteEntry<D>::read(reader, record.data);
+					break;
+				case RecordType::FILL:
+					valid = Journal::readPosition(reader, record.box.min) && Journal::readPosition(reader, record.box.max) && PaletteEntry<D>::read(reader, record.data);
+					break;
+				case RecordType::COMMIT:
+					valid = true;
+					break;
+			}
+			ChamberFile::Checksum recordChecksum;
+			recordChecksum.update(start.first(start.size() - reader.remaining().size()));
+			if (!valid || !reader.readInt(checksum) || checksum != recordChecksum.value()) {
+				break;
+			}
+			end = data.size() - reader.remaining().size();
+			callback(record, end);
+		}
+		return end;
+	}
+
+private:
+	/// Records are a few bytes, longer texture names just take a couple of flushes
+	using RecordWriter = ChamberFile::BasicWriter<64>;
+
+	/// Apply the records of journal data up to the last commit, or every good record when recovering. Sets end to the
+	/// offset after the last good record, 0 if the journal is for another chamber, and committed to the offset after
+	/// the last commit. Returns the number of records applied
+	template<typename Tree>
+	static std::size_t apply(Tree& tree, std::span<const std::byte> data, std::uint64_t base, bool recover, std::uint64_t& end, std::uint64_t& committed) {
+		end = Journal::forEachRecord(data, base, [&committed](const Record& record, std::uint64_t recordEnd) {
+			if (record.type == RecordType::COMMIT) {
+				committed = recordEnd;
+			}
+		});
+		if (end == 0) {
+			return 0;
+		}
+		std::size_t applied = 0;
+		Journal::forEachRecord(data.first(recover ? end : committed), base, [&tree, &applied](const Record& record, std::uint64_t) {
+			if (record.type == RecordType::SET && tree.set(record.position, record.data)) {
+				applied++;
+			} else if (record.type == RecordType::FILL) {
+				tree.fill(record.box, record.data);
+				applied++;
+			}
+		});
+		return applied;
+	}
+
+	/// True if edits are buffered, for the journal file or for the snapshot being written
+	[[nodiscard]] bool isRecording() const {
+		return this->isOpen() || this->snapshotPending_;
+	}
+
+	static void writePosition(RecordWriter& writer, Vec3i position) {
+		writer.writeInt(static_cast<std::int32_t>(position.x));
+		writer.writeInt(static_cast<std::int32_t>(position.y));
+		writer.writeInt(static_cast<std::int32_t>(position.z));
+	}
+
+	[[nodiscard]] static bool readPosition(ChamberFile::Reader& reader, Vec3i& position) {
+		std::int32_t x, y, z;
+		if (!reader.readInt(x) || !reader.readInt(y) || !reader.readInt(z)) {
+			return false;
+		}
+		position = {x, y, z};
+		return true;
+	}
+
+	std::filesystem::path path_;
+	std::uint64_t size_ = 0;
+	/// Bytes of the journal file that are part of the saved chamber
+	std::uint64_t committed_ = 0;
+	std::ostringstream pending_{std::ios::binary};
+	/// A snapshot was taken and is not rebased onto yet
+	bool snapshotPending_ = false;
+};
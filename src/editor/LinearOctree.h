@@ -0,0 +1,559 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "Octree.h"
+
+/// Pointer-free octree that only stores its leaves, sorted by the Morton code of their minimum corner.
+/// Exposes the same surface as Octree, every lookup is a binary search over a flat array
+template<typename D>
+class LinearOctree {
+public:
+	class Node {
+	public:
+		[[nodiscard]] bool hasChildren() const {
+			return false;
+		}
+
+		[[nodiscard]] const D& data() const {
+			return this->data_;
+		}
+
+		/// Morton code of the smallest cell in the corner of this leaf
+		[[nodiscard]] std::uint64_t code() const {
+			return this->code_;
+		}
+
+		[[nodiscard]] int halfSize() const {
+			return this->halfSize_;
+		}
+
+	private:
+		friend class LinearOctree;
+
+		Node(std::uint64_t code, D data, int halfSize)
+			: code_(code)
+			, data_(std::move(data))
+			, halfSize_(halfSize) {}
+
+		std::uint64_t code_;
+		D data_;
+		int halfSize_;
+	};
+
+	using Hit = RayHit<Node>;
+
+	/// A copy of every leaf, versions of a linear octree share nothing
+	using Version = std::shared_ptr<const std::vector<Node>>;
+
+	explicit LinearOctree(int size)
+		: rootHalfSize_(size / 2) {
+		this->clear();
+	}
+
+	/// Copy of the current leaves, saved versions are not copied
+	LinearOctree(const LinearOctree& other)
+		: rootHalfSize_(other.rootHalfSize_)
+		, leaves_(other.leaves_) {}
+
+	LinearOctree& operator=(const LinearOctree& other) {
+		if (this != &other) {
+			*this = LinearOctree(other);
+		}
+		return *this;
+	}
+
+	LinearOctree(LinearOctree&&) noexcept = default;
+	LinearOctree& operator=(LinearOctree&&) noexcept = default;
+
+	/// Set voxel data in the octree. Siblings left holding equal data are merged back into their parent
+	[[nodiscard]] bool set(Vec3i position, const D& data, bool forceMerge = false) {
+		const auto targetHalfSize = Octree<D>::getHalfSizeFromPosition(this->rootHalfSize_, position);
+		if (!targetHalfSize) {
+			return false;
+		}
+		const auto code = this->getCodeFromPosition({position.x - targetHalfSize, position.y - targetHalfSize, position.z - targetHalfSize});
+		const auto leaf = this->findLeaf(code);
+		if (leaf->halfSize_ == targetHalfSize) {
+			leaf->data_ = data;
+			this->mergeUp(code, targetHalfSize);
+			return true;
+		}
+		if (leaf->halfSize_ < targetHalfSize) {
+			if (!forceMerge) {
+				return false;
+			}
+			const auto last = std::lower_bound(leaf, this->leaves_.end(), code + LinearOctree::getCellCount(targetHalfSize), [](const Node& node, std::uint64_t value) {
+				return node.code_ < value;
+			});
+			*leaf = Node(code, data, targetHalfSize);
+			this->leaves_.erase(leaf + 1, last);
+			this->mergeUp(code, targetHalfSize);
+			return true;
+		}
+		if (leaf->data_ == data) {
+			// Already covered by a leaf holding this data
+			return true;
+		}
+
+		// Split the leaf down to the target, siblings keep the old data
+		std::vector<Node> split;
+		const Node old = *leaf;
+		auto splitCode = old.code_;
+		for (int halfSize = old.halfSize_ / 2; halfSize >= targetHalfSize; halfSize /= 2) {
+			const auto cellCount = LinearOctree::getCellCount(halfSize);
+			const auto targetIndex = (code - splitCode) / cellCount;
+			for (std::uint64_t i = 0; i < 8; i++) {
+				if (i != targetIndex) {
+					split.push_back(Node(splitCode + i * cellCount, old.data_, halfSize));
+				}
+			}
+			splitCode += targetIndex * cellCount;
+		}
+		split.push_back(Node(code, data, targetHalfSize));
+		std::sort(split.begin(), split.end(), [](const Node& lhs, const Node& rhs) {
+			return lhs.code_ < rhs.code_;
+		});
+		const auto offset = leaf - this->leaves_.begin();
+		this->leaves_[offset] = split.front();
+		this->leaves_.insert(this->leaves_.begin() + offset + 1, split.begin() + 1, split.end());
+		return true;
+	}
+
+	/// Get the leaf containing the given position. Returns nullptr if the position lies on a node boundary.
+	/// The pointer is invalidated by the next modification of the octree
+	[[nodiscard]] const Node* get(Vec3i position) const {
+		if (Octree<D>::isPositionOnBounds(Vec3i::zero(), this->rootHalfSize_, position)) {
+			return nullptr;
+		}
+		const auto& leaf = *this->findLeaf(this->getCodeFromPosition(position));
+		if (Octree<D>::isPositionOnBounds(this->getPositionFromCode(leaf.code_, leaf.halfSize_), leaf.halfSize_, position)) {
+			return nullptr;
+		}
+		return &leaf;
+	}
+
+	/// Check if a node centered on the given position exists
+	[[nodiscard]] bool exists(Vec3i position) const {
+		const auto targetHalfSize = Octree<D>::getHalfSizeFromPosition(this->rootHalfSize_, position);
+		if (!targetHalfSize) {
+			return false;
+		}
+		return this->findLeaf(this->getCodeFromPosition(position))->halfSize_ <= targetHalfSize;
+	}
+
+	/// Set every voxel inside the box. Nodes fully inside the box are assigned in one step,
+	/// only nodes crossing its boundary are subdivided. Unit voxels are filled if their center is inside
+	void fill(const AABB& box, const D& data) {
+		// Only the leaves under the smallest node containing the box are rebuilt
+		Vec3i position = Vec3i::zero();
+		int halfSize = this->rootHalfSize_;
+		while (halfSize > 1) {
+			const auto index = Octree<D>::getIndexFromPosition(position, {box.min.x + 1, box.min.y + 1, box.min.z + 1});
+			const auto childPosition = Octree<D>::getPositionFromIndex(position, halfSize, index);
+			if (!AABB::fromNode(childPosition, halfSize / 2).encloses(box)) {
+				break;
+			}
+			position = childPosition;
+			halfSize /= 2;
+		}
+		auto code = this->getCodeFromPosition({position.x - halfSize, position.y - halfSize, position.z - halfSize});
+		auto first = this->findLeaf(code);
+		auto last = first + 1;
+		if (first->halfSize_ > halfSize) {
+			code = first->code_;
+			halfSize = first->halfSize_;
+			position = this->getPositionFromCode(code, halfSize);
+		} else {
+			last = std::lower_bound(first, this->leaves_.end(), code + LinearOctree::getCellCount(halfSize), [](const Node& node, std::uint64_t value) {
+				return node.code_ < value;
+			});
+		}
+
+		std::vector<Node> leaves;
+		this->fill(leaves, code, position, halfSize, nullptr, first, last, box, data);
+		const auto offset = first - this->leaves_.begin();
+		this->leaves_.erase(this->leaves_.begin() + offset + 1, last);
+		this->leaves_[offset] = leaves.front();
+		this->leaves_.insert(this->leaves_.begin() + offset + 1, leaves.begin() + 1, leaves.end());
+		if (leaves.size() == 1) {
+			this->mergeUp(code, halfSize);
+		}
+	}
+
+	/// Reset every voxel inside the box to empty
+	void clear(const AABB& box) {
+		this->fill(box, D{});
+	}
+
+	/// Merge every group of 8 sibling leaves holding equal data, bottom-up.
+	/// Only needed for trees that were not built through set(), which merges as it goes
+	void simplify() {
+		std::vector<Node> leaves;
+		leaves.reserve(this->leaves_.size());
+		for (const auto& leaf : this->leaves_) {
+			this->appendMerged(leaves, leaf);
+		}
+		this->leaves_ = std::move(leaves);
+	}
+
+	/// Find the first solid leaf along the ray. Empty nodes are crossed in one step, whatever their size
+	[[nodiscard]] std::optional<Hit> raycast(const Ray& ray) const {
+		std::optional<Hit> hit;
+		const auto slabs = ray.getSlabs(AABB::fromNode(Vec3i::zero(), this->rootHalfSize_));
+		this->raycast(ray, ray.getChildOrderMask(), slabs, 0, Vec3i::zero(), this->rootHalfSize_, hit);
+		return hit;
+	}
+
+	[[nodiscard]] std::optional<Hit> raycast(Vec3f origin, Vec3f direction, float maxDistance) const {
+		return this->raycast(Ray{origin, direction, maxDistance});
+	}
+
+	/// Cast every ray, spread over the pool if one is given
+	[[nodiscard]] std::vector<std::optional<Hit>> raycast(const std::vector<Ray>& rays, ThreadPool* pool = nullptr) const {
+		std::vector<std::optional<Hit>> hits(rays.size());
+		const auto cast = [this, &rays, &hits](std::size_t batch) {
+			const auto last = std::min((batch + 1) * RAYCAST_BATCH_SIZE, rays.size());
+			for (auto i = batch * RAYCAST_BATCH_SIZE; i < last; i++) {
+				hits[i] = this->raycast(rays[i]);
+			}
+		};
+		const auto batches = (rays.size() + RAYCAST_BATCH_SIZE - 1) / RAYCAST_BATCH_SIZE;
+		if (pool) {
+			pool->parallelFor(batches, cast);
+		} else {
+			for (std::size_t i = 0; i < batches; i++) {
+				cast(i);
+			}
+		}
+		return hits;
+	}
+
+	/// Free every leaf at once, leaving a single empty root
+	void clear() {
+		this->leaves_.clear();
+		this->leaves_.push_back(Node(0, D{}, this->rootHalfSize_));
+	}
+
+	/// Call func(node, position, halfSize) for every leaf in Morton order
+	template<typename F>
+	void forEachLeaf(F&& func) const {
+		for (const auto& leaf : this->leaves_) {
+			func(leaf, this->getPositionFromCode(leaf.code_, leaf.halfSize_), leaf.halfSize_);
+		}
+	}
+
+	/// Call func(node, position, halfSize) for every leaf intersecting the box in Morton order
+	template<typename F>
+	void forEachLeaf(const AABB& box, F&& func) const {
+		this->forEachLeaf(func, 0, Vec3i::zero(), this->rootHalfSize_, box);
+	}
+
+	/// Replace every leaf with nodes read in preorder, children in Morton order. next(data) points data at the
+	/// next leaf's data, or sets it to nullptr if the next node is split, and returns false if there is no next node.
+	/// Leaves the octree empty if next() fails or splits a unit voxel
+	template<typename F>
+	[[nodiscard]] bool readPreorder(F&& next) {
+		// Preorder visits the leaves in Morton order, so they are appended already sorted
+		this->leaves_.clear();
+		if (!this->readPreorder(next, 0, this->rootHalfSize_)) {
+			this->clear();
+			return false;
+		}
+		return true;
+	}
+
+	[[nodiscard]] int size() const {
+		return this->rootHalfSize_ * 2;
+	}
+
+	[[nodiscard]] std::size_t nodeCount() const {
+		return this->leaves_.size();
+	}
+
+	[[nodiscard]] std::size_t memoryUsage() const {
+		return sizeof(LinearOctree) + this->leaves_.capacity() * sizeof(Node);
+	}
+
+	/// Keep a copy of the current leaves to come back to. Release every saved version
+	[[nodiscard]] Version saveVersion() {
+		this->versionMemoryUsage_ += this->leaves_.size() * sizeof(Node);
+		return std::make_shared<const std::vector<Node>>(this->leaves_);
+	}
+
+	/// Copy back the leaves of a saved version, which stays saved
+	void restoreVersion(const Version& version) {
+		this->leaves_ = *version;
+	}
+
+	void releaseVersion(const Version& version) {
+		this->versionMemoryUsage_ -= version->size() * sizeof(Node);
+	}
+
+	/// Call func(node, position, halfSize) for every box that differs from the saved version, with the leaf holding
+	/// the box now. Every changed voxel is inside one of them
+	template<typename F>
+	void forEachDifference(const Version& version, F&& func) const {
+		auto other = version->begin();
+		for (const auto& leaf : this->leaves_) {
+			// The leaf of the version holding the first cell of this leaf
+			while (std::next(other) != version->end() && std::next(other)->code_ <= leaf.code_) {
+				++other;
+			}
+			// Leaves split or merged since still hold the same data, only the smaller of two differing leaves is reported
+			const auto end = leaf.code_ + LinearOctree::getCellCount(leaf.halfSize_);
+			for (auto overlap = other; overlap != version->end() && overlap->code_ < end; ++overlap) {
+				if (overlap->data_ == leaf.data_) {
+					continue;
+				}
+				if (overlap->halfSize_ >= leaf.halfSize_) {
+					func(leaf, this->getPositionFromCode(leaf.code_, leaf.halfSize_), leaf.halfSize_);
+					break;
+				}
+				func(leaf, this->getPositionFromCode(overlap->code_, overlap->halfSize_), overlap->halfSize_);
+			}
+		}
+	}
+
+	/// Bytes of the current leaves and the copies kept by saved versions
+	[[nodiscard]] std::size_t liveMemoryUsage() const {
+		return this->leaves_.size() * sizeof(Node) + this->versionMemoryUsage_;
+	}
+
+	/// Interleave the bits of a cell coordinate, x is the most significant
+	[[nodiscard]] static std::uint64_t encode(Vec3i cell) {
+		return (LinearOctree::spread(cell.x) << 2) | (LinearOctree::spread(cell.y) << 1) | LinearOctree::spread(cell.z);
+	}
+
+	[[nodiscard]] static Vec3i decode(std::uint64_t code) {
+		return {LinearOctree::compact(code >> 2), LinearOctree::compact(code >> 1), LinearOctree::compact(code)};
+	}
+
+private:
+	using Iterator = typename std::vector<Node>::const_iterator;
+
+	// Rays per task when casting on a pool
+	static constexpr std::size_t RAYCAST_BATCH_SIZE = 256;
+
+	/// Append the rebuilt leaves of a node, which is either part of a single leaf (uniform) or exactly covered by [first, last)
+	// NOLINTNEXTLINE(*-no-recursion)
+	void fill(std::vector<Node>& leaves, std::uint64_t code, Vec3i position, int halfSize, const D* uniform, Iterator first, Iterator last, const AABB& box, const D& data) const {
+		if (!uniform && last - first == 1) {
+			uniform = &first->data_;
+		}
+		const auto bounds = AABB::fromNode(position, halfSize);
+		if (!box.intersects(bounds) || halfSize == 1) {
+			if (halfSize == 1 && box.contains(position)) {
+				this->appendMerged(leaves, Node(code, data, halfSize));
+			} else if (uniform) {
+				this->appendMerged(leaves, Node(code, *uniform, halfSize));
+			} else {
+				for (auto it = first; it != last; ++it) {
+					this->appendMerged(leaves, *it);
+				}
+			}
+			return;
+		}
+		if (box.encloses(bounds) || (uniform && *uniform == data)) {
+			this->appendMerged(leaves, Node(code, box.encloses(bounds) ? data : *uniform, halfSize));
+			return;
+		}
+		const auto cellCount = LinearOctree::getCellCount(halfSize / 2);
+		for (int i = 0; i < 8; i++) {
+			const auto childCode = code + i * cellCount;
+			auto childLast = last;
+			if (!uniform) {
+				childLast = std::lower_bound(first, last, childCode + cellCount, [](const Node& node, std::uint64_t value) {
+					return node.code_ < value;
+				});
+			}
+			this->fill(leaves, childCode, Octree<D>::getPositionFromIndex(position, halfSize, i), halfSize / 2, uniform, first, childLast, box, data);
+			first = childLast;
+		}
+	}
+
+	/// Visit the leaves of a node that intersect the box, descending only through nodes crossing its boundary
+	// NOLINTNEXTLINE(*-no-recursion)
+	template<typename F>
+	void forEachLeaf(F& func, std::uint64_t code, Vec3i position, int halfSize, const AABB& box) const {
+		const auto bounds = AABB::fromNode(position, halfSize);
+		if (!box.intersects(bounds)) {
+			return;
+		}
+		const auto first = this->findLeaf(code);
+		if (first->halfSize_ >= halfSize) {
+			func(*first, position, halfSize);
+			return;
+		}
+		if (box.encloses(bounds)) {
+			const auto last = std::lower_bound(first, this->leaves_.end(), code + LinearOctree::getCellCount(halfSize), [](const Node& node, std::uint64_t value) {
+				return node.code_ < value;
+			});
+			for (auto leaf = first; leaf != last; ++leaf) {
+				func(*leaf, this->getPositionFromCode(leaf->code_, leaf->halfSize_), leaf->halfSize_);
+			}
+			return;
+		}
+		const auto cellCount = LinearOctree::getCellCount(halfSize / 2);
+		for (int i = 0; i < 8; i++) {
+			this->forEachLeaf(func, code + i * cellCount, Octree<D>::getPositionFromIndex(position, halfSize, i), halfSize / 2, box);
+		}
+	}
+
+	/// Visit the children the ray crosses front to back, stopping at the first solid leaf
+	// NOLINTNEXTLINE(*-no-recursion)
+	bool raycast(const Ray& ray, int mask, const Ray::Slabs& slabs, std::uint64_t code, Vec3i position, int halfSize, std::optional<Hit>& hit) const {
+		const auto span = slabs.getSpan();
+		if (!span.isHit() || span.exit < 0.f || span.enter > ray.maxDistance) {
+			return false;
+		}
+		const auto leaf = this->findLeaf(code);
+		if (leaf->halfSize_ >= halfSize) {
+			if (leaf->data_ == D{}) {
+				return false;
+			}
+			hit = Hit::fromSpan(*leaf, position, halfSize, ray, span);
+			return true;
+		}
+		const auto cellCount = LinearOctree::getCellCount(halfSize / 2);
+		// Only the children the ray passes through are visited, in order
+		const auto splits = ray.getSplits(slabs, position);
+		for (int order = Ray::getFirstChild(splits, span.enter); order >= 0;) {
+			const int index = order ^ mask;
+			const auto childSlabs = Ray::getChildSlabs(slabs, splits, mask, index);
+			if (this->raycast(ray, mask, childSlabs, code + index * cellCount, Octree<D>::getPositionFromIndex(position, halfSize, index), halfSize / 2, hit)) {
+				return true;
+			}
+			order = Ray::getNextChild(childSlabs, order);
+		}
+		return false;
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	template<typename F>
+	bool readPreorder(F& next, std::uint64_t code, int halfSize) {
+		const D* data = nullptr;
+		if (!next(data)) {
+			return false;
+		}
+		if (data) {
+			this->leaves_.push_back(Node(code, *data, halfSize));
+			return true;
+		}
+		if (halfSize == 1) {
+			return false;
+		}
+		const auto cellCount = LinearOctree::getCellCount(halfSize / 2);
+		for (std::uint64_t i = 0; i < 8; i++) {
+			if (!this->readPreorder(next, code + i * cellCount, halfSize / 2)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Append a leaf in Morton order, merging the last 8 leaves whenever they form a group of equal siblings
+	void appendMerged(std::vector<Node>& leaves, Node leaf) const {
+		leaves.push_back(std::move(leaf));
+		// Siblings are consecutive in Morton order, so a finished group is always at the back
+		while (leaves.size() >= 8 && leaves.back().halfSize_ < this->rootHalfSize_) {
+			const auto first = leaves.end() - 8;
+			const auto halfSize = leaves.back().halfSize_;
+			if (first->code_ % LinearOctree::getCellCount(halfSize * 2) != 0 || !std::all_of(first, leaves.end(), [&first, halfSize](const Node& node) {
+				return node.halfSize_ == halfSize && node.data_ == first->data_;
+			})) {
+				break;
+			}
+			first->halfSize_ = halfSize * 2;
+			leaves.erase(first + 1, leaves.end());
+		}
+	}
+
+	/// Merge the leaf at the given code into its parent while all its siblings are leaves holding equal data
+	void mergeUp(std::uint64_t code, int halfSize) {
+		for (; halfSize < this->rootHalfSize_; halfSize *= 2) {
+			const auto parentCode = code - code % LinearOctree::getCellCount(halfSize * 2);
+			const auto first = this->findLeaf(parentCode);
+			if (first->code_ != parentCode || this->leaves_.end() - first < 8) {
+				return;
+			}
+			const auto last = first + 8;
+			if (!std::all_of(first, last, [&first, halfSize](const Node& node) {
+				return node.halfSize_ == halfSize && node.data_ == first->data_;
+			})) {
+				return;
+			}
+			first->halfSize_ = halfSize * 2;
+			this->leaves_.erase(first + 1, last);
+			code = parentCode;
+		}
+	}
+
+	/// The leaf containing the cell with the given code
+	[[nodiscard]] typename std::vector<Node>::iterator findLeaf(std::uint64_t code) {
+		return std::upper_bound(this->leaves_.begin(), this->leaves_.end(), code, [](std::uint64_t value, const Node& node) {
+			return value < node.code_;
+		}) - 1;
+	}
+
+	[[nodiscard]] typename std::vector<Node>::const_iterator findLeaf(std::uint64_t code) const {
+		return std::upper_bound(this->leaves_.begin(), this->leaves_.end(), code, [](std::uint64_t value, const Node& node) {
+			return value < node.code_;
+		}) - 1;
+	}
+
+	/// Code of the cell containing the position, cells are 2 units wide
+	[[nodiscard]] std::uint64_t getCodeFromPosition(Vec3i position) const {
+		return LinearOctree::encode({
+			(position.x + this->rootHalfSize_) / 2,
+			(position.y + this->rootHalfSize_) / 2,
+			(position.z + this->rootHalfSize_) / 2,
+		});
+	}
+
+	[[nodiscard]] Vec3i getPositionFromCode(std::uint64_t code, int halfSize) const {
+		const auto cell = LinearOctree::decode(code);
+		return {
+			cell.x * 2 - this->rootHalfSize_ + halfSize,
+			cell.y * 2 - this->rootHalfSize_ + halfSize,
+			cell.z * 2 - this->rootHalfSize_ + halfSize,
+		};
+	}
+
+	/// The number of cells inside a node, which is also the size of its Morton code range
+	[[nodiscard]] static std::uint64_t getCellCount(int halfSize) {
+		return static_cast<std::uint64_t>(halfSize) * halfSize * halfSize;
+	}
+
+	[[nodiscard]] static std::uint64_t spread(int value) {
+		auto x = static_cast<std::uint64_t>(value) & 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffff;
+		x = (x | x << 16) & 0x1f0000ff0000ff;
+		x = (x | x << 8)  & 0x100f00f00f00f00f;
+		x = (x | x << 4)  & 0x10c30c30c30c30c3;
+		x = (x | x << 2)  & 0x1249249249249249;
+		return x;
+	}
+
+	[[nodiscard]] static int compact(std::uint64_t code) {
+		auto x = code & 0x1249249249249249;
+		x = (x | x >> 2)  & 0x10c30c30c30c30c3;
+		x = (x | x >> 4)  & 0x100f00f00f00f00f;
+		x = (x | x >> 8)  & 0x1f0000ff0000ff;
+		x = (x | x >> 16) & 0x1f00000000ffff;
+		x = (x | x >> 32) & 0x1fffff;
+		return static_cast<int>(x);
+	}
+
+	int rootHalfSize_;
+
+	std::vector<Node> leaves_;
+	std::size_t versionMemoryUsage_ = 0;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// A whole file mapped read-only into memory. Pages are read in by the OS as they are touched,
+/// so nothing is copied into a buffer first
+class MappedFile {
+public:
+	explicit MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+		const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return;
+		}
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+			if (const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+				if (void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) {
+					this->data_ = static_cast<const std::byte*>(view);
+					this->size_ = static_cast<std::size_t>(size.QuadPart);
+				}
+				// The view keeps the mapping alive
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file);
+#else
+		const int file = open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			return;
+		}
+		struct stat status{};
+		if (fstat(file, &status) == 0 && status.st_size > 0) {
+			void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (view != MAP_FAILED) {
+				// The file is read front to back once
+				madvise(view, static_cast<std::size_t>(status.st_size), MADV_SEQUENTIAL);
+				this->data_ = static_cast<const std::byte*>(view);
+				this->size_ = static_cast<std::size_t>(status.st_size);
+			}
+		}
+		// The mapping stays valid after the descriptor is closed
+		close(file);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() {
+		if (!this->data_) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(this->data_);
+#else
+		munmap(const_cast<std::byte*>(this->data_), this->size_);
+#endif
+	}
+
+	/// False if the file could not be opened or is empty
+	[[nodiscard]] explicit operator bool() const {
+		return this->data_ != nullptr;
+	}
+
+	[[nodiscard]] std::span<const std::byte> data() const {
+		return {this->data_, this->size_};
+	}
+
+private:
+	const std::byte* data_ = nullptr;
+	std::size_t size_ = 0;
+};
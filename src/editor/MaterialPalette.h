@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/// Index of a texture name in the material palette
+using MaterialId = std::uint16_t;
+
+/// Texture names interned into small ids, so voxels carry an id instead of a name. One palette is shared by every
+/// chamber, the mesher, the chamber files and the renderer. Names are never removed, an id stays valid until exit.
+/// Safe to use from any thread
+class MaterialPalette {
+public:
+	/// Id of the empty texture, for open space
+	static constexpr MaterialId EMPTY = 0;
+	static constexpr std::size_t MAX_SIZE = std::numeric_limits<MaterialId>::max() + std::size_t{1};
+
+	MaterialPalette() {
+		this->ids_.emplace(this->names_.emplace_back(), EMPTY);
+	}
+
+	MaterialPalette(const MaterialPalette&) = delete;
+	MaterialPalette& operator=(const MaterialPalette&) = delete;
+
+	/// The palette every voxel refers to
+	[[nodiscard]] static MaterialPalette& get() {
+		static MaterialPalette palette;
+		return palette;
+	}
+
+	/// The id of a texture name, added to the palette if it is new. Returns nothing if the palette is full
+	[[nodiscard]] std::optional<MaterialId> intern(std::string_view name) {
+		std::scoped_lock lock(this->mutex_);
+		if (const auto id = this->ids_.find(name); id != this->ids_.end()) {
+			return id->second;
+		}
+		if (this->names_.size() == MAX_SIZE) {
+			return std::nullopt;
+		}
+		const auto id = static_cast<MaterialId>(this->names_.size());
+		// Names in a deque don't move, the map can look them up through views
+		this->ids_.emplace(this->names_.emplace_back(name), id);
+		return id;
+	}
+
+	/// The texture name of an id, empty for unknown ids. The view stays valid until exit
+	[[nodiscard]] std::string_view getName(MaterialId id) const {
+		std::scoped_lock lock(this->mutex_);
+		return id < this->names_.size() ? std::string_view{this->names_[id]} : std::string_view{};
+	}
+
+	[[nodiscard]] std::size_t size() const {
+		std::scoped_lock lock(this->mutex_);
+		return this->names_.size();
+	}
+
+private:
+	mutable std::mutex mutex_;
+	std::deque<std::string> names_;
+	std::unordered_map<std::string_view, MaterialId> ids_;
+};
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sourcepp/math/Vector.h>
+
+#include "AABB.h"
+
+using namespace sourcepp::math;
+
+/// A rectangle on an axis-aligned plane. The rectangle spans the two axes following its normal axis,
+/// so a quad facing x spans (y, z), a quad facing y spans (z, x) and a quad facing z spans (x, y)
+struct MeshQuad {
+	int axis;
+	bool positive;
+	int plane;
+	Vec2i min;
+	Vec2i max;
+	std::size_t material;
+};
+
+/// A face of a solid box, spanning the two axes following its normal axis like MeshQuad
+struct MeshFace {
+	int axis;
+	int plane;
+	Vec2i min;
+	Vec2i max;
+	std::size_t material;
+	bool positive;
+};
+
+/// Quantized vertex on the chamber grid. Texture coordinates are derived from the position and face direction
+struct MeshVertex {
+	std::int16_t x;
+	std::int16_t y;
+	std::int16_t z;
+	std::uint16_t padding;
+	/// Bits 0-2 hold the face direction (axis * 2 + positive), bits 8-31 the material index
+	std::uint32_t attributes;
+
+	[[nodiscard]] bool operator==(const MeshVertex&) const = default;
+};
+static_assert(sizeof(MeshVertex) == 12);
+
+/// Deduplicated vertices and a triangle list indexing into them
+struct IndexedMesh {
+	std::vector<MeshVertex> vertices;
+	std::vector<std::uint32_t> indices;
+};
+
+template<typename D>
+struct QuadMesh {
+	std::vector<MeshQuad> quads;
+	/// Voxel data of each material index used by the quads
+	std::vector<D> materials;
+};
+
+namespace Mesher {
+
+[[nodiscard]] inline int getComponent(Vec3i vector, int axis) {
+	return axis == 0 ? vector.x : axis == 1 ? vector.y : vector.z;
+}
+
+/// Build a position from a coordinate along an axis and the two coordinates following it
+template<typename T>
+[[nodiscard]] Vec3<T> fromPlane(int axis, T plane, T u, T v) {
+	switch (axis) {
+		case 0:  return {plane, u, v};
+		case 1:  return {v, plane, u};
+		default: return {u, v, plane};
+	}
+}
+
+/// The index of the data in the materials of the mesh, added if new
+template<typename D>
+[[nodiscard]] std::size_t getMaterial(QuadMesh<D>& mesh, const D& data) {
+	std::size_t material = std::find(mesh.materials.begin(), mesh.materials.end(), data) - mesh.materials.begin();
+	if (material == mesh.materials.size()) {
+		mesh.materials.push_back(data);
+	}
+	return material;
+}
+
+/// Add the 6 faces of a solid box
+inline void addFaces(std::vector<MeshFace>& faces, const AABB& box, std::size_t material) {
+	for (int axis = 0; axis < 3; axis++) {
+		const Vec2i min{getComponent(box.min, (axis + 1) % 3), getComponent(box.min, (axis + 2) % 3)};
+		const Vec2i max{getComponent(box.max, (axis + 1) % 3), getComponent(box.max, (axis + 2) % 3)};
+		faces.push_back({axis, getComponent(box.min, axis), min, max, material, false});
+		faces.push_back({axis, getComponent(box.max, axis), min, max, material, true});
+	}
+}
+
+/// Merge the faces of disjoint solid boxes into maximal rectangles per plane, direction and material.
+/// Faces shared by two solid boxes are dropped. Sorts the faces
+inline void mergeFaces(std::vector<MeshFace>& faces, std::vector<MeshQuad>& quads) {
+	std::sort(faces.begin(), faces.end(), [](const MeshFace& lhs, const MeshFace& rhs) {
+		return std::tie(lhs.axis, lhs.plane) < std::tie(rhs.axis, rhs.plane);
+	});
+
+	static constexpr std::size_t NONE = ~std::size_t{0};
+	std::vector<int> us, vs;
+	std::vector<std::size_t> grids[2];
+	std::vector<bool> used;
+	for (auto first = faces.begin(); first != faces.end();) {
+		const auto last = std::find_if(first, faces.end(), [&first](const MeshFace& face) {
+			return face.axis != first->axis || face.plane != first->plane;
+		});
+
+		// Compress the coordinates of the faces on this plane into a grid
+		us.clear();
+		vs.clear();
+		for (auto face = first; face != last; ++face) {
+			us.push_back(face->min.x);
+			us.push_back(face->max.x);
+			vs.push_back(face->min.y);
+			vs.push_back(face->max.y);
+		}
+		std::sort(us.begin(), us.end());
+		us.erase(std::unique(us.begin(), us.end()), us.end());
+		std::sort(vs.begin(), vs.end());
+		vs.erase(std::unique(vs.begin(), vs.end()), vs.end());
+		const auto width = us.size() - 1;
+		const auto height = vs.size() - 1;
+
+		// Faces of boxes on the same side of the plane never overlap
+		for (auto& grid : grids) {
+			grid.assign(width * height, NONE);
+		}
+		for (auto face = first; face != last; ++face) {
+			const std::size_t u0 = std::lower_bound(us.begin(), us.end(), face->min.x) - us.begin();
+			const std::size_t u1 = std::lower_bound(us.begin(), us.end(), face->max.x) - us.begin();
+			const std::size_t v0 = std::lower_bound(vs.begin(), vs.end(), face->min.y) - vs.begin();
+			const std::size_t v1 = std::lower_bound(vs.begin(), vs.end(), face->max.y) - vs.begin();
+			auto& grid = grids[face->positive];
+			for (auto v = v0; v < v1; v++) {
+				std::fill(grid.begin() + static_cast<std::ptrdiff_t>(v * width + u0), grid.begin() + static_cast<std::ptrdiff_t>(v * width + u1), face->material);
+			}
+		}
+
+		// Cells covered from both sides are hidden, grow rectangles over the rest
+		for (int side = 0; side < 2; side++) {
+			const auto& grid = grids[side];
+			const auto& other = grids[1 - side];
+			used.assign(width * height, false);
+			const auto isFree = [&](std::size_t cell, std::size_t material) {
+				return grid[cell] == material && other[cell] == NONE && !used[cell];
+			};
+			for (std::size_t v = 0; v < height; v++) {
+				for (std::size_t u = 0; u < width; u++) {
+					const auto material = grid[v * width + u];
+					if (material == NONE || !isFree(v * width + u, material)) {
+						continue;
+					}
+					std::size_t w = 1;
+					while (u + w < width && isFree(v * width + u + w, material)) {
+						w++;
+					}
+					std::size_t h = 1;
+					while (v + h < height) {
+						bool rowFree = true;
+						for (std::size_t i = 0; i < w && rowFree; i++) {
+							rowFree = isFree((v + h) * width + u + i, material);
+						}
+						if (!rowFree) {
+							break;
+						}
+						h++;
+					}
+					for (std::size_t j = 0; j < h; j++) {
+						std::fill(used.begin() + static_cast<std::ptrdiff_t>((v + j) * width + u), used.begin() + static_cast<std::ptrdiff_t>((v + j) * width + u + w), true);
+					}
+					quads.push_back({first->axis, side == 1, first->plane, {us[u], vs[v]}, {us[u + w], vs[v + h]}, material});
+				}
+			}
+		}
+		first = last;
+	}
+}
+
+/// Mesh the surface of a set of disjoint solid boxes. Faces shared by two solid boxes are dropped,
+/// the remaining faces are merged into maximal rectangles per plane, direction and material
+template<typename D>
+[[nodiscard]] QuadMesh<D> greedy(const std::vector<std::pair<AABB, D>>& solids) {
+	QuadMesh<D> mesh;
+	std::vector<MeshFace> faces;
+	faces.reserve(solids.size() * 6);
+	for (const auto& [box, data] : solids) {
+		Mesher::addFaces(faces, box, Mesher::getMaterial(mesh, data));
+	}
+	Mesher::mergeFaces(faces, mesh.quads);
+	return mesh;
+}
+
+/// Mesh every solid leaf of an octree. Leaves holding default constructed data are empty space.
+/// Bricks only add the faces of their voxels that have no solid neighbour inside the brick
+template<typename Tree>
+[[nodiscard]] auto mesh(const Tree& tree) {
+	using D = std::remove_cvref_t<decltype(std::declval<const typename Tree::Node&>().data())>;
+
+	if constexpr (requires { typename Tree::Brick; }) {
+		using Brick = typename Tree::Brick;
+		QuadMesh<D> mesh;
+		std::vector<MeshFace> faces;
+		// Mesh material of each palette index of the tree, looked up once
+		static constexpr std::size_t NONE = ~std::size_t{0};
+		std::vector<std::size_t> materials;
+		tree.forEachLeafOrBrick([&mesh, &faces](const typename Tree::Node& node, Vec3i position, int halfSize) {
+			if (!(node.data() == D{})) {
+				Mesher::addFaces(faces, AABB::fromNode(position, halfSize), Mesher::getMaterial(mesh, node.data()));
+			}
+		}, [&tree, &mesh, &faces, &materials](const Brick& brick, Vec3i position) {
+			const auto corner = AABB::fromNode(position, Tree::BRICK_HALF_SIZE).min;
+			for (int axis = 0; axis < 3; axis++) {
+				for (const bool positive : {false, true}) {
+					const auto visible = brick.getVisibleFaces(axis, positive);
+					for (int z = 0; z < Brick::WIDTH; z++) {
+						for (auto bits = visible[z]; bits; bits &= bits - 1) {
+							const auto bit = std::countr_zero(bits);
+							const auto x = bit % Brick::WIDTH;
+							const auto y = bit / Brick::WIDTH;
+							const auto index = brick.materials[Brick::getIndex(x, y, z)];
+							if (index >= materials.size()) {
+								materials.resize(index + 1, NONE);
+							}
+							if (materials[index] == NONE) {
+								materials[index] = Mesher::getMaterial(mesh, tree.getMaterial(index));
+							}
+							const Vec3i min{corner.x + x * 2, corner.y + y * 2, corner.z + z * 2};
+							const auto u = getComponent(min, (axis + 1) % 3);
+							const auto v = getComponent(min, (axis + 2) % 3);
+							faces.push_back({axis, getComponent(min, axis) + (positive ? 2 : 0), {u, v}, {u + 2, v + 2}, materials[index], positive});
+						}
+					}
+				}
+			}
+		});
+		Mesher::mergeFaces(faces, mesh.quads);
+		return mesh;
+	}
+
+	std::vector<std::pair<AABB, D>> solids;
+	tree.forEachLeaf([&solids](const typename Tree::Node& node, Vec3i position, int halfSize) {
+		if (!(node.data() == D{})) {
+			solids.emplace_back(AABB::fromNode(position, halfSize), node.data());
+		}
+	});
+	return Mesher::greedy(solids);
+}
+
+/// Mesh the solid leaves of an octree inside a region. Only faces on planes in [region.min, region.max) are kept,
+/// so adjacent regions can be meshed separately. Faces on the far planes of the world belong to the last region.
+/// Leaves smaller than minHalfSize are merged into their ancestor of that size, which is solid if at least half
+/// of it is, and takes the material covering the most of it
+template<typename Tree>
+[[nodiscard]] auto mesh(const Tree& tree, const AABB& region, int minHalfSize = 1) {
+	using D = std::remove_cvref_t<decltype(std::declval<const typename Tree::Node&>().data())>;
+
+	// Faces on a plane only depend on the cells directly next to it. The merged nodes before the region
+	// have to be complete, the ones after it only cover faces owned by the next region
+	const int margin = std::max(2, minHalfSize * 2);
+	const AABB bounds{
+		{region.min.x - margin, region.min.y - margin, region.min.z - margin},
+		{region.max.x + 2, region.max.y + 2, region.max.z + 2},
+	};
+	std::vector<std::pair<AABB, D>> solids;
+	std::map<std::tuple<int, int, int>, std::vector<std::pair<D, std::int64_t>>> merged;
+	const int worldMax = tree.size() / 2;
+	tree.forEachLeaf(bounds, [&](const typename Tree::Node& node, Vec3i position, int halfSize) {
+		if (halfSize < minHalfSize) {
+			const auto getCenter = [worldMax, minHalfSize](int coordinate) {
+				return (coordinate + worldMax) / (minHalfSize * 2) * (minHalfSize * 2) + minHalfSize - worldMax;
+			};
+			auto& volumes = merged[{getCenter(position.x), getCenter(position.y), getCenter(position.z)}];
+			auto volume = std::find_if(volumes.begin(), volumes.end(), [&node](const auto& entry) {
+				return entry.first == node.data();
+			});
+			if (volume == volumes.end()) {
+				volumes.emplace_back(node.data(), 0);
+				volume = volumes.end() - 1;
+			}
+			volume->second += static_cast<std::int64_t>(halfSize) * halfSize * halfSize;
+		} else if (!(node.data() == D{})) {
+			solids.emplace_back(AABB::fromNode(position, halfSize).intersection(bounds), node.data());
+		}
+	});
+	const auto nodeVolume = static_cast<std::int64_t>(minHalfSize) * minHalfSize * minHalfSize;
+	for (const auto& [center, volumes] : merged) {
+		std::int64_t solidVolume = 0;
+		const std::pair<D, std::int64_t>* largest = nullptr;
+		for (const auto& entry : volumes) {
+			if (entry.first == D{}) {
+				continue;
+			}
+			solidVolume += entry.second;
+			if (!largest || entry.second > largest->second) {
+				largest = &entry;
+			}
+		}
+		if (largest && solidVolume * 2 >= nodeVolume) {
+			const auto [x, y, z] = center;
+			solids.emplace_back(AABB::fromNode({x, y, z}, minHalfSize).intersection(bounds), largest->first);
+		}
+	}
+	auto mesh = Mesher::greedy(solids);
+
+	// Drop the faces owned by other regions, including the ones created by cutting leaves at the bounds
+	std::size_t kept = 0;
+	for (auto quad : mesh.quads) {
+		const auto min = getComponent(region.min, quad.axis);
+		const auto max = getComponent(region.max, quad.axis);
+		if (quad.plane < min || (quad.plane >= max && !(quad.plane == worldMax && max == worldMax))) {
+			continue;
+		}
+		quad.min.x = std::max(quad.min.x, getComponent(region.min, (quad.axis + 1) % 3));
+		quad.min.y = std::max(quad.min.y, getComponent(region.min, (quad.axis + 2) % 3));
+		quad.max.x = std::min(quad.max.x, getComponent(region.max, (quad.axis + 1) % 3));
+		quad.max.y = std::min(quad.max.y, getComponent(region.max, (quad.axis + 2) % 3));
+		if (quad.min.x < quad.max.x && quad.min.y < quad.max.y) {
+			mesh.quads[kept++] = quad;
+		}
+	}
+	mesh.quads.resize(kept);
+	return mesh;
+}
+
+/// Triangulate quads into an unindexed triangle list with counter-clockwise front faces.
+/// Texture coordinates repeat every textureSize units
+template<typename V>
+[[nodiscard]] std::vector<V> triangulate(const std::vector<MeshQuad>& quads, float textureSize) {
+	std::vector<V> vertices;
+	vertices.reserve(quads.size() * 6);
+	for (const auto& quad : quads) {
+		const auto plane = static_cast<float>(quad.plane);
+		const std::array<Vec2f, 4> corners{{
+			{static_cast<float>(quad.min.x), static_cast<float>(quad.min.y)},
+			{static_cast<float>(quad.max.x), static_cast<float>(quad.min.y)},
+			{static_cast<float>(quad.max.x), static_cast<float>(quad.max.y)},
+			{static_cast<float>(quad.min.x), static_cast<float>(quad.max.y)},
+		}};
+		static constexpr std::array<int, 6> POSITIVE{0, 1, 2, 0, 2, 3};
+		static constexpr std::array<int, 6> NEGATIVE{0, 2, 1, 0, 3, 2};
+		for (int corner : quad.positive ? POSITIVE : NEGATIVE) {
+			const auto& uv = corners[corner];
+			vertices.push_back({fromPlane(quad.axis, plane, uv.x, uv.y), {uv.x / textureSize, uv.y / textureSize}});
+		}
+	}
+	return vertices;
+}
+
+/// Build an indexed triangle list with the same triangles as triangulate(), sharing
+/// the vertices of adjacent quads that lie on the same plane and have the same direction and material
+[[nodiscard]] inline IndexedMesh index(const std::vector<MeshQuad>& quads) {
+	IndexedMesh mesh;
+	mesh.indices.reserve(quads.size() * 6);
+
+	// Quads on different planes can't share vertices, so only the current plane is remembered
+	std::unordered_map<std::uint64_t, std::uint32_t> shared;
+	const MeshQuad* plane = nullptr;
+	for (const auto& quad : quads) {
+		if (!plane || plane->axis != quad.axis || plane->positive != quad.positive || plane->plane != quad.plane) {
+			shared.clear();
+			plane = &quad;
+		}
+		const auto attributes = static_cast<std::uint32_t>(quad.axis * 2 + quad.positive) | static_cast<std::uint32_t>(quad.material << 8);
+		const std::array<Vec2i, 4> corners{{
+			{quad.min.x, quad.min.y},
+			{quad.max.x, quad.min.y},
+			{quad.max.x, quad.max.y},
+			{quad.min.x, quad.max.y},
+		}};
+		std::array<std::uint32_t, 4> indices; // NOLINT(*-member-init)
+		for (int i = 0; i < 4; i++) {
+			const auto key = (static_cast<std::uint64_t>(static_cast<std::uint16_t>(corners[i].x)) << 48) |
+			                 (static_cast<std::uint64_t>(static_cast<std::uint16_t>(corners[i].y)) << 32) |
+			                 static_cast<std::uint64_t>(quad.material);
+			const auto [it, inserted] = shared.try_emplace(key, static_cast<std::uint32_t>(mesh.vertices.size()));
+			if (inserted) {
+				const auto position = fromPlane(quad.axis, quad.plane, corners[i].x, corners[i].y);
+				mesh.vertices.push_back({static_cast<std::int16_t>(position.x), static_cast<std::int16_t>(position.y), static_cast<std::int16_t>(position.z), 0, attributes});
+			}
+			indices[i] = it->second;
+		}
+		static constexpr std::array<int, 6> POSITIVE{0, 1, 2, 0, 2, 3};
+		static constexpr std::array<int, 6> NEGATIVE{0, 2, 1, 0, 3, 2};
+		for (int corner : quad.positive ? POSITIVE : NEGATIVE) {
+			mesh.indices.push_back(indices[corner]);
+		}
+	}
+	return mesh;
+}
+
+} // namespace Mesher
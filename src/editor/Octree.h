@@ -1,207 +1,1205 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
-#include <variant>
+#include <optional>
+#include <span>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <sourcepp/math/Vector.h>
 
+#include "AABB.h"
+#include "EpochDomain.h"
+#include "PointBatch.h"
+#include "Ray.h"
+#include "ThreadPool.h"
+
 using namespace sourcepp::math;
 
-template<typename D>
+/// Sparse voxel octree. A DEPTH above 0 fixes its size to 1 << DEPTH at compile time: set(), get() and exists()
+/// then descend in unrolled loops where every level's size is a constant and child indices are bits of the position.
+/// One thread edits it, others may read snapshot()s of what it last publish()ed meanwhile
+template<typename D, int DEPTH = 0>
 class Octree {
+	static_assert(DEPTH >= 0 && DEPTH < 31, "the octree must fit in an int");
+
 public:
+	/// Index of a block of 8 sibling nodes in the node arena
+	using Index = std::uint32_t;
+
+	static constexpr Index NO_CHILDREN = ~Index{0};
+
+	/// Deeper than any octree with an int size can go
+	static constexpr int MAX_DEPTH = 32;
+
 	class Node {
 	public:
-		explicit Node(Vec3i position, int halfSize)
-			: data_(D{})
-			, position_(position)
-			, halfSize_(halfSize) {}
-
 		[[nodiscard]] bool hasChildren() const {
-			return !this->isLeaf;
+			return this->children_ != NO_CHILDREN;
 		}
 
-		/// Split voxel into 8 subvoxels
-		void subdivide() {
-			this->data_ = std::array<std::unique_ptr<Node>, 8>{};
-			this->isLeaf = false;
+		[[nodiscard]] const D& data() const {
+			return this->data_;
 		}
 
-		/// Merge 8 subvoxels into one voxel
-		void merge(D data) {
-			this->data_ = std::move(data);
-			this->isLeaf = true;
+		/// The block holding the 8 children of this node, or NO_CHILDREN
+		[[nodiscard]] Index children() const {
+			return this->children_;
 		}
 
-		[[nodiscard]] const D& data() const {
-			return std::get<D>(this->data_);
+	private:
+		friend class Octree;
+
+		D data_{};
+		Index children_ = NO_CHILDREN;
+	};
+
+	/// 8 sibling nodes stored next to each other, in Morton order
+	using Block = std::array<Node, 8>;
+
+	/// The nodes of the octree at some point, kept alive for undo. Blocks are shared between versions
+	/// until an edit copies them, so keeping a version only costs the blocks changed since
+	class Version {
+	private:
+		friend class Octree;
+
+		Node root_;
+	};
+
+	/// The published nodes pinned for reading while the octree keeps changing, see snapshot()
+	class Snapshot;
+
+private:
+	/// A block of children whose parent is centered on position, and the next child to walk into
+	struct Frame {
+		const Block* children;
+		Vec3i position;
+		int halfSize;
+		int index;
+	};
+
+public:
+	/// A node and the cube it covers
+	struct NodeView {
+		const Node& node;
+		Vec3i position;
+		int halfSize;
+	};
+
+	/// Walks the leaves in Morton order with a fixed stack of the blocks above the current leaf, nothing is allocated.
+	/// Invalidated by any modification of the octree
+	class LeafIterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = NodeView;
+		using difference_type = std::ptrdiff_t;
+		using reference = NodeView;
+		using pointer = void;
+
+		/// The end of every walk
+		LeafIterator() = default;
+
+		explicit LeafIterator(const Octree& tree)
+			: tree_(&tree) {
+			this->descend(tree.root_, Vec3i::zero(), tree.rootHalfSize_);
 		}
 
-		[[nodiscard]] const std::array<std::unique_ptr<Node>, 8>& children() const {
-			return std::get<std::array<std::unique_ptr<Node>, 8>>(this->data_);
+		[[nodiscard]] NodeView operator*() const {
+			return {*this->node_, this->position_, this->halfSize_};
 		}
 
-		[[nodiscard]] std::unique_ptr<Node>& child(int index) {
-			auto& node = std::get<std::array<std::unique_ptr<Node>, 8>>(this->data_).at(index);
-			if (!node) {
-				node = std::make_unique<Node>(this->getPositionFromIndex(index), this->halfSize() / 2);
+		LeafIterator& operator++() {
+			while (this->depth_ > 0) {
+				auto& frame = this->stack_[this->depth_ - 1];
+				if (++frame.index < 8) {
+					this->descend((*frame.children)[frame.index], Octree::getPositionFromIndex(frame.position, frame.halfSize, frame.index), frame.halfSize / 2);
+					return *this;
+				}
+				this->depth_--;
 			}
-			return node;
+			this->node_ = nullptr;
+			return *this;
 		}
 
-		[[nodiscard]] const std::unique_ptr<Node>& child(int index) const {
-			return this->children().at(index);
+		LeafIterator operator++(int) {
+			auto old = *this;
+			++*this;
+			return old;
 		}
 
-		/// The center of the voxel
-		[[nodiscard]] Vec3i position() const {
-			return this->position_;
+		[[nodiscard]] bool operator==(const LeafIterator& other) const {
+			return this->node_ == other.node_;
 		}
 
-		[[nodiscard]] int halfSize() const {
-			return this->halfSize_;
+	private:
+		/// Follow the first children down to a leaf
+		void descend(const Node& node, Vec3i position, int halfSize) {
+			const Node* current = &node;
+			while (current->hasChildren()) {
+				const auto& children = this->tree_->block(current->children_);
+				this->stack_[this->depth_++] = {&children, position, halfSize, 0};
+				position = Octree::getPositionFromIndex(position, halfSize, 0);
+				halfSize /= 2;
+				current = &children[0];
+			}
+			this->node_ = current;
+			this->position_ = position;
+			this->halfSize_ = halfSize;
 		}
 
-		[[nodiscard]] bool isPositionOnBounds(Vec3i position) {
-			auto minX = this->position().x - this->halfSize();
-			auto maxX = this->position().x + this->halfSize();
-			auto minY = this->position().y - this->halfSize();
-			auto maxY = this->position().y + this->halfSize();
-			auto minZ = this->position().z - this->halfSize();
-			auto maxZ = this->position().z + this->halfSize();
-			return position.x == minX || position.x == maxX &&
-				   position.y == minY || position.y == maxY &&
-				   position.z == minZ || position.z == maxZ;
+		const Octree* tree_ = nullptr;
+		const Node* node_ = nullptr;
+		Vec3i position_{};
+		int halfSize_ = 0;
+		std::array<Frame, MAX_DEPTH> stack_{};
+		int depth_ = 0;
+	};
+
+	/// Every leaf in Morton order, for range-for: for (const auto& [node, position, halfSize] : tree.leaves())
+	class Leaves {
+	public:
+		explicit Leaves(const Octree& tree)
+			: tree_(tree) {}
+
+		[[nodiscard]] LeafIterator begin() const {
+			return LeafIterator(this->tree_);
 		}
 
-		[[nodiscard]] bool isPositionWithinBounds(Vec3i position) const {
-			auto modifiedPosition = position - this->position();
-			return modifiedPosition.x > this->halfSize() - 1 || modifiedPosition.x < -this->halfSize() + 1 ||
-			       modifiedPosition.y > this->halfSize() - 1 || modifiedPosition.y < -this->halfSize() + 1 ||
-			       modifiedPosition.z > this->halfSize() - 1 || modifiedPosition.z < -this->halfSize() + 1;
+		[[nodiscard]] LeafIterator end() const {
+			return {};
 		}
 
-		[[nodiscard]] Vec3i getPositionFromIndex(int index) {
-			Vec3i newPos = this->position();
-			const auto newPosDelta = this->halfSize() / 2;
+	private:
+		const Octree& tree_;
+	};
 
-			if ((index & 0b100) == 0b100) {
-				newPos.x += newPosDelta;
-			} else {
-				newPos.x -= newPosDelta;
+	using Hit = RayHit<Node>;
+
+	/// A fixed depth octree is 1 << DEPTH wide whatever the size given
+	explicit Octree(int size)
+		: rootHalfSize_((DEPTH > 0 ? 1 << DEPTH : size) / 2) {}
+
+	/// Deep copy of the current nodes, for snapshots that outlive later edits. Saved versions are not copied
+	Octree(const Octree& other)
+		: root_(other.root_)
+		, rootHalfSize_(other.rootHalfSize_) {
+		if (this->root_.hasChildren()) {
+			this->root_.children_ = this->copyChildren(other, other.root_.children_);
+		}
+	}
+
+	Octree& operator=(const Octree& other) {
+		if (this != &other) {
+			*this = Octree(other);
+		}
+		return *this;
+	}
+
+	/// Pinned snapshots must be gone before the octree is assigned to or destroyed
+	Octree(Octree&&) noexcept = default;
+	Octree& operator=(Octree&&) noexcept = default;
+
+	/// Set voxel data in the octree. Siblings left holding equal data are merged back into their parent
+	[[nodiscard]] bool set(Vec3i position, const D& data, bool forceMerge = false) {
+		if constexpr (DEPTH > 0) {
+			return this->setFixed(position, data, forceMerge);
+		}
+		const auto targetHalfSize = Octree::getHalfSizeFromPosition(this->rootHalfSize_, position);
+		if (!targetHalfSize) {
+			return false;
+		}
+		std::array<Node*, MAX_DEPTH> path; // NOLINT(*-member-init)
+		int depth = 0;
+		Node* node = &this->root_;
+		Vec3i nodePosition = Vec3i::zero();
+		for (int halfSize = this->rootHalfSize_; halfSize > targetHalfSize; halfSize /= 2) {
+			if (!node->hasChildren()) {
+				if (node->data_ == data) {
+					// Already covered by a leaf holding this data
+					return true;
+				}
+				this->subdivide(*node, halfSize);
 			}
-			if ((index & 0b010) == 0b010) {
-				newPos.y += newPosDelta;
-			} else {
-				newPos.y -= newPosDelta;
+			path[depth++] = node;
+			const auto index = Octree::getIndexFromPosition(nodePosition, position);
+			nodePosition = Octree::getPositionFromIndex(nodePosition, halfSize, index);
+			node = &this->getWritableChildren(*node)[index];
+		}
+		return this->assign(path, depth, *node, targetHalfSize, data, forceMerge);
+	}
+
+	/// Get the leaf containing the given position. Returns nullptr if the position lies on a node boundary.
+	/// The pointer is invalidated by the next modification of the octree
+	[[nodiscard]] const Node* get(Vec3i position) const {
+		if constexpr (DEPTH > 0) {
+			return this->getFixed(position);
+		}
+		const Node* node = &this->root_;
+		Vec3i nodePosition = Vec3i::zero();
+		int halfSize = this->rootHalfSize_;
+		while (!Octree::isPositionOnBounds(nodePosition, halfSize, position)) {
+			if (!node->hasChildren()) {
+				return node;
 			}
-			if ((index & 0b001) == 0b001) {
-				newPos.z += newPosDelta;
+			const auto index = Octree::getIndexFromPosition(nodePosition, position);
+			nodePosition = Octree::getPositionFromIndex(nodePosition, halfSize, index);
+			halfSize /= 2;
+			node = &this->block(node->children_)[index];
+		}
+		return nullptr;
+	}
+
+	/// Check if a node centered on the given position exists
+	[[nodiscard]] bool exists(Vec3i position) const {
+		if constexpr (DEPTH > 0) {
+			return this->existsFixed(position);
+		}
+		const auto targetHalfSize = Octree::getHalfSizeFromPosition(this->rootHalfSize_, position);
+		if (!targetHalfSize) {
+			return false;
+		}
+		const Node* node = &this->root_;
+		Vec3i nodePosition = Vec3i::zero();
+		for (int halfSize = this->rootHalfSize_; halfSize > targetHalfSize; halfSize /= 2) {
+			if (!node->hasChildren()) {
+				return false;
+			}
+			const auto index = Octree::getIndexFromPosition(nodePosition, position);
+			nodePosition = Octree::getPositionFromIndex(nodePosition, halfSize, index);
+			node = &this->block(node->children_)[index];
+		}
+		return true;
+	}
+
+	/// get() every position at once, nodes[i] is the leaf containing positions[i]. Positions descend the octree
+	/// PointBatch::WIDTH at a time in lockstep, so the cache misses of a level overlap instead of adding up
+	void getBatch(std::span<const Vec3i> positions, std::span<const Node*> nodes) const {
+		this->descendBatch(positions, [&nodes](std::size_t i, const Node& node, bool, bool outside) {
+			if (outside) {
+				nodes[i] = nullptr;
+				return true;
+			}
+			if (!node.hasChildren()) {
+				nodes[i] = &node;
+				return true;
+			}
+			return false;
+		});
+	}
+
+	/// exists() for every position at once, like getBatch()
+	void existsBatch(std::span<const Vec3i> positions, std::span<bool> exists) const {
+		this->descendBatch(positions, [&exists](std::size_t i, const Node& node, bool centered, bool outside) {
+			if (centered) {
+				exists[i] = true;
+				return true;
+			}
+			if (outside || !node.hasChildren()) {
+				exists[i] = false;
+				return true;
+			}
+			return false;
+		});
+	}
+
+	/// Set every voxel inside the box. Nodes fully inside the box are assigned in one step,
+	/// only nodes crossing its boundary are subdivided. Unit voxels are filled if their center is inside
+	void fill(const AABB& box, const D& data) {
+		this->fill(this->root_, Vec3i::zero(), this->rootHalfSize_, box, data);
+	}
+
+	/// Reset every voxel inside the box to empty
+	void clear(const AABB& box) {
+		this->fill(box, D{});
+	}
+
+	/// Merge every group of 8 sibling leaves holding equal data, bottom-up.
+	/// Only needed for trees that were not built through set(), which merges as it goes
+	void simplify() {
+		this->simplify(this->root_);
+	}
+
+	[[nodiscard]] Leaves leaves() const {
+		return Leaves(*this);
+	}
+
+	/// Call func(node, position, halfSize) for every leaf in Morton order
+	template<typename F>
+	void forEachLeaf(F&& func) const {
+		if (!this->root_.hasChildren()) {
+			func(this->root_, Vec3i::zero(), this->rootHalfSize_);
+			return;
+		}
+		std::array<Frame, MAX_DEPTH> stack; // NOLINT(*-member-init)
+		int depth = 0;
+		stack[depth++] = {&this->block(this->root_.children_), Vec3i::zero(), this->rootHalfSize_, 0};
+		while (depth > 0) {
+			auto& frame = stack[depth - 1];
+			if (frame.index == 8) {
+				depth--;
+				continue;
+			}
+			const auto index = frame.index++;
+			const auto& child = (*frame.children)[index];
+			const auto position = Octree::getPositionFromIndex(frame.position, frame.halfSize, index);
+			if (child.hasChildren()) {
+				stack[depth++] = {&this->block(child.children_), position, frame.halfSize / 2, 0};
 			} else {
-				newPos.z -= newPosDelta;
+				func(child, position, frame.halfSize / 2);
 			}
-			return newPos;
 		}
+	}
 
-		// Morton ordering
-		[[nodiscard]] int getIndexFromPosition(Vec3i queryPosition) {
-			int index = 0;
-			index |= queryPosition.x > this->position().x ? 4 : 0;
-			index |= queryPosition.y > this->position().y ? 2 : 0;
-			index |= queryPosition.z > this->position().z ? 1 : 0;
-			return index;
+	/// Call visitor(node, position, halfSize, depth) for every node from the root down, children in Morton order.
+	/// The children of a node are skipped if the visitor returns false or the node is maxDepth levels deep
+	template<typename F>
+	void visit(F&& visitor, int maxDepth = MAX_DEPTH) const {
+		if (!visitor(this->root_, Vec3i::zero(), this->rootHalfSize_, 0) || !this->root_.hasChildren() || maxDepth <= 0) {
+			return;
+		}
+		std::array<Frame, MAX_DEPTH> stack; // NOLINT(*-member-init)
+		int depth = 0;
+		stack[depth++] = {&this->block(this->root_.children_), Vec3i::zero(), this->rootHalfSize_, 0};
+		while (depth > 0) {
+			auto& frame = stack[depth - 1];
+			if (frame.index == 8) {
+				depth--;
+				continue;
+			}
+			const auto index = frame.index++;
+			const auto& child = (*frame.children)[index];
+			const auto position = Octree::getPositionFromIndex(frame.position, frame.halfSize, index);
+			const auto halfSize = frame.halfSize / 2;
+			if (visitor(child, position, halfSize, depth) && child.hasChildren() && depth < maxDepth) {
+				stack[depth++] = {&this->block(child.children_), position, halfSize, 0};
+			}
 		}
+	}
 
-	private:
-		std::variant<D, std::array<std::unique_ptr<Node>, 8>> data_;
-		// true - holds voxel, false - holds children
-		bool isLeaf = true;
-		// not centered
-		Vec3i position_;
-		// half the size of the voxel (radius?)
-		int halfSize_;
-	};
+	/// The node across a face of the node centered on the given position: the smallest node at least as large
+	/// as it, split or not. Axis is 0 for x, 1 for y and 2 for z. Returns nothing at the edge of the octree.
+	/// Walks down from the root, which takes at most log2(size) steps
+	[[nodiscard]] std::optional<NodeView> getNeighbor(Vec3i position, int halfSize, int axis, bool positive) const {
+		auto target = position;
+		auto& component = axis == 0 ? target.x : axis == 1 ? target.y : target.z;
+		component += positive ? halfSize * 2 : -halfSize * 2;
+		if (component <= -this->rootHalfSize_ || component >= this->rootHalfSize_) {
+			return std::nullopt;
+		}
+		const Node* node = &this->root_;
+		Vec3i nodePosition = Vec3i::zero();
+		int nodeHalfSize = this->rootHalfSize_;
+		while (nodeHalfSize > halfSize && node->hasChildren()) {
+			const auto index = Octree::getIndexFromPosition(nodePosition, target);
+			nodePosition = Octree::getPositionFromIndex(nodePosition, nodeHalfSize, index);
+			nodeHalfSize /= 2;
+			node = &this->block(node->children_)[index];
+		}
+		return NodeView{*node, nodePosition, nodeHalfSize};
+	}
 
-	explicit Octree(int size)
-		: root_(std::make_unique<Node>(Vec3i::zero(), size / 2)) {}
+	/// Replace every node with nodes read in preorder, children in Morton order. next(data) points data at the
+	/// next leaf's data, or sets it to nullptr if the next node is split, and returns false if there is no next node.
+	/// Leaves the octree empty if next() fails or splits a unit voxel
+	template<typename F>
+	[[nodiscard]] bool readPreorder(F&& next) {
+		this->clear();
+		if (!this->readPreorder(next, this->root_, this->rootHalfSize_)) {
+			this->clear();
+			return false;
+		}
+		return true;
+	}
 
-	/// Set voxel data in the octree
-	[[nodiscard]] bool set(Vec3i position, const D& data, bool forceMerge = false) {
-		return this->set(this->root_, position, data, forceMerge);
+	/// Call func(node, position, halfSize) for every leaf intersecting the box in Morton order.
+	/// Subtrees outside the box are skipped, the leaves of subtrees inside it are not tested again
+	template<typename F>
+	void forEachLeaf(const AABB& box, F&& func) const {
+		// Depth of the node enclosed by the box the walk is inside of
+		int enclosedDepth = MAX_DEPTH;
+		this->visit([&box, &func, &enclosedDepth](const Node& node, Vec3i position, int halfSize, int depth) {
+			if (depth <= enclosedDepth) {
+				const auto bounds = AABB::fromNode(position, halfSize);
+				if (!box.intersects(bounds)) {
+					return false;
+				}
+				enclosedDepth = box.encloses(bounds) ? depth : MAX_DEPTH;
+			}
+			if (!node.hasChildren()) {
+				func(node, position, halfSize);
+			}
+			return true;
+		});
 	}
 
-	/// Get an existing voxel from the octree. Returns nullptr if the voxel doesn't exist
-	[[nodiscard]] std::unique_ptr<Node>& get(Vec3i position) {
-		return this->get(this->root_, position);
+	/// The number of solid unit voxels with their center inside the box, the voxels fill() would set.
+	/// Subtrees inside the box answer from the count they cache, so this takes time in proportion
+	/// to the nodes crossing the boundary of the box rather than to its volume
+	[[nodiscard]] std::uint64_t occupancy(const AABB& box) const {
+		return this->occupancy(this->root_, Vec3i::zero(), this->rootHalfSize_, box);
 	}
 
-	[[nodiscard]] bool exists(Vec3i position) const {
-		return this->exists(this->root_, position);
+	/// Find the first solid leaf along the ray. Empty nodes are crossed in one step, whatever their size
+	[[nodiscard]] std::optional<Hit> raycast(const Ray& ray) const {
+		std::optional<Hit> hit;
+		const auto slabs = ray.getSlabs(AABB::fromNode(Vec3i::zero(), this->rootHalfSize_));
+		this->raycast(ray, ray.getChildOrderMask(), slabs, this->root_, Vec3i::zero(), this->rootHalfSize_, hit);
+		return hit;
 	}
 
-	void simplify() {
-		// todo
+	[[nodiscard]] std::optional<Hit> raycast(Vec3f origin, Vec3f direction, float maxDistance) const {
+		return this->raycast(Ray{origin, direction, maxDistance});
 	}
 
-	[[nodiscard]] std::unique_ptr<Node>& root() {
-		return this->root_;
+	/// Cast every ray, spread over the pool if one is given
+	[[nodiscard]] std::vector<std::optional<Hit>> raycast(const std::vector<Ray>& rays, ThreadPool* pool = nullptr) const {
+		std::vector<std::optional<Hit>> hits(rays.size());
+		const auto cast = [this, &rays, &hits](std::size_t batch) {
+			const auto last = std::min((batch + 1) * RAYCAST_BATCH_SIZE, rays.size());
+			for (auto i = batch * RAYCAST_BATCH_SIZE; i < last; i++) {
+				hits[i] = this->raycast(rays[i]);
+			}
+		};
+		const auto batches = (rays.size() + RAYCAST_BATCH_SIZE - 1) / RAYCAST_BATCH_SIZE;
+		if (pool) {
+			pool->parallelFor(batches, cast);
+		} else {
+			for (std::size_t i = 0; i < batches; i++) {
+				cast(i);
+			}
+		}
+		return hits;
 	}
 
-	[[nodiscard]] const std::unique_ptr<Node>& root() const {
+	/// Free every node at once, leaving a single empty root. Saved versions are freed too, unless snapshots were
+	/// published: readers may still be walking the pages then, so only the current nodes are released
+	void clear() {
+		if (this->snapshots_) {
+			this->release(this->root_);
+			this->root_ = Node{};
+			return;
+		}
+		this->root_ = Node{};
+		this->pages_.clear();
+		this->pageTable_.clear();
+		this->pageData_ = nullptr;
+		this->shares_.clear();
+		this->freeBlocks_.clear();
+		this->blockCount_ = 0;
+	}
+
+	/// Keep the current nodes as a version to come back to. Edits copy the blocks on their path instead of
+	/// writing to blocks a version uses, every untouched subtree stays shared. Release every saved version
+	[[nodiscard]] Version saveVersion() {
+		this->retain(this->root_);
+		Version version;
+		version.root_ = this->root_;
+		return version;
+	}
+
+	/// Swap in the nodes of a saved version, which stays saved
+	void restoreVersion(const Version& version) {
+		this->retain(version.root_);
+		const auto old = this->root_;
+		this->root_ = version.root_;
+		this->release(old);
+	}
+
+	/// Free the blocks only the version still uses
+	void releaseVersion(const Version& version) {
+		this->release(version.root_);
+	}
+
+	/// Make the current nodes the ones snapshot() pins, then reuse the blocks no pinned snapshot can reach anymore.
+	/// Call it from the editing thread after a batch of edits. The published nodes are kept like a saved version,
+	/// so later edits copy the blocks on their path instead of writing to blocks readers may be walking
+	void publish() {
+		if (!this->snapshots_) {
+			this->snapshots_ = std::make_unique<Snapshots>();
+		}
+		auto& snapshots = *this->snapshots_;
+		this->retain(this->root_);
+		auto old = std::exchange(snapshots.state, std::make_unique<const typename Snapshots::State>(this->root_, this->pageData_));
+		snapshots.published.store(snapshots.state.get());
+		// Readers pinning from now on load the new state, what only the old one reaches is retired past them
+		snapshots.epochs.advance();
+		if (old) {
+			this->release(old->root);
+			snapshots.retired.push_back({snapshots.epochs.getEpoch(), std::move(old), std::exchange(snapshots.replacedTables, {})});
+		}
+		this->reclaim();
+	}
+
+	/// Pin the last published nodes, from any thread and without locking. Later edits don't show in it, and nothing
+	/// it reaches is reused while it lives. Before the first publish() it views an empty octree
+	[[nodiscard]] Snapshot snapshot() const {
+		if (!this->snapshots_) {
+			return Snapshot({}, Octree(Node{}, this->rootHalfSize_, nullptr));
+		}
+		auto guard = this->snapshots_->epochs.pin();
+		const auto* state = this->snapshots_->published.load();
+		return Snapshot(std::move(guard), Octree(state->root, this->rootHalfSize_, state->pages));
+	}
+
+	/// Call func(node, position, halfSize) for every box that differs from the saved version, with the leaf holding
+	/// the box now. Every changed voxel is inside one of them. Subtrees shared with the version are skipped without being visited
+	template<typename F>
+	void forEachDifference(const Version& version, F&& func) const {
+		this->forEachDifference(func, this->root_, version.root_, Vec3i::zero(), this->rootHalfSize_);
+	}
+
+	[[nodiscard]] const Node& root() const {
 		return this->root_;
 	}
 
+	[[nodiscard]] const Block& block(Index index) const {
+		return this->pageData_[index >> PAGE_BITS]->blocks[index & (PAGE_SIZE - 1)];
+	}
+
+	[[nodiscard]] int size() const {
+		return this->rootHalfSize_ * 2;
+	}
+
+	/// The number of live nodes, including the root, the nodes only saved versions use and the ones pinned snapshots may reach
+	[[nodiscard]] std::size_t nodeCount() const {
+		return (this->blockCount_ - this->freeBlocks_.size()) * 8 + 1;
+	}
+
+	/// Bytes of the live nodes, the ones only saved versions use included
+	[[nodiscard]] std::size_t liveMemoryUsage() const {
+		return this->nodeCount() * sizeof(Node) + (this->blockCount_ - this->freeBlocks_.size()) * sizeof(std::uint64_t);
+	}
+
+	/// Bytes reserved by the node arena
+	[[nodiscard]] std::size_t memoryUsage() const {
+		return sizeof(Octree) + this->pages_.size() * sizeof(Page) + this->pageTable_.capacity() * sizeof(Page*) + (this->shares_.capacity() + this->freeBlocks_.capacity()) * sizeof(Index);
+	}
+
+	/// The center of the child at the given index
+	[[nodiscard]] static Vec3i getPositionFromIndex(Vec3i position, int halfSize, int index) {
+		const auto delta = halfSize / 2;
+		position.x += (index & 0b100) ? delta : -delta;
+		position.y += (index & 0b010) ? delta : -delta;
+		position.z += (index & 0b001) ? delta : -delta;
+		return position;
+	}
+
+	// Morton ordering
+	[[nodiscard]] static int getIndexFromPosition(Vec3i position, Vec3i queryPosition) {
+		int index = 0;
+		index |= queryPosition.x > position.x ? 4 : 0;
+		index |= queryPosition.y > position.y ? 2 : 0;
+		index |= queryPosition.z > position.z ? 1 : 0;
+		return index;
+	}
+
+	/// The half size of the node centered on the given position, or 0 if no node can be centered there
+	[[nodiscard]] static int getHalfSizeFromPosition(int rootHalfSize, Vec3i position) {
+		Vec3i nodePosition = Vec3i::zero();
+		for (int halfSize = rootHalfSize; !Octree::isPositionOnBounds(nodePosition, halfSize, position); halfSize /= 2) {
+			if (nodePosition == position) {
+				return halfSize;
+			}
+			nodePosition = Octree::getPositionFromIndex(nodePosition, halfSize, Octree::getIndexFromPosition(nodePosition, position));
+		}
+		return 0;
+	}
+
+	/// True if the query position is on the surface of the node or outside it
+	[[nodiscard]] static bool isPositionOnBounds(Vec3i position, int halfSize, Vec3i queryPosition) {
+		return queryPosition.x <= position.x - halfSize || queryPosition.x >= position.x + halfSize ||
+		       queryPosition.y <= position.y - halfSize || queryPosition.y >= position.y + halfSize ||
+		       queryPosition.z <= position.z - halfSize || queryPosition.z >= position.z + halfSize;
+	}
+
 private:
+	// 256 blocks per page, pages never move once allocated
+	static constexpr Index PAGE_BITS = 8;
+	static constexpr Index PAGE_SIZE = 1 << PAGE_BITS;
+
+	// Rays per task when casting on a pool
+	static constexpr std::size_t RAYCAST_BATCH_SIZE = 256;
+
+	/// Half size of the root of a fixed depth octree
+	static constexpr int FIXED_ROOT_HALF_SIZE = DEPTH > 0 ? 1 << (DEPTH - 1) : 0;
+
+	/// Blocks and the solid unit voxels under each of them, both are read through the page table a snapshot pinned
+	struct Page {
+		std::array<Block, PAGE_SIZE> blocks;
+		std::array<std::uint64_t, PAGE_SIZE> solidCounts;
+	};
+
+	/// What publish() shares with readers, and what it retired until they are past it
+	struct Snapshots {
+		/// The nodes readers pin, and the page table to find their blocks in
+		struct State {
+			Node root;
+			Page* const* pages;
+		};
+
+		/// A published state replaced in an epoch, with the page tables replaced while it was published
+		struct Retired {
+			std::uint64_t epoch;
+			std::unique_ptr<const State> state;
+			std::vector<std::vector<Page*>> tables;
+		};
+
+		EpochDomain epochs;
+		std::atomic<const State*> published{nullptr};
+		std::unique_ptr<const State> state;
+		/// Page tables replaced since the last publish, the published state may still point into them
+		std::vector<std::vector<Page*>> replacedTables;
+		std::vector<Retired> retired;
+		/// Freed blocks and the epoch they were freed in, oldest first
+		std::vector<std::pair<std::uint64_t, Index>> retiredBlocks;
+	};
+
+	/// A view of published nodes for a snapshot, owning none of them
+	Octree(const Node& root, int rootHalfSize, Page* const* pageData)
+		: root_(root)
+		, rootHalfSize_(rootHalfSize)
+		, pageData_(pageData) {}
+
+	[[nodiscard]] Block& block(Index index) {
+		return this->pageData_[index >> PAGE_BITS]->blocks[index & (PAGE_SIZE - 1)];
+	}
+
+	[[nodiscard]] std::uint64_t& solidCount(Index index) {
+		return this->pageData_[index >> PAGE_BITS]->solidCounts[index & (PAGE_SIZE - 1)];
+	}
+
+	[[nodiscard]] std::uint64_t solidCount(Index index) const {
+		return this->pageData_[index >> PAGE_BITS]->solidCounts[index & (PAGE_SIZE - 1)];
+	}
+
+	/// Take a block from the free list, or from a new page if none is free
+	[[nodiscard]] Index allocate() {
+		if (!this->freeBlocks_.empty()) {
+			const auto index = this->freeBlocks_.back();
+			this->freeBlocks_.pop_back();
+			return index;
+		}
+		if (this->blockCount_ == this->pages_.size() * PAGE_SIZE) {
+			this->addPage();
+		}
+		this->shares_.push_back(0);
+		return this->blockCount_++;
+	}
+
+	void addPage() {
+		if (this->snapshots_ && this->pageTable_.size() == this->pageTable_.capacity()) {
+			// Growing the table in place would move it under readers, they keep the old one until the next publish
+			auto table = this->pageTable_;
+			table.reserve(std::max<std::size_t>(table.size() * 2, 16));
+			this->snapshots_->replacedTables.push_back(std::exchange(this->pageTable_, std::move(table)));
+		}
+		this->pages_.push_back(std::make_unique<Page>());
+		this->pageTable_.push_back(this->pages_.back().get());
+		this->pageData_ = this->pageTable_.data();
+	}
+
+	/// Put a freed block on the free list, or retire it while pinned snapshots may still reach it
+	void free(Index index) {
+		if (this->snapshots_) {
+			this->snapshots_->retiredBlocks.emplace_back(this->snapshots_->epochs.getEpoch(), index);
+			return;
+		}
+		this->block(index).fill(Node{});
+		this->freeBlocks_.push_back(index);
+	}
+
+	/// Reuse the blocks and drop the states retired before the epoch of every pinned snapshot
+	void reclaim() {
+		auto& snapshots = *this->snapshots_;
+		const auto safeEpoch = snapshots.epochs.getSafeEpoch();
+		const auto blocksEnd = std::find_if(snapshots.retiredBlocks.begin(), snapshots.retiredBlocks.end(), [safeEpoch](const auto& retired) {
+			return retired.first >= safeEpoch;
+		});
+		for (auto it = snapshots.retiredBlocks.begin(); it != blocksEnd; ++it) {
+			this->block(it->second).fill(Node{});
+			this->freeBlocks_.push_back(it->second);
+		}
+		snapshots.retiredBlocks.erase(snapshots.retiredBlocks.begin(), blocksEnd);
+		std::erase_if(snapshots.retired, [safeEpoch](const auto& retired) {
+			return retired.epoch < safeEpoch;
+		});
+	}
+
+	/// Split voxel into 8 subvoxels holding the same data
+	void subdivide(Node& node, int halfSize) {
+		const auto index = this->allocate();
+		for (auto& child : this->block(index)) {
+			child.data_ = node.data_;
+			child.children_ = NO_CHILDREN;
+		}
+		this->solidCount(index) = this->getSolidCount(node, halfSize);
+		node.children_ = index;
+	}
+
+	[[nodiscard]] static bool isSolid(const Node& node) {
+		return !(node.data_ == D{});
+	}
+
+	/// Solid unit voxels under the node
+	[[nodiscard]] std::uint64_t getSolidCount(const Node& node, int halfSize) const {
+		if (node.hasChildren()) {
+			return this->solidCount(node.children_);
+		}
+		return Octree::isSolid(node) ? static_cast<std::uint64_t>(halfSize) * halfSize * halfSize : 0;
+	}
+
+	/// Recount the solid unit voxels of a split node from its children
+	void updateSolidCount(const Node& node, int halfSize) {
+		std::uint64_t count = 0;
+		for (const auto& child : this->block(node.children_)) {
+			count += this->getSolidCount(child, halfSize / 2);
+		}
+		this->solidCount(node.children_) = count;
+	}
+
+	/// The children of a node, ready to be written. A block saved versions share is copied first,
+	/// the copy shares the grandchildren instead
+	[[nodiscard]] Block& getWritableChildren(Node& node) {
+		if (this->shares_[node.children_] == 0) {
+			return this->block(node.children_);
+		}
+		this->shares_[node.children_]--;
+		const auto index = this->allocate();
+		auto& copy = this->block(index);
+		copy = this->block(node.children_);
+		for (const auto& child : copy) {
+			if (child.hasChildren()) {
+				this->shares_[child.children_]++;
+			}
+		}
+		this->solidCount(index) = this->solidCount(node.children_);
+		node.children_ = index;
+		return copy;
+	}
+
+	/// Add an owner to the children of the node
+	void retain(const Node& node) {
+		if (node.hasChildren()) {
+			this->shares_[node.children_]++;
+		}
+	}
+
+	/// Remove an owner from the children of the node, freeing them along with their subtree when it was the last
+	void release(const Node& node) {
+		if (node.hasChildren()) {
+			this->release(node.children_);
+		}
+	}
+
 	// NOLINTNEXTLINE(*-no-recursion)
-	[[nodiscard]] bool set(std::unique_ptr<Node>& node, Vec3i position, const D& data, bool forceMerge = false) {
-		if (node->isPositionOnBounds(position)) {
+	[[nodiscard]] Index copyChildren(const Octree& other, Index children) {
+		const auto index = this->allocate();
+		auto& copy = this->block(index);
+		copy = other.block(children);
+		this->solidCount(index) = other.solidCount(children);
+		for (auto& child : copy) {
+			if (child.hasChildren()) {
+				child.children_ = this->copyChildren(other, child.children_);
+			}
+		}
+		return index;
+	}
+
+	/// Merge 8 subvoxels into one voxel
+	void merge(Node& node, D data) {
+		this->release(node.children_);
+		node.data_ = std::move(data);
+		node.children_ = NO_CHILDREN;
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	void fill(Node& node, Vec3i position, int halfSize, const AABB& box, const D& data) {
+		const auto bounds = AABB::fromNode(position, halfSize);
+		if (!box.intersects(bounds)) {
+			return;
+		}
+		if (box.encloses(bounds) || (halfSize == 1 && box.contains(position))) {
+			if (node.hasChildren()) {
+				this->merge(node, data);
+			} else {
+				node.data_ = data;
+			}
+			return;
+		}
+		if (halfSize == 1) {
+			return;
+		}
+		if (!node.hasChildren()) {
+			if (node.data_ == data) {
+				return;
+			}
+			this->subdivide(node, halfSize);
+		}
+		auto& children = this->getWritableChildren(node);
+		for (int i = 0; i < 8; i++) {
+			this->fill(children[i], Octree::getPositionFromIndex(position, halfSize, i), halfSize / 2, box, data);
+		}
+		if (!this->tryMerge(node)) {
+			this->updateSolidCount(node, halfSize);
+		}
+	}
+
+	/// Walk batches of positions down the octree until resolve(i, node, centered, outside) returns true for every one,
+	/// where node is the node positions[i] is in, and the flags are those of PointBatch::Step for it
+	template<typename F>
+	void descendBatch(std::span<const Vec3i> positions, F&& resolve) const {
+		PointBatch batch; // NOLINT(*-member-init)
+		std::array<const Node*, PointBatch::WIDTH> nodes; // NOLINT(*-member-init)
+		for (std::size_t first = 0; first < positions.size(); first += PointBatch::WIDTH) {
+			const auto count = std::min(PointBatch::WIDTH, positions.size() - first);
+			batch.load(positions.subspan(first, count));
+			nodes.fill(&this->root_);
+			auto pending = static_cast<std::uint32_t>((std::uint64_t{1} << count) - 1);
+			for (int halfSize = this->rootHalfSize_; pending; halfSize /= 2) {
+				const auto step = batch.step(halfSize);
+				for (auto lanes = pending; lanes; lanes &= lanes - 1) {
+					const auto lane = std::countr_zero(lanes);
+					const auto bit = std::uint32_t{1} << lane;
+					const Node& node = *nodes[lane];
+					if (resolve(first + lane, node, (step.centered & bit) != 0, (step.outside & bit) != 0)) {
+						pending &= ~bit;
+					} else {
+						nodes[lane] = &this->block(node.children_)[batch.indices[lane]];
+					}
+				}
+			}
+		}
+	}
+
+	/// Store data in the node set() walked down to along path, merging the nodes above it where it can
+	[[nodiscard]] bool assign(const std::array<Node*, MAX_DEPTH>& path, int depth, Node& node, int halfSize, const D& data, bool forceMerge) {
+		if (node.hasChildren() && !forceMerge) {
+			return false;
+		}
+		// The nodes above change by as many solid voxels as the edited one, merging keeps the count
+		const auto solidCount = this->getSolidCount(node, halfSize);
+		if (node.hasChildren()) {
+			this->merge(node, data);
+		} else {
+			node.data_ = data;
+		}
+		const auto delta = this->getSolidCount(node, halfSize) - solidCount;
+		while (depth > 0 && this->tryMerge(*path[depth - 1])) {
+			depth--;
+		}
+		if (delta != 0) {
+			while (depth > 0) {
+				this->solidCount(path[--depth]->children_) += delta;
+			}
+		}
+		return true;
+	}
+
+	/// Offset of a position inside a fixed depth octree from one unit past its lowest corner. Bit DEPTH - 1 - level
+	/// of each component says which side of the center of the node at that level the position is on
+	[[nodiscard]] static Vec3i getFixedOffset(Vec3i position) {
+		return {position.x + FIXED_ROOT_HALF_SIZE - 1, position.y + FIXED_ROOT_HALF_SIZE - 1, position.z + FIXED_ROOT_HALF_SIZE - 1};
+	}
+
+	/// The child toward the position of the node at the given level, in Morton order like getIndexFromPosition()
+	template<int LEVEL>
+	[[nodiscard]] static int getFixedIndex(Vec3i offset) {
+		constexpr int BIT = DEPTH - 1 - LEVEL;
+		return ((offset.x >> BIT) & 1) << 2 | ((offset.y >> BIT) & 1) << 1 | ((offset.z >> BIT) & 1);
+	}
+
+	/// getHalfSizeFromPosition() for a fixed depth octree. Below the root, centers are odd multiples of the half size
+	/// on every axis, so it is the lowest set bit all three coordinates share
+	[[nodiscard]] static int getFixedHalfSize(Vec3i position) {
+		if (Octree::isPositionOnBounds(Vec3i::zero(), FIXED_ROOT_HALF_SIZE, position)) {
+			return 0;
+		}
+		if (position == Vec3i::zero()) {
+			return FIXED_ROOT_HALF_SIZE;
+		}
+		const auto bit = std::countr_zero(static_cast<std::uint32_t>(position.x));
+		if (bit >= DEPTH - 1 || std::countr_zero(static_cast<std::uint32_t>(position.y)) != bit || std::countr_zero(static_cast<std::uint32_t>(position.z)) != bit) {
+			return 0;
+		}
+		return 1 << bit;
+	}
+
+	/// Call step(level) with the level as a std::integral_constant, from the root down to the parents of the
+	/// unit voxels, until it returns false. Unrolled, so sizes and shifts derived from the level are constants
+	template<typename F>
+	static void descendFixed(F&& step) {
+		[&step]<int... LEVELS>(std::integer_sequence<int, LEVELS...>) {
+			(step(std::integral_constant<int, LEVELS>{}) && ...);
+		}(std::make_integer_sequence<int, DEPTH - 1>{});
+	}
+
+	[[nodiscard]] bool setFixed(Vec3i position, const D& data, bool forceMerge) {
+		const auto targetHalfSize = Octree::getFixedHalfSize(position);
+		if (!targetHalfSize) {
 			return false;
 		}
-		if (node->position() == position) {
-			if (node->hasChildren() && !forceMerge) {
+		const auto offset = Octree::getFixedOffset(position);
+		std::array<Node*, MAX_DEPTH> path; // NOLINT(*-member-init)
+		int depth = 0;
+		Node* node = &this->root_;
+		bool covered = false;
+		Octree::descendFixed([this, &path, &depth, &node, &covered, targetHalfSize, offset, &data](auto level) {
+			constexpr int LEVEL = decltype(level)::value;
+			constexpr int HALF_SIZE = FIXED_ROOT_HALF_SIZE >> LEVEL;
+			if (HALF_SIZE == targetHalfSize) {
 				return false;
 			}
-			node->merge(data);
+			if (!node->hasChildren()) {
+				if (node->data_ == data) {
+					// Already covered by a leaf holding this data
+					covered = true;
+					return false;
+				}
+				this->subdivide(*node, HALF_SIZE);
+			}
+			path[depth++] = node;
+			node = &this->getWritableChildren(*node)[Octree::getFixedIndex<LEVEL>(offset)];
 			return true;
+		});
+		return covered || this->assign(path, depth, *node, targetHalfSize, data, forceMerge);
+	}
+
+	[[nodiscard]] const Node* getFixed(Vec3i position) const {
+		if (Octree::isPositionOnBounds(Vec3i::zero(), FIXED_ROOT_HALF_SIZE, position)) {
+			return nullptr;
 		}
-		if (!node->hasChildren()) {
-			node->subdivide();
+		const auto offset = Octree::getFixedOffset(position);
+		const Node* node = &this->root_;
+		// Below the root, node surfaces lie on multiples of the node size, which the smaller nodes inside share
+		int sizeMask = 0;
+		Octree::descendFixed([this, &node, &sizeMask, offset](auto level) {
+			constexpr int LEVEL = decltype(level)::value;
+			if (!node->hasChildren()) {
+				return false;
+			}
+			node = &this->block(node->children_)[Octree::getFixedIndex<LEVEL>(offset)];
+			sizeMask = FIXED_ROOT_HALF_SIZE >> LEVEL;
+			return true;
+		});
+		if (sizeMask && (!(position.x & (sizeMask - 1)) || !(position.y & (sizeMask - 1)) || !(position.z & (sizeMask - 1)))) {
+			return nullptr;
 		}
-		return this->set(node->child(node->getIndexFromPosition(position)), position, data);
+		return node;
+	}
+
+	[[nodiscard]] bool existsFixed(Vec3i position) const {
+		const auto targetHalfSize = Octree::getFixedHalfSize(position);
+		if (!targetHalfSize) {
+			return false;
+		}
+		const auto offset = Octree::getFixedOffset(position);
+		const Node* node = &this->root_;
+		Octree::descendFixed([this, &node, targetHalfSize, offset](auto level) {
+			constexpr int LEVEL = decltype(level)::value;
+			if ((FIXED_ROOT_HALF_SIZE >> LEVEL) == targetHalfSize) {
+				return false;
+			}
+			if (!node->hasChildren()) {
+				node = nullptr;
+				return false;
+			}
+			node = &this->block(node->children_)[Octree::getFixedIndex<LEVEL>(offset)];
+			return true;
+		});
+		return node != nullptr;
+	}
+
+	/// Merge the children of the node if they are all leaves holding equal data
+	bool tryMerge(Node& node) {
+		const auto& children = this->block(node.children_);
+		for (const auto& child : children) {
+			if (child.hasChildren() || !(child.data_ == children[0].data_)) {
+				return false;
+			}
+		}
+		this->merge(node, children[0].data_);
+		return true;
 	}
 
 	// NOLINTNEXTLINE(*-no-recursion)
-	[[nodiscard]] std::unique_ptr<Node>& get(std::unique_ptr<Node>& node, Vec3i position) {
-		if (node->isPositionOnBounds(position)) {
-			static std::unique_ptr<Node> INVALID = nullptr;
-			return INVALID;
+	void simplify(Node& node) {
+		if (!node.hasChildren()) {
+			return;
 		}
-		if (!node->hasChildren()) {
-			return node;
+		for (auto& child : this->getWritableChildren(node)) {
+			this->simplify(child);
 		}
-		auto& child = node->child(node->getIndexFromPosition(position));
-		return this->get(child, position);
+		this->tryMerge(node);
 	}
 
 	// NOLINTNEXTLINE(*-no-recursion)
-	[[nodiscard]] bool exists(const std::unique_ptr<Node>& node, Vec3i position) const {
-		if (node->isPositionOnBounds(position)) {
+	template<typename F>
+	bool readPreorder(F& next, Node& node, int halfSize) {
+		const D* data = nullptr;
+		if (!next(data)) {
 			return false;
 		}
-		if (node->position() == position) {
+		if (data) {
+			node.data_ = *data;
 			return true;
 		}
-		if (!node->hasChildren()) {
+		if (halfSize == 1) {
 			return false;
 		}
-		auto& child = node->children()[node->getIndexFromPosition(position)];
-		if (!child) {
+		this->subdivide(node, halfSize);
+		for (auto& child : this->block(node.children_)) {
+			if (!this->readPreorder(next, child, halfSize / 2)) {
+				return false;
+			}
+		}
+		this->updateSolidCount(node, halfSize);
+		return true;
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	[[nodiscard]] std::uint64_t occupancy(const Node& node, Vec3i position, int halfSize, const AABB& box) const {
+		const auto bounds = AABB::fromNode(position, halfSize);
+		if (!box.intersects(bounds)) {
+			return 0;
+		}
+		if (box.encloses(bounds)) {
+			return this->getSolidCount(node, halfSize);
+		}
+		if (!node.hasChildren()) {
+			if (!Octree::isSolid(node)) {
+				return 0;
+			}
+			// Unit voxel centers sit at odd offsets from the corner of the leaf
+			const auto centers = [halfSize](int min, int max, int corner) -> std::uint64_t {
+				const auto first = (std::clamp(min - corner - 1, 0, halfSize * 2) + 1) / 2;
+				const auto last = (std::clamp(max - corner - 1, 0, halfSize * 2) + 1) / 2;
+				return last - first;
+			};
+			return centers(box.min.x, box.max.x, bounds.min.x) * centers(box.min.y, box.max.y, bounds.min.y) * centers(box.min.z, box.max.z, bounds.min.z);
+		}
+		std::uint64_t count = 0;
+		const auto& children = this->block(node.children_);
+		for (int i = 0; i < 8; i++) {
+			count += this->occupancy(children[i], Octree::getPositionFromIndex(position, halfSize, i), halfSize / 2, box);
+		}
+		return count;
+	}
+
+	/// Visit the children the ray crosses front to back, stopping at the first solid leaf
+	// NOLINTNEXTLINE(*-no-recursion)
+	bool raycast(const Ray& ray, int mask, const Ray::Slabs& slabs, const Node& node, Vec3i position, int halfSize, std::optional<Hit>& hit) const {
+		const auto span = slabs.getSpan();
+		if (!span.isHit() || span.exit < 0.f || span.enter > ray.maxDistance) {
 			return false;
 		}
-		return this->exists(child, position);
+		if (!node.hasChildren()) {
+			if (node.data_ == D{}) {
+				return false;
+			}
+			hit = Hit::fromSpan(node, position, halfSize, ray, span);
+			return true;
+		}
+		const auto& children = this->block(node.children_);
+		// Only the children the ray passes through are visited, in order
+		const auto splits = ray.getSplits(slabs, position);
+		for (int order = Ray::getFirstChild(splits, span.enter); order >= 0;) {
+			const int index = order ^ mask;
+			const auto childSlabs = Ray::getChildSlabs(slabs, splits, mask, index);
+			if (this->raycast(ray, mask, childSlabs, children[index], Octree::getPositionFromIndex(position, halfSize, index), halfSize / 2, hit)) {
+				return true;
+			}
+			order = Ray::getNextChild(childSlabs, order);
+		}
+		return false;
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	template<typename F>
+	void forEachDifference(F& func, const Node& node, const Node& other, Vec3i position, int halfSize) const {
+		if (node.hasChildren() && node.children_ == other.children_) {
+			return;
+		}
+		if (!node.hasChildren()) {
+			if (!other.hasChildren()) {
+				if (!(node.data_ == other.data_)) {
+					func(node, position, halfSize);
+				}
+				return;
+			}
+			// Only the parts of the leaf where the version differs
+			const auto& otherChildren = this->block(other.children_);
+			for (int i = 0; i < 8; i++) {
+				this->forEachDifference(func, node, otherChildren[i], Octree::getPositionFromIndex(position, halfSize, i), halfSize / 2);
+			}
+			return;
+		}
+		const auto& children = this->block(node.children_);
+		for (int i = 0; i < 8; i++) {
+			// A leaf in the version covers all of the children
+			const auto& otherChild = other.hasChildren() ? this->block(other.children_)[i] : other;
+			this->forEachDifference(func, children[i], otherChild, Octree::getPositionFromIndex(position, halfSize, i), halfSize / 2);
+		}
+	}
+
+	// NOLINTNEXTLINE(*-no-recursion)
+	void release(Index index) {
+		if (this->shares_[index] > 0) {
+			// Still used by another owner
+			this->shares_[index]--;
+			return;
+		}
+		for (const auto& child : this->block(index)) {
+			if (child.hasChildren()) {
+				this->release(child.children_);
+			}
+		}
+		this->free(index);
 	}
 
-	std::unique_ptr<Node> root_;
+	Node root_;
+	int rootHalfSize_;
+
+	std::vector<std::unique_ptr<Page>> pages_;
+	/// The page of each page index. Never moved while snapshots are published, a larger copy replaces it instead
+	std::vector<Page*> pageTable_;
+	/// The page table blocks are looked up in, the one of the published state for a snapshot
+	Page* const* pageData_ = nullptr;
+	/// Owners of each block besides the first, blocks with any are copied before they are written
+	std::vector<Index> shares_;
+	Index blockCount_ = 0;
+	std::vector<Index> freeBlocks_;
+	std::unique_ptr<Snapshots> snapshots_;
+};
+
+/// Holds its epoch pinned, so the blocks of the published nodes it views stay as they were.
+/// Only the queries are meaningful on the view, it owns none of the nodes
+template<typename D, int DEPTH>
+class Octree<D, DEPTH>::Snapshot {
+public:
+	[[nodiscard]] const Octree& operator*() const {
+		return this->tree_;
+	}
+
+	[[nodiscard]] const Octree* operator->() const {
+		return &this->tree_;
+	}
+
+private:
+	friend class Octree;
+
+	Snapshot(EpochDomain::Guard guard, Octree tree)
+		: guard_(std::move(guard))
+		, tree_(std::move(tree)) {}
+
+	// Declared first so the epoch is left after the view is gone
+	EpochDomain::Guard guard_;
+	Octree tree_;
 };
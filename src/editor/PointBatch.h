@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include <sourcepp/math/Vector.h>
+
+using namespace sourcepp::math;
+
+/// Positions descending an octree together, one lane each. The lanes move down a level at a time, so they are all
+/// in nodes of the same half size. Every lane is stepped at once with AVX2 or SSE2, whichever the compiler targets
+struct PointBatch {
+	/// Lanes per batch, enough loads in flight to hide most of the cache misses of a level
+	static constexpr std::size_t WIDTH = 16;
+
+	/// What a step found out about the nodes the lanes were in, one bit per lane
+	struct Step {
+		/// The position is the center of the node
+		std::uint32_t centered;
+		/// The position is on the surface of the node or outside it
+		std::uint32_t outside;
+	};
+
+	alignas(32) std::array<std::int32_t, WIDTH> x;
+	alignas(32) std::array<std::int32_t, WIDTH> y;
+	alignas(32) std::array<std::int32_t, WIDTH> z;
+	/// Center of the node each lane is in
+	alignas(32) std::array<std::int32_t, WIDTH> centerX;
+	alignas(32) std::array<std::int32_t, WIDTH> centerY;
+	alignas(32) std::array<std::int32_t, WIDTH> centerZ;
+	/// Child of that node toward the position, in Morton order
+	alignas(32) std::array<std::int32_t, WIDTH> indices;
+
+	/// Start up to WIDTH positions at the root, lanes past the end hold the origin
+	void load(std::span<const Vec3i> positions) {
+		this->x.fill(0);
+		this->y.fill(0);
+		this->z.fill(0);
+		for (std::size_t i = 0; i < positions.size(); i++) {
+			this->x[i] = positions[i].x;
+			this->y[i] = positions[i].y;
+			this->z[i] = positions[i].z;
+		}
+		this->centerX.fill(0);
+		this->centerY.fill(0);
+		this->centerZ.fill(0);
+	}
+
+	/// Test every lane against its node, then move its center to the child toward its position
+	[[nodiscard]] Step step(int halfSize) {
+		Step result{0, 0};
+#if defined(__AVX2__)
+		const auto size = _mm256_set1_epi32(halfSize);
+		const auto delta = _mm256_set1_epi32(halfSize / 2);
+		const auto delta2 = _mm256_set1_epi32(halfSize / 2 * 2);
+		for (std::size_t i = 0; i < WIDTH; i += 8) {
+			const auto px = _mm256_load_si256(reinterpret_cast<const __m256i*>(&this->x[i]));
+			const auto py = _mm256_load_si256(reinterpret_cast<const __m256i*>(&this->y[i]));
+			const auto pz = _mm256_load_si256(reinterpret_cast<const __m256i*>(&this->z[i]));
+			auto cx = _mm256_load_si256(reinterpret_cast<const __m256i*>(&this->centerX[i]));
+			auto cy = _mm256_load_si256(reinterpret_cast<const __m256i*>(&this->centerY[i]));
+			auto cz = _mm256_load_si256(reinterpret_cast<const __m256i*>(&this->centerZ[i]));
+
+			const auto centered = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi32(px, cx), _mm256_cmpeq_epi32(py, cy)), _mm256_cmpeq_epi32(pz, cz));
+			const auto insideX = _mm256_and_si256(_mm256_cmpgt_epi32(px, _mm256_sub_epi32(cx, size)), _mm256_cmpgt_epi32(_mm256_add_epi32(cx, size), px));
+			const auto insideY = _mm256_and_si256(_mm256_cmpgt_epi32(py, _mm256_sub_epi32(cy, size)), _mm256_cmpgt_epi32(_mm256_add_epi32(cy, size), py));
+			const auto insideZ = _mm256_and_si256(_mm256_cmpgt_epi32(pz, _mm256_sub_epi32(cz, size)), _mm256_cmpgt_epi32(_mm256_add_epi32(cz, size), pz));
+			const auto inside = _mm256_and_si256(_mm256_and_si256(insideX, insideY), insideZ);
+			result.centered |= static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(centered))) << i;
+			result.outside |= (~static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(inside))) & 0xFF) << i;
+
+			const auto greaterX = _mm256_cmpgt_epi32(px, cx);
+			const auto greaterY = _mm256_cmpgt_epi32(py, cy);
+			const auto greaterZ = _mm256_cmpgt_epi32(pz, cz);
+			const auto index = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(greaterX, _mm256_set1_epi32(4)), _mm256_and_si256(greaterY, _mm256_set1_epi32(2))), _mm256_and_si256(greaterZ, _mm256_set1_epi32(1)));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&this->indices[i]), index);
+			// Plus delta toward greater coordinates, minus delta otherwise
+			cx = _mm256_add_epi32(cx, _mm256_sub_epi32(_mm256_and_si256(greaterX, delta2), delta));
+			cy = _mm256_add_epi32(cy, _mm256_sub_epi32(_mm256_and_si256(greaterY, delta2), delta));
+			cz = _mm256_add_epi32(cz, _mm256_sub_epi32(_mm256_and_si256(greaterZ, delta2), delta));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&this->centerX[i]), cx);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&this->centerY[i]), cy);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&this->centerZ[i]), cz);
+		}
+#elif defined(__SSE2__) || defined(_M_X64)
+		const auto size = _mm_set1_epi32(halfSize);
+		const auto delta = _mm_set1_epi32(halfSize / 2);
+		const auto delta2 = _mm_set1_epi32(halfSize / 2 * 2);
+		for (std::size_t i = 0; i < WIDTH; i += 4) {
+			const auto px = _mm_load_si128(reinterpret_cast<const __m128i*>(&this->x[i]));
+			const auto py = _mm_load_si128(reinterpret_cast<const __m128i*>(&this->y[i]));
+			const auto pz = _mm_load_si128(reinterpret_cast<const __m128i*>(&this->z[i]));
+			auto cx = _mm_load_si128(reinterpret_cast<const __m128i*>(&this->centerX[i]));
+			auto cy = _mm_load_si128(reinterpret_cast<const __m128i*>(&this->centerY[i]));
+			auto cz = _mm_load_si128(reinterpret_cast<const __m128i*>(&this->centerZ[i]));
+
+			const auto centered = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi32(px, cx), _mm_cmpeq_epi32(py, cy)), _mm_cmpeq_epi32(pz, cz));
+			const auto insideX = _mm_and_si128(_mm_cmpgt_epi32(px, _mm_sub_epi32(cx, size)), _mm_cmplt_epi32(px, _mm_add_epi32(cx, size)));
+			const auto insideY = _mm_and_si128(_mm_cmpgt_epi32(py, _mm_sub_epi32(cy, size)), _mm_cmplt_epi32(py, _mm_add_epi32(cy, size)));
+			const auto insideZ = _mm_and_si128(_mm_cmpgt_epi32(pz, _mm_sub_epi32(cz, size)), _mm_cmplt_epi32(pz, _mm_add_epi32(cz, size)));
+			const auto inside = _mm_and_si128(_mm_and_si128(insideX, insideY), insideZ);
+			result.centered |= static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(centered))) << i;
+			result.outside |= (~static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(inside))) & 0xF) << i;
+
+			const auto greaterX = _mm_cmpgt_epi32(px, cx);
+			const auto greaterY = _mm_cmpgt_epi32(py, cy);
+			const auto greaterZ = _mm_cmpgt_epi32(pz, cz);
+			const auto index = _mm_or_si128(_mm_or_si128(_mm_and_si128(greaterX, _mm_set1_epi32(4)), _mm_and_si128(greaterY, _mm_set1_epi32(2))), _mm_and_si128(greaterZ, _mm_set1_epi32(1)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(&this->indices[i]), index);
+			// Plus delta toward greater coordinates, minus delta otherwise
+			cx = _mm_add_epi32(cx, _mm_sub_epi32(_mm_and_si128(greaterX, delta2), delta));
+			cy = _mm_add_epi32(cy, _mm_sub_epi32(_mm_and_si128(greaterY, delta2), delta));
+			cz = _mm_add_epi32(cz, _mm_sub_epi32(_mm_and_si128(greaterZ, delta2), delta));
+			_mm_store_si128(reinterpret_cast<__m128i*>(&this->centerX[i]), cx);
+			_mm_store_si128(reinterpret_cast<__m128i*>(&this->centerY[i]), cy);
+			_mm_store_si128(reinterpret_cast<__m128i*>(&this->centerZ[i]), cz);
+		}
+#else
+		const auto delta = halfSize / 2;
+		for (std::size_t i = 0; i < WIDTH; i++) {
+			auto& cx = this->centerX[i];
+			auto& cy = this->centerY[i];
+			auto& cz = this->centerZ[i];
+			if (this->x[i] == cx && this->y[i] == cy && this->z[i] == cz) {
+				result.centered |= 1u << i;
+			}
+			if (this->x[i] <= cx - halfSize || this->x[i] >= cx + halfSize ||
+			    this->y[i] <= cy - halfSize || this->y[i] >= cy + halfSize ||
+			    this->z[i] <= cz - halfSize || this->z[i] >= cz + halfSize) {
+				result.outside |= 1u << i;
+			}
+			this->indices[i] = (this->x[i] > cx ? 4 : 0) | (this->y[i] > cy ? 2 : 0) | (this->z[i] > cz ? 1 : 0);
+			cx += this->x[i] > cx ? delta : -delta;
+			cy += this->y[i] > cy ? delta : -delta;
+			cz += this->z[i] > cz ? delta : -delta;
+		}
+#endif
+		return result;
+	}
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(DEBUG) || defined(PUZZLEMAKER_CE_ENABLE_PROFILER)
+#define PUZZLEMAKER_CE_PROFILER_ENABLED
+#endif
+
+/// Time spent in named zones of code, kept per thread in a ring buffer so recording never takes a lock after
+/// the first zone of a thread. The newest RING_SIZE zones of every thread can be written as a Chrome trace,
+/// open it in chrome://tracing or ui.perfetto.dev. A zone costs two clock reads and four relaxed stores, about
+/// 70 ns (see BM_Profiler_zone). Zones are compiled out of release builds unless PUZZLEMAKER_CE_ENABLE_PROFILER is set
+class Profiler {
+public:
+	/// Zones kept per thread, older ones are overwritten
+	static constexpr std::size_t RING_SIZE = 1 << 14;
+
+	struct Event {
+		/// A string literal
+		const char* name;
+		/// Nanoseconds since the profiler was created
+		std::int64_t start;
+		std::int64_t duration;
+		/// Numbered in the order threads recorded their first zone
+		std::uint32_t thread;
+	};
+
+	/// Records the time from its construction to its destruction. Use through PUZZLEMAKER_CE_PROFILE_ZONE,
+	/// which is compiled out unless the profiler is enabled
+	class Zone {
+	public:
+		explicit Zone(const char* name, Profiler& profiler = Profiler::get())
+			: name_(name)
+			, profiler_(profiler)
+			, start_(profiler.now()) {}
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+		~Zone() {
+			this->profiler_.record(this->name_, this->start_, this->profiler_.now() - this->start_);
+		}
+
+	private:
+		const char* name_;
+		Profiler& profiler_;
+		std::int64_t start_;
+	};
+
+	Profiler()
+		: id_(nextId().fetch_add(1, std::memory_order_relaxed))
+		, origin_(std::chrono::steady_clock::now()) {}
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	/// The profiler zones record into by default
+	[[nodiscard]] static Profiler& get() {
+		static Profiler profiler;
+		return profiler;
+	}
+
+	/// Nanoseconds since the profiler was created
+	[[nodiscard]] std::int64_t now() const {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->origin_).count();
+	}
+
+	/// Add a zone to the ring of the calling thread. The name must outlive the profiler
+	void record(const char* name, std::int64_t start, std::int64_t duration) {
+		auto& ring = this->getRing();
+		const auto index = ring.written.load(std::memory_order_relaxed);
+		auto& slot = ring.slots[index % RING_SIZE];
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.start.store(start, std::memory_order_relaxed);
+		slot.duration.store(duration, std::memory_order_relaxed);
+		ring.written.store(index + 1, std::memory_order_release);
+	}
+
+	/// The zones every thread still holds, ordered by start. Threads may keep recording meanwhile,
+	/// zones they overwrite while being read are left out
+	[[nodiscard]] std::vector<Event> collect() const {
+		std::vector<Event> events;
+		std::scoped_lock lock(this->mutex_);
+		for (const auto& [thread, ring] : this->rings_) {
+			const auto written = ring->written.load(std::memory_order_acquire);
+			const auto first = std::max(ring->cleared.load(std::memory_order_relaxed), written > RING_SIZE ? written - RING_SIZE : 0);
+			const auto begin = events.size();
+			for (auto index = first; index < written; index++) {
+				const auto& slot = ring->slots[index % RING_SIZE];
+				events.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed), slot.duration.load(std::memory_order_relaxed), ring->thread});
+			}
+			// Slots the thread wrapped around to while they were copied may be torn
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const auto rewritten = ring->written.load(std::memory_order_relaxed);
+			if (rewritten > first + RING_SIZE) {
+				const auto torn = std::min<std::size_t>(rewritten - RING_SIZE - first, events.size() - begin);
+				events.erase(events.begin() + static_cast<std::ptrdiff_t>(begin), events.begin() + static_cast<std::ptrdiff_t>(begin + torn));
+			}
+		}
+		std::sort(events.begin(), events.end(), [](const Event& lhs, const Event& rhs) {
+			return lhs.start < rhs.start;
+		});
+		return events;
+	}
+
+	/// Forget the zones recorded so far
+	void clear() {
+		std::scoped_lock lock(this->mutex_);
+		for (auto& [thread, ring] : this->rings_) {
+			ring->cleared.store(ring->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+		}
+	}
+
+	/// Write the zones as complete events of a Chrome trace
+	[[nodiscard]] bool writeChromeTrace(std::ostream& stream) const {
+		const auto flags = stream.flags();
+		const auto precision = stream.precision();
+		// Timestamps are in microseconds
+		stream << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+		bool first = true;
+		for (const auto& event : this->collect()) {
+			stream << (first ? "\n" : ",\n") << "{\"name\":\"";
+			for (const char* c = event.name; *c; c++) {
+				if (*c == '"' || *c == '\\') {
+					stream << '\\';
+				}
+				stream << *c;
+			}
+			stream << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+			       << ",\"ts\":" << static_cast<double>(event.start) / 1000.0
+			       << ",\"dur\":" << static_cast<double>(event.duration) / 1000.0 << '}';
+			first = false;
+		}
+		stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		stream.flags(flags);
+		stream.precision(precision);
+		return static_cast<bool>(stream);
+	}
+
+	[[nodiscard]] bool writeChromeTrace(const std::filesystem::path& path) const {
+		std::ofstream file(path, std::ios::trunc);
+		return file && this->writeChromeTrace(file) && file.flush();
+	}
+
+private:
+	struct Slot {
+		std::atomic<const char*> name{nullptr};
+		std::atomic<std::int64_t> start{0};
+		std::atomic<std::int64_t> duration{0};
+	};
+
+	struct Ring {
+		std::array<Slot, RING_SIZE> slots;
+		/// Zones ever recorded, only the owning thread writes it
+		std::atomic<std::uint64_t> written{0};
+		/// Zones before this were cleared
+		std::atomic<std::uint64_t> cleared{0};
+		std::uint32_t thread = 0;
+	};
+
+	[[nodiscard]] static std::atomic<std::uint64_t>& nextId() {
+		static std::atomic<std::uint64_t> id{0};
+		return id;
+	}
+
+	[[nodiscard]] Ring& getRing() {
+		// Remembered per thread for the last profiler used, so only switching profilers takes the lock
+		thread_local std::uint64_t cachedId = ~std::uint64_t{0};
+		thread_local Ring* cachedRing = nullptr;
+		if (cachedId == this->id_) {
+			return *cachedRing;
+		}
+		std::scoped_lock lock(this->mutex_);
+		auto& ring = this->rings_[std::this_thread::get_id()];
+		if (!ring) {
+			ring = std::make_unique<Ring>();
+			ring->thread = static_cast<std::uint32_t>(this->rings_.size());
+		}
+		cachedId = this->id_;
+		cachedRing = ring.get();
+		return *ring;
+	}
+
+	std::uint64_t id_;
+	std::chrono::steady_clock::time_point origin_;
+	mutable std::mutex mutex_;
+	/// Rings outlive their threads, so zones of finished work can still be written
+	std::unordered_map<std::thread::id, std::unique_ptr<Ring>> rings_;
+};
+
+#ifdef PUZZLEMAKER_CE_PROFILER_ENABLED
+#define PUZZLEMAKER_CE_PROFILE_ZONE_NAME_(line) puzzlemakerCeProfileZone##line
+#define PUZZLEMAKER_CE_PROFILE_ZONE_NAME(line) PUZZLEMAKER_CE_PROFILE_ZONE_NAME_(line)
+/// Profile the rest of the enclosing scope under the given string literal
+#define PUZZLEMAKER_CE_PROFILE_ZONE(name) const Profiler::Zone PUZZLEMAKER_CE_PROFILE_ZONE_NAME(__LINE__){name}
+#else
+#define PUZZLEMAKER_CE_PROFILE_ZONE(name) static_cast<void>(0)
+#endif
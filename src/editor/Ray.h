@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include <sourcepp/math/Vector.h>
+
+#include "AABB.h"
+
+using namespace sourcepp::math;
+
+/// Distances along a ray are measured in multiples of its direction's length
+struct Ray {
+	Vec3f origin;
+	Vec3f direction;
+	float maxDistance = std::numeric_limits<float>::infinity();
+
+	/// Where the ray enters and leaves a box, and the axis of the face it enters through
+	struct Span {
+		float enter;
+		float exit;
+		int axis;
+
+		[[nodiscard]] bool isHit() const {
+			return this->enter <= this->exit;
+		}
+	};
+
+	/// Where the ray enters and leaves the slab between the two planes of a box on each axis
+	struct Slabs {
+		std::array<float, 3> enter;
+		std::array<float, 3> exit;
+
+		[[nodiscard]] Span getSpan() const {
+			Span span{this->enter[0], std::min({this->exit[0], this->exit[1], this->exit[2]}), 0};
+			for (int axis = 1; axis < 3; axis++) {
+				if (this->enter[axis] > span.enter) {
+					span.enter = this->enter[axis];
+					span.axis = axis;
+				}
+			}
+			return span;
+		}
+	};
+
+	[[nodiscard]] Slabs getSlabs(const AABB& box) const {
+		constexpr auto infinity = std::numeric_limits<float>::infinity();
+		Slabs slabs; // NOLINT(*-member-init)
+		for (int axis = 0; axis < 3; axis++) {
+			const auto origin = Ray::getComponent(this->origin, axis);
+			const auto direction = Ray::getComponent(this->direction, axis);
+			const auto min = static_cast<float>(axis == 0 ? box.min.x : axis == 1 ? box.min.y : box.min.z);
+			const auto max = static_cast<float>(axis == 0 ? box.max.x : axis == 1 ? box.max.y : box.max.z);
+			if (direction == 0.f) {
+				const bool inside = origin >= min && origin <= max;
+				slabs.enter[axis] = inside ? -infinity : infinity;
+				slabs.exit[axis] = inside ? infinity : -infinity;
+				continue;
+			}
+			const auto enter = (min - origin) / direction;
+			const auto exit = (max - origin) / direction;
+			slabs.enter[axis] = std::min(enter, exit);
+			slabs.exit[axis] = std::max(enter, exit);
+		}
+		return slabs;
+	}
+
+	[[nodiscard]] Span intersect(const AABB& box) const {
+		return this->getSlabs(box).getSpan();
+	}
+
+	/// Children of an octree node in the order the ray can pass through them: child i ^ mask for i in [0, 8)
+	[[nodiscard]] int getChildOrderMask() const {
+		return (this->direction.x < 0.f ? 4 : 0) | (this->direction.y < 0.f ? 2 : 0) | (this->direction.z < 0.f ? 1 : 0);
+	}
+
+	/// Where the ray crosses the planes through the center of a node, halfway through its slabs.
+	/// A ray parallel to a plane never crosses it, the side of the plane it runs on is kept instead
+	[[nodiscard]] std::array<float, 3> getSplits(const Slabs& slabs, Vec3i center) const {
+		constexpr auto infinity = std::numeric_limits<float>::infinity();
+		std::array<float, 3> splits; // NOLINT(*-member-init)
+		for (int axis = 0; axis < 3; axis++) {
+			if (Ray::getComponent(this->direction, axis) == 0.f) {
+				const auto middle = static_cast<float>(axis == 0 ? center.x : axis == 1 ? center.y : center.z);
+				splits[axis] = Ray::getComponent(this->origin, axis) > middle ? -infinity : infinity;
+			} else {
+				splits[axis] = (slabs.enter[axis] + slabs.exit[axis]) * 0.5f;
+			}
+		}
+		return splits;
+	}
+
+	/// The slabs of the child at the given index, cut from the slabs of its parent
+	[[nodiscard]] static Slabs getChildSlabs(const Slabs& slabs, const std::array<float, 3>& splits, int mask, int index) {
+		Slabs child = slabs;
+		for (int axis = 0; axis < 3; axis++) {
+			const int bit = 4 >> axis;
+			// The ray enters the far half of the node through the split plane
+			if ((index & bit) != (mask & bit)) {
+				child.enter[axis] = splits[axis];
+			} else {
+				child.exit[axis] = splits[axis];
+			}
+		}
+		return child;
+	}
+
+	/// The first child the ray passes through, as an index into the order given by the mask
+	[[nodiscard]] static int getFirstChild(const std::array<float, 3>& splits, float enter) {
+		return (splits[0] < enter ? 4 : 0) | (splits[1] < enter ? 2 : 0) | (splits[2] < enter ? 1 : 0);
+	}
+
+	/// The child the ray passes through after the given one, or -1 once it leaves the parent
+	[[nodiscard]] static int getNextChild(const Slabs& child, int order) {
+		const int axis = child.exit[0] < child.exit[1] ? (child.exit[0] < child.exit[2] ? 0 : 2) : (child.exit[1] < child.exit[2] ? 1 : 2);
+		const int bit = 4 >> axis;
+		return (order & bit) ? -1 : order | bit;
+	}
+
+	[[nodiscard]] static float getComponent(Vec3f vector, int axis) {
+		return axis == 0 ? vector.x : axis == 1 ? vector.y : vector.z;
+	}
+};
+
+/// The first solid leaf along a ray
+template<typename Node>
+struct RayHit {
+	const Node* node;
+	Vec3i position;
+	int halfSize;
+	/// Outward normal of the face the ray entered through, zero if the ray starts inside the leaf
+	Vec3i normal;
+	float distance;
+
+	/// Builds the hit for a ray entering a leaf over the given span
+	[[nodiscard]] static RayHit fromSpan(const Node& node, Vec3i position, int halfSize, const Ray& ray, const Ray::Span& span) {
+		RayHit hit{&node, position, halfSize, Vec3i::zero(), std::max(span.enter, 0.f)};
+		if (span.enter > 0.f) {
+			const int sign = Ray::getComponent(ray.direction, span.axis) < 0.f ? 1 : -1;
+			hit.normal = {span.axis == 0 ? sign : 0, span.axis == 1 ? sign : 0, span.axis == 2 ? sign : 0};
+		}
+		return hit;
+	}
+};
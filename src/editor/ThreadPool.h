@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/// Fixed set of workers with one task deque each. Workers take their newest task first and steal the
+/// oldest tasks of other workers when they run dry, so there is no queue shared by every thread
+class ThreadPool {
+public:
+	/// The calling thread counts as one of the threads, a pool of 1 runs everything on the caller
+	explicit ThreadPool(unsigned threadCount = std::max(std::thread::hardware_concurrency(), 1u))
+		: threadCount_(std::max(threadCount, 1u)) {
+		for (unsigned i = 0; i < this->threadCount_; i++) {
+			this->queues_.push_back(std::make_unique<Queue>());
+		}
+		for (unsigned i = 1; i < this->threadCount_; i++) {
+			this->workers_.emplace_back([this, i] {
+				this->work(i);
+			});
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool() {
+		{
+			std::scoped_lock lock(this->sleepMutex_);
+			this->stopping_ = true;
+		}
+		this->sleep_.notify_all();
+		for (auto& worker : this->workers_) {
+			worker.join();
+		}
+	}
+
+	/// Call func(i) for every i in [0, count) and wait for all of them. The calling thread works too.
+	/// Only one thread outside the pool may call this at a time
+	template<typename F>
+	void parallelFor(std::size_t count, F&& func) {
+		if (this->threadCount_ == 1 || count < 2) {
+			for (std::size_t i = 0; i < count; i++) {
+				func(i);
+			}
+			return;
+		}
+		std::atomic<std::size_t> remaining = count;
+		for (std::size_t i = 0; i < count; i++) {
+			this->push(i % this->threadCount_, [&func, &remaining, i] {
+				func(i);
+				remaining.fetch_sub(1, std::memory_order_release);
+			});
+		}
+		while (remaining.load(std::memory_order_acquire) > 0) {
+			if (auto task = this->take(0)) {
+				(*task)();
+			} else {
+				// The last tasks are running on other threads
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	[[nodiscard]] unsigned threadCount() const {
+		return this->threadCount_;
+	}
+
+private:
+	using Task = std::function<void()>;
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void push(std::size_t queue, Task task) {
+		// Counted before it is queued, so the count never drops below zero when the task is taken right away
+		{
+			std::scoped_lock lock(this->sleepMutex_);
+			this->pending_++;
+		}
+		{
+			std::scoped_lock lock(this->queues_[queue]->mutex);
+			this->queues_[queue]->tasks.push_back(std::move(task));
+		}
+		this->sleep_.notify_one();
+	}
+
+	/// Pop the newest task of the given queue, or steal the oldest task of another one
+	[[nodiscard]] std::optional<Task> take(std::size_t queue) {
+		for (std::size_t i = 0; i < this->threadCount_; i++) {
+			auto& victim = *this->queues_[(queue + i) % this->threadCount_];
+			std::scoped_lock lock(victim.mutex);
+			if (victim.tasks.empty()) {
+				continue;
+			}
+			Task task;
+			if (i == 0) {
+				task = std::move(victim.tasks.back());
+				victim.tasks.pop_back();
+			} else {
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+			}
+			this->pending_--;
+			return task;
+		}
+		return std::nullopt;
+	}
+
+	void work(std::size_t queue) {
+		while (true) {
+			if (auto task = this->take(queue)) {
+				(*task)();
+				continue;
+			}
+			std::unique_lock lock(this->sleepMutex_);
+			this->sleep_.wait(lock, [this] {
+				return this->stopping_ || this->pending_ > 0;
+			});
+			if (this->stopping_) {
+				return;
+			}
+		}
+	}
+
+	unsigned threadCount_;
+	std::vector<std::unique_ptr<Queue>> queues_;
+	std::vector<std::thread> workers_;
+
+	std::mutex sleepMutex_;
+	std::condition_variable sleep_;
+	std::atomic<std::size_t> pending_ = 0;
+	bool stopping_ = false;
+};
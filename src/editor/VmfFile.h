@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sourcepp/math/Vector.h>
+
+#include "AABB.h"
+#include "Mesher.h"
+#include "Profiler.h"
+
+using namespace sourcepp::math;
+
+/// The material a voxel data type is exported with. Specialize for every type that gets exported
+template<typename D>
+struct VmfMaterial;
+
+/// Export to the Valve Map Format that Hammer opens and vbsp compiles. Solid space becomes axis-aligned world
+/// brushes, every side textured with the material of the voxels the brush was merged from. Chamber units are
+/// Hammer units, but y is up in the chamber and z in the map, so chamber (x, y, z) is map (x, -z, y)
+namespace VmfFile {
+
+/// Texture scale of every side, a 512 pixel texture covers 128 units
+constexpr std::string_view TEXTURE_SCALE = "0.25";
+constexpr int LIGHTMAP_SCALE = 16;
+
+/// A box of solid voxels holding the same data, in chamber coordinates
+template<typename D>
+struct Brush {
+	AABB box;
+	D data;
+};
+
+/// Every solid leaf of an octree, one brush each before merging. Leaves holding default constructed data are empty space
+template<typename Tree>
+[[nodiscard]] auto getSolids(const Tree& tree) {
+	using D = std::remove_cvref_t<decltype(std::declval<const typename Tree::Node&>().data())>;
+
+	std::vector<std::pair<AABB, D>> solids;
+	tree.forEachLeaf([&solids](const typename Tree::Node& node, Vec3i position, int halfSize) {
+		if (!(node.data() == D{})) {
+			solids.emplace_back(AABB::fromNode(position, halfSize), node.data());
+		}
+	});
+	return solids;
+}
+
+/// Cut disjoint solid boxes into slabs between every plane along the axis where one starts or ends, merge the cross
+/// section of each slab into maximal rectangles per material, then stack equal rectangles of neighbouring slabs
+template<typename D>
+[[nodiscard]] std::vector<Brush<D>> mergeAlong(const std::vector<std::pair<AABB, D>>& solids, int axis) {
+	std::vector<int> planes;
+	planes.reserve(solids.size() * 2);
+	for (const auto& [box, data] : solids) {
+		planes.push_back(Mesher::getComponent(box.min, axis));
+		planes.push_back(Mesher::getComponent(box.max, axis));
+	}
+	std::sort(planes.begin(), planes.end());
+	planes.erase(std::unique(planes.begin(), planes.end()), planes.end());
+	const auto getSlab = [&planes](int coordinate) {
+		return static_cast<int>(std::lower_bound(planes.begin(), planes.end(), coordinate) - planes.begin());
+	};
+
+	// The cross section of a box in each slab it spans is a face on the plane of the slab's index
+	QuadMesh<D> sections;
+	std::vector<MeshFace> faces;
+	for (const auto& [box, data] : solids) {
+		const auto material = Mesher::getMaterial(sections, data);
+		const Vec2i min{Mesher::getComponent(box.min, (axis + 1) % 3), Mesher::getComponent(box.min, (axis + 2) % 3)};
+		const Vec2i max{Mesher::getComponent(box.max, (axis + 1) % 3), Mesher::getComponent(box.max, (axis + 2) % 3)};
+		const auto last = getSlab(Mesher::getComponent(box.max, axis));
+		for (auto slab = getSlab(Mesher::getComponent(box.min, axis)); slab < last; slab++) {
+			faces.push_back({axis, slab, min, max, material, true});
+		}
+	}
+	Mesher::mergeFaces(faces, sections.quads);
+
+	auto& rectangles = sections.quads;
+	std::sort(rectangles.begin(), rectangles.end(), [](const MeshQuad& lhs, const MeshQuad& rhs) {
+		return std::tie(lhs.material, lhs.min.x, lhs.min.y, lhs.max.x, lhs.max.y, lhs.plane) < std::tie(rhs.material, rhs.min.x, rhs.min.y, rhs.max.x, rhs.max.y, rhs.plane);
+	});
+	std::vector<Brush<D>> brushes;
+	for (std::size_t first = 0; first < rectangles.size();) {
+		const auto& rectangle = rectangles[first];
+		auto last = first + 1;
+		while (last < rectangles.size() && rectangles[last].material == rectangle.material && rectangles[last].min.x == rectangle.min.x && rectangles[last].min.y == rectangle.min.y &&
+		       rectangles[last].max.x == rectangle.max.x && rectangles[last].max.y == rectangle.max.y && rectangles[last].plane == rectangles[last - 1].plane + 1) {
+			last++;
+		}
+		const auto min = Mesher::fromPlane(axis, planes[rectangle.plane], rectangle.min.x, rectangle.min.y);
+		const auto max = Mesher::fromPlane(axis, planes[rectangles[last - 1].plane + 1], rectangle.max.x, rectangle.max.y);
+		brushes.push_back({{min, max}, sections.materials[rectangle.material]});
+		first = last;
+	}
+	return brushes;
+}
+
+/// Merge disjoint solid boxes into fewer brushes covering the same voxels with the same data. The fewest boxes
+/// are too slow to find, the slabs along the axis giving the fewest brushes come close for chamber geometry
+template<typename D>
+[[nodiscard]] std::vector<Brush<D>> getBrushes(const std::vector<std::pair<AABB, D>>& solids) {
+	PUZZLEMAKER_CE_PROFILE_ZONE("VmfFile::getBrushes");
+	std::vector<Brush<D>> brushes;
+	for (int axis = 0; axis < 3; axis++) {
+		auto merged = VmfFile::mergeAlong(solids, axis);
+		if (axis == 0 || merged.size() < brushes.size()) {
+			brushes = std::move(merged);
+		}
+	}
+	return brushes;
+}
+
+/// A chamber box in map coordinates
+[[nodiscard]] inline AABB toMap(const AABB& box) {
+	return {{box.min.x, -box.max.z, box.min.y}, {box.max.x, -box.min.z, box.max.y}};
+}
+
+/// Three corners of the side of a map box facing along the axis, clockwise seen from outside the box
+[[nodiscard]] inline std::array<Vec3i, 3> getSidePoints(const AABB& box, int axis, bool positive) {
+	const auto plane = Mesher::getComponent(positive ? box.max : box.min, axis);
+	const auto u0 = Mesher::getComponent(box.min, (axis + 1) % 3);
+	const auto v0 = Mesher::getComponent(box.min, (axis + 2) % 3);
+	const auto u1 = Mesher::getComponent(box.max, (axis + 1) % 3);
+	const auto v1 = Mesher::getComponent(box.max, (axis + 2) % 3);
+	const auto corner = Mesher::fromPlane(axis, plane, u0, v0);
+	if (positive) {
+		return {corner, Mesher::fromPlane(axis, plane, u0, v1), Mesher::fromPlane(axis, plane, u1, v0)};
+	}
+	return {corner, Mesher::fromPlane(axis, plane, u1, v0), Mesher::fromPlane(axis, plane, u0, v1)};
+}
+
+/// Write the brushes as the world of a map. Returns false if the stream fails
+template<typename D>
+[[nodiscard]] bool write(const std::vector<Brush<D>>& brushes, std::ostream& stream) {
+	PUZZLEMAKER_CE_PROFILE_ZONE("VmfFile::write");
+	// World-aligned texture axes of the sides facing x, y and z
+	static constexpr std::array<std::array<std::string_view, 2>, 3> TEXTURE_AXES{{
+		{"[0 1 0 0]", "[0 0 -1 0]"},
+		{"[1 0 0 0]", "[0 0 -1 0]"},
+		{"[1 0 0 0]", "[0 -1 0 0]"},
+	}};
+	const auto writePoint = [&stream](Vec3i point) {
+		stream << '(' << point.x << ' ' << point.y << ' ' << point.z << ')';
+	};
+
+	stream << "versioninfo\n{\n\t\"editorversion\" \"400\"\n\t\"editorbuild\" \"8864\"\n\t\"mapversion\" \"1\"\n\t\"formatversion\" \"100\"\n\t\"prefab\" \"0\"\n}\n";
+	stream << "world\n{\n\t\"id\" \"1\"\n\t\"mapversion\" \"1\"\n\t\"classname\" \"worldspawn\"\n\t\"skyname\" \"sky_black_nofog\"\n";
+	// Solids and sides are numbered separately
+	std::size_t solidId = 2;
+	std::size_t sideId = 1;
+	for (const auto& brush : brushes) {
+		const auto box = VmfFile::toMap(brush.box);
+		const auto material = VmfMaterial<D>::get(brush.data);
+		stream << "\tsolid\n\t{\n\t\t\"id\" \"" << solidId++ << "\"\n";
+		for (int axis = 0; axis < 3; axis++) {
+			for (const bool positive : {false, true}) {
+				const auto points = VmfFile::getSidePoints(box, axis, positive);
+				stream << "\t\tside\n\t\t{\n\t\t\t\"id\" \"" << sideId++ << "\"\n\t\t\t\"plane\" \"";
+				writePoint(points[0]);
+				stream << ' ';
+				writePoint(points[1]);
+				stream << ' ';
+				writePoint(points[2]);
+				stream << "\"\n\t\t\t\"material\" \"" << material << "\"\n";
+				stream << "\t\t\t\"uaxis\" \"" << TEXTURE_AXES[axis][0] << ' ' << TEXTURE_SCALE << "\"\n";
+				stream << "\t\t\t\"vaxis\" \"" << TEXTURE_AXES[axis][1] << ' ' << TEXTURE_SCALE << "\"\n";
+				stream << "\t\t\t\"rotation\" \"0\"\n\t\t\t\"lightmapscale\" \"" << LIGHTMAP_SCALE << "\"\n\t\t\t\"smoothing_groups\" \"0\"\n\t\t}\n";
+			}
+		}
+		stream << "\t}\n";
+	}
+	stream << "}\n";
+	return static_cast<bool>(stream);
+}
+
+/// Write the brushes to a file. Like chamber files, it is written next to the destination first and moved over it once complete
+template<typename D>
+[[nodiscard]] bool save(const std::vector<Brush<D>>& brushes, const std::filesystem::path& path) {
+	auto temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+		if (!VmfFile::write(brushes, file)) {
+			file.close();
+			std::error_code error;
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
+
+} // namespace VmfFile
@@ -1,103 +1,310 @@
 #pragma once
 
+#include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
-#include <vector>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
+#include "ChamberFile.h"
+#include "ChunkedMesh.h"
+#include "History.h"
+#include "Journal.h"
+#include "MaterialPalette.h"
 #include "Octree.h"
+#include "VmfFile.h"
 
-constexpr int MAX_CHAMBER_SIZE = 32768;
+#ifdef PUZZLEMAKER_CE_USE_LINEAR_OCTREE
+#include "LinearOctree.h"
+#endif
+
+constexpr int MAX_CHAMBER_DEPTH = 15;
+constexpr int MAX_CHAMBER_SIZE = 1 << MAX_CHAMBER_DEPTH;
 constexpr int DEFAULT_RESOLUTION = 128;
+/// Chunks are 1024 units wide
+constexpr int DEFAULT_MESH_SPLIT_DEPTH = 5;
+/// Chunks further away from the camera are drawn with coarser levels of detail
+constexpr float DEFAULT_LOD_DISTANCE = 8192.f;
+/// Memory undo steps may keep alive before the oldest are forgotten
+constexpr std::size_t DEFAULT_HISTORY_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+/// A texture from the material palette. Nodes hold it inline, so it is kept to a couple of bytes and comparing
+/// siblings for merging compares integers
+struct VoxelData {
+	/// MaterialPalette::EMPTY for open space
+	MaterialId material = MaterialPalette::EMPTY;
+
+	VoxelData() = default;
 
-class VoxelData {
-	std::string texture;
+	/// Intern the texture in the material palette. Returns nothing once the palette is full, the texture can't be painted then
+	[[nodiscard]] static std::optional<VoxelData> fromTexture(std::string_view texture) {
+		const auto material = MaterialPalette::get().intern(texture);
+		if (!material) {
+			return std::nullopt;
+		}
+		VoxelData data;
+		data.material = *material;
+		return data;
+	}
+
+	[[nodiscard]] std::string_view getTexture() const {
+		return MaterialPalette::get().getName(this->material);
+	}
+
+	[[nodiscard]] bool operator==(const VoxelData&) const = default;
 };
+static_assert(std::is_trivially_copyable_v<VoxelData>);
+
+/// Stored by texture name, ids are only valid in the palette of the running editor
+template<>
+struct PaletteEntry<VoxelData> {
+	template<std::size_t BUFFER_SIZE>
+	static void write(ChamberFile::BasicWriter<BUFFER_SIZE>& writer, const VoxelData& data) {
+		PaletteEntry<std::string>::write(writer, std::string{data.getTexture()});
+	}
 
-#pragma pack(push, 1)
-struct Vertex {
-	Vertex(Vec3f pos_, Vec2f uv_)
-			: pos(pos_)
-			, uv(uv_) {}
+	[[nodiscard]] static bool read(ChamberFile::Reader& reader, VoxelData& data) {
+		std::string texture;
+		if (!PaletteEntry<std::string>::read(reader, texture)) {
+			return false;
+		}
+		const auto material = MaterialPalette::get().intern(texture);
+		if (!material) {
+			return false;
+		}
+		data.material = *material;
+		return true;
+	}
+};
 
-	Vec3f pos;
-	Vec2f uv;
+/// Sides are textured with the material of the texture name
+template<>
+struct VmfMaterial<VoxelData> {
+	[[nodiscard]] static std::string_view get(const VoxelData& data) {
+		return data.getTexture();
+	}
 };
-#pragma pack(pop)
+
+#ifdef PUZZLEMAKER_CE_USE_LINEAR_OCTREE
+using ChamberOctree = LinearOctree<VoxelData>;
+#else
+using ChamberOctree = Octree<VoxelData, MAX_CHAMBER_DEPTH>;
+#endif
 
 class World {
 public:
 	World()
 		: chamber(MAX_CHAMBER_SIZE)
+		, mesh(MAX_CHAMBER_SIZE, MAX_CHAMBER_SIZE >> DEFAULT_MESH_SPLIT_DEPTH)
+		, history(DEFAULT_HISTORY_MEMORY_BUDGET)
 		, editResolution(DEFAULT_RESOLUTION) {
+		this->history.reset(this->chamber);
 		// 8*128 x
 		// 6*128 y
 		// 4*128 z
 	}
 
-	[[nodiscard]] std::vector<Vertex> render() {
-		std::vector<Vertex> vertices;
-		this->render(vertices, this->chamber.root());
-		return vertices;
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	/// Set the voxel data of the node centered on the given position, as one undo step. Setting the data it already
+	/// holds succeeds without remeshing, journaling or adding an undo step
+	[[nodiscard]] bool set(Vec3i position, const VoxelData& data) {
+		const auto halfSize = Octree<VoxelData>::getHalfSizeFromPosition(this->chamber.size() / 2, position);
+		if (!halfSize) {
+			return false;
+		}
+		// The leaf is only found if it covers the whole node
+		if (const auto* leaf = this->chamber.get(position); leaf && leaf->data() == data) {
+			return true;
+		}
+		if (!this->chamber.set(position, data)) {
+			return false;
+		}
+		this->mesh.invalidate(AABB::fromNode(position, halfSize));
+		this->journal.recordSet(position, data);
+		this->history.commit(this->chamber);
+		this->publish();
+		return true;
 	}
 
-private:
-	Octree<VoxelData> chamber;
-	int editResolution;
+	/// Set every voxel inside the box, as one undo step
+	void fill(const AABB& box, const VoxelData& data) {
+		this->chamber.fill(box, data);
+		this->mesh.invalidate(box);
+		this->journal.recordFill(box, data);
+		this->history.commit(this->chamber);
+		this->publish();
+	}
 
-	// NOLINTNEXTLINE(*-no-recursion)
-	void render(std::vector<Vertex>& vertices, const std::unique_ptr<Octree<VoxelData>::Node>& node) {
-		for (auto& child : this->chamber.root()->children()) {
-			if (!child) {
-				continue;
-			}
-			if (child->hasChildren()) {
-				this->render(vertices, child);
-			} else {
-				World::addVoxelToVertices(vertices, node->position(), node->halfSize());
-			}
+	void clear(const AABB& box) {
+		this->fill(box, {});
+	}
+
+	/// Take back the last edit. Returns false if there is nothing to undo
+	[[nodiscard]] bool undo() {
+		const auto* version = this->history.undo(this->chamber);
+		if (!version) {
+			return false;
+		}
+		this->applyDifferences(*version);
+		this->publish();
+		return true;
+	}
+
+	/// Make the last edit taken back again. Returns false if there is nothing to redo
+	[[nodiscard]] bool redo() {
+		const auto* version = this->history.redo(this->chamber);
+		if (!version) {
+			return false;
+		}
+		this->applyDifferences(*version);
+		this->publish();
+		return true;
+	}
+
+	[[nodiscard]] const History<ChamberOctree>& getHistory() const {
+		return this->history;
+	}
+
+	/// Forget the oldest undo steps while they take more memory than given
+	void setHistoryMemoryBudget(std::size_t bytes) {
+		this->history.setMemoryBudget(this->chamber, bytes);
+	}
+
+	/// Remesh the chunks touched since the last update on every core. Returns the number of chunks rebuilt
+	std::size_t update() {
+		return this->mesh.update(this->chamber, &this->pool);
+	}
+
+	/// Split the chamber into 8^depth mesh chunks, the chunks are meshed in parallel
+	void setMeshSplitDepth(int depth) {
+		this->remesh(MAX_CHAMBER_SIZE >> depth);
+	}
+
+	/// Replace the chamber with the one saved in a .pzce file and the saved edits in its journal, along with the
+	/// unsaved ones if recovering from a crash. The current chamber is kept if the file can't be read
+	[[nodiscard]] bool load(const std::filesystem::path& path, const ChamberFile::Progress& progress = {}, bool recover = false) {
+		ChamberOctree loaded(MAX_CHAMBER_SIZE);
+		if (!ChamberFile::load(loaded, path, progress)) {
+			return false;
+		}
+		Journal<VoxelData> loadedJournal;
+		if (const auto base = ChamberFile::readChecksum(path)) {
+			loadedJournal.replay(loaded, path, *base, recover);
 		}
+		this->history.clear(this->chamber);
+		this->chamber = std::move(loaded);
+		this->journal = std::move(loadedJournal);
+		this->history.reset(this->chamber);
+		this->publish();
+		this->remesh(this->mesh.chunkSize());
+		return true;
+	}
+
+	/// Replace the chamber with one built elsewhere, it is not backed by a file
+	void setChamber(ChamberOctree chamber_) {
+		this->history.clear(this->chamber);
+		this->chamber = std::move(chamber_);
+		this->journal = {};
+		this->history.reset(this->chamber);
+		this->publish();
+		this->remesh(this->mesh.chunkSize());
 	}
 
-	static void addVoxelToVertices(std::vector<Vertex>& vertices, Vec3i center, int halfSize) {
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {1.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z - halfSize)}, {1.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z - halfSize)}, {1.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 0.0f}});
-
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z + halfSize)}, {0.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {0.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z + halfSize)}, {0.0f, 0.0f}});
-
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z - halfSize)}, {1.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z + halfSize)}, {0.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z - halfSize)}, {1.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z + halfSize)}, {0.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {1.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z + halfSize)}, {0.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y - halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
-
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z - halfSize)}, {1.0f, 1.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x + halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {1.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z + halfSize)}, {0.0f, 0.0f}});
-		vertices.push_back({{static_cast<float>(center.x - halfSize), static_cast<float>(center.y + halfSize), static_cast<float>(center.z - halfSize)}, {0.0f, 1.0f}});
+	/// Save the chamber to a .pzce file
+	[[nodiscard]] bool save(const std::filesystem::path& path, const ChamberFile::Progress& progress = {}) const {
+		return ChamberFile::save(this->chamber, path, progress);
 	}
+
+	/// Export the chamber to a .vmf file, its solid leaves merged into as few brushes as it finds
+	[[nodiscard]] bool exportVmf(const std::filesystem::path& path) const {
+		return VmfFile::save(VmfFile::getBrushes(VmfFile::getSolids(this->chamber)), path);
+	}
+
+	/// The chamber as of the last edit, to read from another thread while editing continues. It stays valid once the
+	/// world is dropped, but the chamber must not be replaced by load() or setChamber() meanwhile
+	[[nodiscard]] static std::shared_ptr<const ChamberOctree> getChamberSnapshot(std::shared_ptr<const World> world) {
+#ifdef PUZZLEMAKER_CE_USE_LINEAR_OCTREE
+		// Linear octrees can't be published, readers get a copy
+		return std::make_shared<const ChamberOctree>(world->chamber);
+#else
+		struct Pinned {
+			// Declared first so the snapshot is gone before the world
+			std::shared_ptr<const World> world;
+			ChamberOctree::Snapshot snapshot;
+		};
+		auto snapshot = world->chamber.snapshot();
+		const auto pinned = std::make_shared<const Pinned>(Pinned{std::move(world), std::move(snapshot)});
+		return {pinned, &*pinned->snapshot};
+#endif
+	}
+
+	/// The voxels of the chamber
+	[[nodiscard]] const ChamberOctree& getChamber() const {
+		return this->chamber;
+	}
+
+	/// The edits made since the chamber was loaded or last saved in full
+	[[nodiscard]] Journal<VoxelData>& getJournal() {
+		return this->journal;
+	}
+
+	/// Empty the whole chamber, it is no longer backed by a file
+	void reset() {
+		this->history.clear(this->chamber);
+		this->chamber.clear();
+		this->journal = {};
+		this->history.reset(this->chamber);
+		this->publish();
+		this->remesh(this->mesh.chunkSize());
+	}
+
+	[[nodiscard]] const ChunkedMesh<ChamberOctree>& getMesh() const {
+		return this->mesh;
+	}
+
+	[[nodiscard]] ChunkedMesh<ChamberOctree>& getMesh() {
+		return this->mesh;
+	}
+
+	[[nodiscard]] int getEditResolution() const {
+		return this->editResolution;
+	}
+
+private:
+	/// Let getChamberSnapshot() see the edits made so far
+	void publish() {
+#ifndef PUZZLEMAKER_CE_USE_LINEAR_OCTREE
+		this->chamber.publish();
+#endif
+	}
+
+	/// Remesh and journal the leaves that changed since the chamber was in the given version
+	void applyDifferences(const ChamberOctree::Version& version) {
+		this->chamber.forEachDifference(version, [this](const ChamberOctree::Node& node, Vec3i position, int halfSize) {
+			const auto box = AABB::fromNode(position, halfSize);
+			this->mesh.invalidate(box);
+			this->journal.recordFill(box, node.data());
+		});
+	}
+
+	/// Throw away every chunk and mesh the chamber again from scratch
+	void remesh(int chunkSize) {
+		this->mesh = ChunkedMesh<ChamberOctree>(MAX_CHAMBER_SIZE, chunkSize);
+		this->chamber.forEachLeaf([this](const ChamberOctree::Node& node, Vec3i position, int halfSize) {
+			if (!(node.data() == VoxelData{})) {
+				this->mesh.invalidate(AABB::fromNode(position, halfSize));
+			}
+		});
+	}
+
+	ChamberOctree chamber;
+	Journal<VoxelData> journal;
+	ChunkedMesh<ChamberOctree> mesh;
+	History<ChamberOctree> history;
+	ThreadPool pool;
+	int editResolution;
 };
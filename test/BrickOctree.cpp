@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <editor/BrickOctree.h>
+
+TEST(BrickOctree, bricks) {
+	BrickOctree<int> octree(64);
+	ASSERT_TRUE(octree.set({1, 3, 5}, 7));
+	ASSERT_EQ(octree.brickCount(), 1);
+	ASSERT_EQ(octree.get({1, 3, 5})->data(), 7);
+	ASSERT_EQ(octree.get({3, 3, 5})->data(), 0);
+	ASSERT_EQ(octree.get({2, 3, 5}), nullptr);
+
+	// Nodes inside a brick are split, unless forced
+	ASSERT_TRUE(octree.exists({2, 2, 6}));
+	ASSERT_FALSE(octree.set({2, 2, 6}, 7));
+	ASSERT_TRUE(octree.set({2, 2, 6}, 7, true));
+	ASSERT_EQ(octree.get({3, 1, 7})->data(), 7);
+
+	// A brick holding a single material is a leaf again, and merges with its siblings
+	ASSERT_TRUE(octree.set({2, 2, 6}, 0, true));
+	ASSERT_TRUE(octree.set({1, 3, 5}, 0));
+	ASSERT_EQ(octree.brickCount(), 0);
+	ASSERT_EQ(octree.nodeCount(), 1);
+}
+
+TEST(BrickOctree, visibleFaces) {
+	BrickOctree<int> octree(32);
+	// Two voxels next to each other along x in the brick at the corner
+	ASSERT_TRUE(octree.set({-15, -15, -15}, 1));
+	ASSERT_TRUE(octree.set({-13, -15, -15}, 1));
+	std::size_t bricks = 0;
+	octree.forEachLeafOrBrick([](const BrickOctree<int>::Node&, Vec3i, int) {}, [&bricks](const BrickOctree<int>::Brick& brick, Vec3i) {
+		bricks++;
+		ASSERT_EQ(brick.getVisibleFaces(0, true)[0], 0b10);
+		ASSERT_EQ(brick.getVisibleFaces(0, false)[0], 0b01);
+		for (int axis = 1; axis < 3; axis++) {
+			for (bool positive : {false, true}) {
+				ASSERT_EQ(brick.getVisibleFaces(axis, positive)[0], 0b11);
+				ASSERT_EQ(brick.getVisibleFaces(axis, positive)[1], 0);
+			}
+		}
+	});
+	ASSERT_EQ(bricks, 1);
+}
+
+TEST(BrickOctree, matchesOctree) {
+	Octree<int> octree(64);
+	BrickOctree<int> bricks(64);
+
+	std::mt19937 random{5};
+	std::uniform_int_distribution<int> coordinate{-32, 32};
+	std::uniform_int_distribution<int> value{0, 3};
+	for (int i = 0; i < 200; i++) {
+		Vec3i min{coordinate(random), coordinate(random), coordinate(random)};
+		Vec3i max{coordinate(random), coordinate(random), coordinate(random)};
+		const AABB box{{std::min(min.x, max.x), std::min(min.y, max.y), std::min(min.z, max.z)}, {std::max(min.x, max.x), std::max(min.y, max.y), std::max(min.z, max.z)}};
+		const auto data = value(random);
+		octree.fill(box, data);
+		bricks.fill(box, data);
+	}
+	// Unit voxels and nodes at least as large as a brick, where both octrees have the same nodes
+	std::uniform_int_distribution<int> voxel{-16, 15};
+	for (int i = 0; i < 2000; i++) {
+		const Vec3i position = i % 4 ? Vec3i{voxel(random) * 2 + 1, voxel(random) * 2 + 1, voxel(random) * 2 + 1} : Vec3i{voxel(random) / 4 * 16 + 8, voxel(random) / 4 * 16 + 8, voxel(random) / 4 * 16 + 8};
+		const auto data = value(random);
+		ASSERT_EQ(octree.set(position, data), bricks.set(position, data)) << i;
+	}
+	ASSERT_GT(bricks.brickCount(), 0);
+	for (int x = -31; x < 32; x += 2) {
+		for (int y = -31; y < 32; y += 2) {
+			for (int z = -31; z < 32; z += 2) {
+				ASSERT_EQ(octree.get({x, y, z})->data(), bricks.get({x, y, z})->data());
+			}
+		}
+	}
+	for (int i = 0; i < 2000; i++) {
+		const Vec3i position{coordinate(random), coordinate(random), coordinate(random)};
+		const auto* node = bricks.get(position);
+		if (node) {
+			ASSERT_EQ(octree.get(position)->data(), node->data());
+		}
+	}
+
+	// Solid volume inside a box, from the leaves intersecting it
+	const AABB box{{-20, -8, -4}, {12, 30, 6}};
+	const auto getVolume = [&box](const AABB& bounds) {
+		const auto inside = bounds.intersection(box);
+		return (inside.max.x - inside.min.x) * (inside.max.y - inside.min.y) * (inside.max.z - inside.min.z);
+	};
+	int octreeVolume = 0, brickVolume = 0;
+	octree.forEachLeaf(box, [&getVolume, &octreeVolume](const Octree<int>::Node& node, Vec3i position, int halfSize) {
+		octreeVolume += node.data() ? getVolume(AABB::fromNode(position, halfSize)) : 0;
+	});
+	bricks.forEachLeaf(box, [&getVolume, &brickVolume](const BrickOctree<int>::Node& node, Vec3i position, int halfSize) {
+		brickVolume += node.data() ? getVolume(AABB::fromNode(position, halfSize)) : 0;
+	});
+	ASSERT_GT(brickVolume, 0);
+	ASSERT_EQ(octreeVolume, brickVolume);
+}
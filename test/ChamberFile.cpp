@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <editor/ChamberFile.h>
+#include <editor/LinearOctree.h>
+#include <editor/Octree.h>
+
+namespace {
+
+template<typename Tree>
+auto getLeaves(const Tree& tree) {
+	using D = std::remove_cvref_t<decltype(std::declval<const typename Tree::Node&>().data())>;
+	std::vector<std::tuple<int, int, int, int, D>> leaves;
+	tree.forEachLeaf([&leaves](const typename Tree::Node& node, Vec3i position, int halfSize) {
+		leaves.emplace_back(position.x, position.y, position.z, halfSize, node.data());
+	});
+	return leaves;
+}
+
+template<typename Tree>
+std::string save(const Tree& tree) {
+	std::ostringstream stream;
+	EXPECT_TRUE(ChamberFile::write(tree, stream));
+	return stream.str();
+}
+
+template<typename Tree>
+bool load(Tree& tree, const std::string& data) {
+	return ChamberFile::read(tree, {reinterpret_cast<const std::byte*>(data.data()), data.size()});
+}
+
+template<typename Tree>
+Tree getChamber() {
+	Tree tree(64);
+	tree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	tree.fill({{-20, -4, -12}, {12, 16, 0}}, 2);
+	tree.clear({{-4, -28, -4}, {20, -4, 24}});
+	for (int i = -31; i < 32; i += 6) {
+		EXPECT_TRUE(tree.set({i, 17, -i}, 3 + (i & 1)));
+	}
+	return tree;
+}
+
+} // namespace
+
+TEST(ChamberFile, roundTrip) {
+	const auto octree = getChamber<Octree<int>>();
+	const auto data = save(octree);
+
+	Octree<int> loaded(64);
+	ASSERT_TRUE(load(loaded, data));
+	ASSERT_EQ(getLeaves(loaded), getLeaves(octree));
+	ASSERT_EQ(loaded.nodeCount(), octree.nodeCount());
+
+	// Both backends write the same file and read each other's
+	const auto linear = getChamber<LinearOctree<int>>();
+	ASSERT_EQ(save(linear), data);
+	LinearOctree<int> loadedLinear(64);
+	ASSERT_TRUE(load(loadedLinear, data));
+	ASSERT_EQ(getLeaves(loadedLinear), getLeaves(linear));
+}
+
+TEST(ChamberFile, smallest) {
+	// A single leaf is 1 bit of stream, a single material needs no index bits
+	Octree<int> empty(64);
+	const auto data = save(empty);
+	ASSERT_EQ(data.size(), 32 + 4 + 1 + 8);
+
+	Octree<int> loaded(64);
+	ASSERT_TRUE(loaded.set({1, 1, 1}, 5));
+	ASSERT_TRUE(load(loaded, data));
+	ASSERT_EQ(loaded.nodeCount(), 1);
+	ASSERT_EQ(loaded.root().data(), 0);
+}
+
+TEST(ChamberFile, strings) {
+	Octree<std::string> octree(16);
+	octree.fill({{-8, -8, -8}, {8, 0, 8}}, "dev/wall");
+	ASSERT_TRUE(octree.set({3, 3, 3}, "glass"));
+
+	std::ostringstream stream;
+	ASSERT_TRUE(ChamberFile::write(octree, stream));
+	const auto data = stream.str();
+	Octree<std::string> loaded(16);
+	ASSERT_TRUE(ChamberFile::read(loaded, {reinterpret_cast<const std::byte*>(data.data()), data.size()}));
+	ASSERT_EQ(getLeaves(loaded), getLeaves(octree));
+}
+
+TEST(ChamberFile, rejectsBadData) {
+	const auto octree = getChamber<Octree<int>>();
+	const auto data = save(octree);
+	Octree<int> loaded(64);
+
+	// Any flipped bit fails the checksum
+	for (std::size_t i = 0; i < data.size(); i += 7) {
+		auto corrupted = data;
+		corrupted[i] = static_cast<char>(corrupted[i] ^ (1 << (i % 8)));
+		ASSERT_FALSE(load(loaded, corrupted));
+		ASSERT_EQ(loaded.nodeCount(), 1);
+	}
+	ASSERT_FALSE(load(loaded, data.substr(0, data.size() - 1)));
+	ASSERT_FALSE(load(loaded, ""));
+
+	// Valid files of another size
+	Octree<int> larger(128);
+	ASSERT_FALSE(load(larger, data));
+}
+
+TEST(ChamberFile, file) {
+	const auto path = std::filesystem::temp_directory_path() / "puzzlemaker_ce_test.pzce";
+	const auto octree = getChamber<Octree<int>>();
+	ASSERT_TRUE(ChamberFile::save(octree, path));
+	ASSERT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+
+	LinearOctree<int> loaded(64);
+	ASSERT_TRUE(ChamberFile::load(loaded, path));
+	ASSERT_EQ(getLeaves(loaded), getLeaves(getChamber<LinearOctree<int>>()));
+	std::filesystem::remove(path);
+
+	ASSERT_FALSE(ChamberFile::load(loaded, path));
+}
+
+TEST(ChamberFile, cancel) {
+	// Enough scattered voxels for a few progress reports
+	Octree<int> octree(1024);
+	std::mt19937 random{1};
+	std::uniform_int_distribution<int> cell{-256, 255};
+	for (int i = 0; i < 4000; i++) {
+		ASSERT_TRUE(octree.set({cell(random) * 2 + 1, cell(random) * 2 + 1, cell(random) * 2 + 1}, 1 + (i & 7)));
+	}
+	std::ostringstream stream;
+	std::uint64_t reports = 0;
+	ASSERT_TRUE(ChamberFile::write(octree, stream, [&reports](std::uint64_t done, std::uint64_t total) {
+		EXPECT_LE(done, total);
+		reports++;
+		return true;
+	}));
+	ASSERT_GT(reports, 0);
+	const auto data = stream.str();
+
+	std::ostringstream cancelled;
+	ASSERT_FALSE(ChamberFile::write(octree, cancelled, [](std::uint64_t, std::uint64_t) {
+		return false;
+	}));
+	Octree<int> loaded(1024);
+	ASSERT_FALSE(load(loaded, cancelled.str()));
+
+	ASSERT_FALSE(ChamberFile::read(loaded, {reinterpret_cast<const std::byte*>(data.data()), data.size()}, [](std::uint64_t, std::uint64_t) {
+		return false;
+	}));
+	ASSERT_EQ(loaded.nodeCount(), 1);
+	ASSERT_TRUE(load(loaded, data));
+	ASSERT_EQ(getLeaves(loaded), getLeaves(octree));
+}
@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+#include <editor/ChunkedMesh.h>
+#include <editor/Octree.h>
+
+TEST(ChunkedMesh, rebuildsTouchedChunks) {
+	Octree<int> octree(64);
+	ChunkedMesh<Octree<int>> mesh(64, 16);
+
+	const AABB room{{-8, -8, -8}, {8, 8, 8}};
+	octree.fill(room, 1);
+	mesh.invalidate(room);
+	ASSERT_EQ(mesh.update(octree), 8);
+	ASSERT_EQ(mesh.chunkCount(), 8);
+
+	// Nothing changed since the last update
+	ASSERT_EQ(mesh.update(octree), 0);
+
+	// Inside a chunk
+	ASSERT_TRUE(octree.set({3, 3, 3}, 2));
+	mesh.invalidate(AABB::fromNode({3, 3, 3}, 1));
+	ASSERT_EQ(mesh.update(octree), 1);
+
+	// Against the far face of a chunk, the face on the boundary belongs to the next chunk
+	ASSERT_TRUE(octree.set({15, 3, 3}, 2));
+	mesh.invalidate(AABB::fromNode({15, 3, 3}, 1));
+	ASSERT_EQ(mesh.update(octree), 2);
+	ASSERT_EQ(mesh.chunkCount(), 9);
+
+	// In the corner of a chunk, the neighbour along x already holds the previous voxel
+	ASSERT_TRUE(octree.set({15, 15, 15}, 2));
+	mesh.invalidate(AABB::fromNode({15, 15, 15}, 1));
+	ASSERT_EQ(mesh.update(octree), 4);
+	ASSERT_EQ(mesh.chunkCount(), 11);
+
+	// Chunks left without faces are dropped
+	ASSERT_TRUE(octree.set({15, 15, 15}, 0));
+	mesh.invalidate(AABB::fromNode({15, 15, 15}, 1));
+	ASSERT_EQ(mesh.update(octree), 4);
+	ASSERT_EQ(mesh.chunkCount(), 9);
+	ASSERT_EQ(mesh.totalRebuiltChunks(), 19);
+
+	// Far faces of the world belong to the last chunk
+	const AABB wall{{24, -32, -32}, {32, 32, 32}};
+	octree.fill(wall, 1);
+	mesh.invalidate(wall);
+	ASSERT_EQ(mesh.update(octree), 16);
+	mesh.forEachChunk([](const auto& chunk) {
+		ASSERT_FALSE(chunk.mesh.indices.empty());
+	});
+}
+
+TEST(ChunkedMesh, upload) {
+	Octree<int> octree(64);
+	ChunkedMesh<Octree<int>> mesh(64, 16);
+
+	std::pair<std::uint32_t, std::uint32_t> capacity{0, 0};
+	int resizes = 0;
+	std::vector<Vec3i> written;
+	const auto upload = [&] {
+		written.clear();
+		mesh.upload([&](std::uint32_t vertexCount, std::uint32_t indexCount) {
+			capacity = {vertexCount, indexCount};
+			resizes++;
+		}, [&](const auto& chunk) {
+			written.push_back(chunk.position);
+		});
+	};
+	const auto checkRanges = [&] {
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> vertices, indices;
+		mesh.forEachChunk([&](const auto& chunk) {
+			ASSERT_LE(chunk.mesh.vertices.size(), chunk.vertices.capacity);
+			ASSERT_LE(chunk.mesh.indices.size(), chunk.indices.capacity);
+			ASSERT_LE(chunk.vertices.offset + chunk.vertices.capacity, capacity.first);
+			ASSERT_LE(chunk.indices.offset + chunk.indices.capacity, capacity.second);
+			vertices.emplace_back(chunk.vertices.offset, chunk.vertices.offset + chunk.vertices.capacity);
+			indices.emplace_back(chunk.indices.offset, chunk.indices.offset + chunk.indices.capacity);
+		});
+		for (auto* ranges : {&vertices, &indices}) {
+			std::sort(ranges->begin(), ranges->end());
+			for (std::size_t i = 1; i < ranges->size(); i++) {
+				ASSERT_LE((*ranges)[i - 1].second, (*ranges)[i].first);
+			}
+		}
+	};
+
+	const AABB room{{-8, -8, -8}, {8, 8, 8}};
+	octree.fill(room, 1);
+	mesh.invalidate(room);
+	mesh.update(octree);
+	upload();
+	ASSERT_EQ(resizes, 1);
+	ASSERT_EQ(written.size(), 8);
+	checkRanges();
+
+	upload();
+	ASSERT_TRUE(written.empty());
+
+	// A new chunk is appended without moving the others
+	ASSERT_TRUE(octree.set({-29, -29, -29}, 2));
+	mesh.invalidate(AABB::fromNode({-29, -29, -29}, 1));
+	mesh.update(octree);
+	upload();
+	ASSERT_EQ(resizes, 1);
+	ASSERT_EQ(written.size(), 1);
+	ASSERT_EQ(written[0], (Vec3i{-32, -32, -32}));
+	checkRanges();
+
+	// Growing past the free space moves everything
+	const AABB floor{{-32, -32, -32}, {32, -24, 32}};
+	octree.fill(floor, 1);
+	octree.clear({{-24, -26, -24}, {24, -24, 24}});
+	mesh.invalidate(floor);
+	mesh.update(octree);
+	upload();
+	ASSERT_EQ(resizes, 2);
+	ASSERT_EQ(written.size(), mesh.chunkCount());
+	checkRanges();
+}
+
+TEST(ChunkedMesh, sameOnAnyThreadCount) {
+	Octree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	octree.fill({{-20, -4, -12}, {12, 16, 0}}, 2);
+	octree.clear({{-4, -28, -4}, {20, -4, 24}});
+	for (int i = -31; i < 32; i += 6) {
+		ASSERT_TRUE(octree.set({i, 17, -i}, 3 + (i & 1)));
+	}
+
+	const auto build = [&octree](unsigned threads) {
+		ThreadPool pool(threads);
+		ChunkedMesh<Octree<int>> mesh(64, 8);
+		mesh.invalidate({{-32, -32, -32}, {32, 32, 32}});
+		mesh.update(octree, &pool);
+		std::vector<std::pair<Vec3i, IndexedMesh>> chunks;
+		mesh.forEachChunk([&chunks](const auto& chunk) {
+			chunks.emplace_back(chunk.position, chunk.mesh);
+		});
+		return std::make_pair(chunks, mesh.materials());
+	};
+	const auto expected = build(1);
+	for (unsigned threads : {2u, 3u, 8u}) {
+		const auto [chunks, materials] = build(threads);
+		ASSERT_EQ(materials, expected.second);
+		ASSERT_EQ(chunks.size(), expected.first.size());
+		for (std::size_t i = 0; i < chunks.size(); i++) {
+			ASSERT_EQ(chunks[i].first, expected.first[i].first);
+			ASSERT_EQ(chunks[i].second.vertices, expected.first[i].second.vertices);
+			ASSERT_EQ(chunks[i].second.indices, expected.first[i].second.indices);
+		}
+	}
+}
+
+TEST(ChunkedMesh, cull) {
+	Octree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, -24, 32}}, 1);
+	octree.fill({{-20, -24, -20}, {-12, 0, -12}}, 2);
+	octree.fill({{12, -24, 12}, {20, 8, 20}}, 2);
+	ChunkedMesh<Octree<int>> mesh(64, 8);
+	mesh.invalidate({{-32, -32, -32}, {32, 32, 32}});
+	mesh.update(octree);
+
+	// Looking down -z from the middle of the world, 90 degrees wide and tall
+	std::array<float, 16> projection{};
+	projection[0] = 1.f;
+	projection[5] = 1.f;
+	projection[10] = -101.f / 99.f;
+	projection[11] = -1.f;
+	projection[14] = -200.f / 99.f;
+	const auto frustum = Frustum::fromMatrix(projection.data());
+
+	std::vector<ChunkedMesh<Octree<int>>::Draw> draws;
+	const auto stats = mesh.cull(frustum, Vec3f::zero(), 0.f, draws);
+	ASSERT_EQ(stats.drawnChunks, draws.size());
+	ASSERT_EQ(stats.drawnChunks + stats.culledChunks, mesh.chunkCount());
+	ASSERT_GT(stats.culledNodes, 0);
+	ASSERT_EQ(stats.lodTriangles, 0);
+
+	// Same chunks as testing every chunk on its own, minus the ones the conservative test keeps
+	std::size_t triangles = 0;
+	std::size_t visible = 0;
+	mesh.forEachChunk([&](const auto& chunk) {
+		const auto& position = chunk.position;
+		const bool inside = frustum.classify({position, {position.x + 8, position.y + 8, position.z + 8}}) != Frustum::Containment::OUTSIDE;
+		const bool drawn = std::any_of(draws.begin(), draws.end(), [&chunk](const auto& draw) {
+			return draw.firstIndex == chunk.indices.offset;
+		});
+		ASSERT_EQ(drawn, inside);
+		visible += inside;
+		triangles += chunk.lods[0].indexCount / 3;
+	});
+	ASSERT_EQ(visible, stats.drawnChunks);
+	ASSERT_EQ(stats.drawnTriangles + stats.culledTriangles, triangles);
+}
+
+TEST(ChunkedMesh, levelsOfDetail) {
+	Octree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, -24, 32}}, 1);
+	for (int x = -30; x < 32; x += 4) {
+		for (int z = -30; z < 32; z += 4) {
+			ASSERT_TRUE(octree.set({x + 1, -23, z + 1}, 2));
+		}
+	}
+	ChunkedMesh<Octree<int>> mesh(64, 16);
+	mesh.invalidate({{-32, -32, -32}, {32, 32, 32}});
+	mesh.update(octree);
+
+	// Every plane points outwards from the whole world
+	Frustum everything; // NOLINT(*-member-init)
+	for (int axis = 0; axis < 3; axis++) {
+		everything.planes[axis * 2] = {{axis == 0 ? 1.f : 0.f, axis == 1 ? 1.f : 0.f, axis == 2 ? 1.f : 0.f}, 1000.f};
+		everything.planes[axis * 2 + 1] = {{axis == 0 ? -1.f : 0.f, axis == 1 ? -1.f : 0.f, axis == 2 ? -1.f : 0.f}, 1000.f};
+	}
+	std::vector<ChunkedMesh<Octree<int>>::Draw> draws;
+	const auto full = mesh.cull(everything, Vec3f::zero(), 0.f, draws);
+	ASSERT_EQ(full.drawnChunks, mesh.chunkCount());
+	ASSERT_EQ(full.culledChunks, 0);
+	// The root is inside, so none of its children are tested
+	ASSERT_EQ(full.visitedNodes, 1);
+
+	// Bumps smaller than the coarse cells are merged away
+	const Vec3f eye{0.f, 200.f, 0.f};
+	const auto far = mesh.cull(everything, eye, 1.f, draws);
+	ASSERT_EQ(far.drawnChunks, full.drawnChunks);
+	ASSERT_EQ(far.drawnTriangles + far.lodTriangles, full.drawnTriangles);
+	ASSERT_LT(far.drawnTriangles * 4, full.drawnTriangles);
+	for (const auto& draw : draws) {
+		ASSERT_EQ(draw.lod, ChunkedMesh<Octree<int>>::LOD_LEVELS - 1);
+	}
+
+	// Nearby chunks keep their detail
+	const auto near = mesh.cull(everything, eye, 1000.f, draws);
+	ASSERT_EQ(near.lodTriangles, 0);
+	ASSERT_EQ(near.drawnTriangles, full.drawnTriangles);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <array>
+
+#include <editor/Frustum.h>
+
+namespace {
+
+/// Column-major perspective projection looking down -z from the origin, 90 degrees wide and tall
+std::array<float, 16> getProjection(float near, float far) {
+	std::array<float, 16> matrix{};
+	matrix[0] = 1.f;
+	matrix[5] = 1.f;
+	matrix[10] = -(far + near) / (far - near);
+	matrix[11] = -1.f;
+	matrix[14] = -2.f * far * near / (far - near);
+	return matrix;
+}
+
+} // namespace
+
+TEST(Frustum, classify) {
+	const auto projection = getProjection(1.f, 100.f);
+	const auto frustum = Frustum::fromMatrix(projection.data());
+
+	ASSERT_EQ(frustum.classify({{-2, -2, -12}, {2, 2, -8}}), Frustum::Containment::INSIDE);
+	// Behind the eye, past the far plane and off to the side
+	ASSERT_EQ(frustum.classify({{-2, -2, 4}, {2, 2, 8}}), Frustum::Containment::OUTSIDE);
+	ASSERT_EQ(frustum.classify({{-2, -2, -120}, {2, 2, -110}}), Frustum::Containment::OUTSIDE);
+	ASSERT_EQ(frustum.classify({{20, -2, -12}, {24, 2, -8}}), Frustum::Containment::OUTSIDE);
+	ASSERT_EQ(frustum.classify({{-2, 20, -12}, {2, 24, -8}}), Frustum::Containment::OUTSIDE);
+
+	// Across the near plane and across a side plane
+	ASSERT_EQ(frustum.classify({{-2, -2, -4}, {2, 2, 4}}), Frustum::Containment::INTERSECTS);
+	ASSERT_EQ(frustum.classify({{8, -2, -12}, {16, 2, -8}}), Frustum::Containment::INTERSECTS);
+	ASSERT_EQ(frustum.classify({{-200, -200, -200}, {200, 200, 200}}), Frustum::Containment::INTERSECTS);
+}
+
+TEST(Frustum, translated) {
+	// The same view with the eye moved to (100, 0, 0), as projection * view
+	auto matrix = getProjection(1.f, 100.f);
+	for (int row = 0; row < 4; row++) {
+		matrix[12 + row] += matrix[row] * -100.f;
+	}
+	const auto frustum = Frustum::fromMatrix(matrix.data());
+
+	ASSERT_EQ(frustum.classify({{98, -2, -12}, {102, 2, -8}}), Frustum::Containment::INSIDE);
+	ASSERT_EQ(frustum.classify({{-2, -2, -12}, {2, 2, -8}}), Frustum::Containment::OUTSIDE);
+}
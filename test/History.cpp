@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <editor/History.h>
+#include <editor/LinearOctree.h>
+#include <editor/Octree.h>
+
+TEST(History, undoRedo) {
+	Octree<int> octree(64);
+	History<Octree<int>> history(1024 * 1024);
+	history.reset(octree);
+	ASSERT_FALSE(history.canUndo());
+
+	ASSERT_TRUE(octree.set({1, 1, 1}, 1));
+	history.commit(octree);
+	octree.fill({{-8, -8, -8}, {0, 0, 0}}, 2);
+	history.commit(octree);
+	ASSERT_EQ(history.undoCount(), 2);
+
+	const auto* version = history.undo(octree);
+	ASSERT_NE(version, nullptr);
+	ASSERT_EQ(octree.get({-1, -1, -1})->data(), 0);
+	ASSERT_EQ(octree.get({1, 1, 1})->data(), 1);
+	int differences = 0;
+	octree.forEachDifference(*version, [&differences](const Octree<int>::Node&, Vec3i, int) {
+		differences++;
+	});
+	ASSERT_GT(differences, 0);
+
+	ASSERT_NE(history.undo(octree), nullptr);
+	ASSERT_EQ(octree.get({1, 1, 1})->data(), 0);
+	ASSERT_EQ(history.undo(octree), nullptr);
+
+	ASSERT_NE(history.redo(octree), nullptr);
+	ASSERT_EQ(octree.get({1, 1, 1})->data(), 1);
+	ASSERT_EQ(octree.get({-1, -1, -1})->data(), 0);
+
+	// A new edit drops what was undone
+	ASSERT_TRUE(octree.set({3, 3, 3}, 3));
+	history.commit(octree);
+	ASSERT_FALSE(history.canRedo());
+	ASSERT_EQ(history.undoCount(), 2);
+
+	history.clear(octree);
+	Octree<int> unversioned(64);
+	ASSERT_TRUE(unversioned.set({1, 1, 1}, 1));
+	ASSERT_TRUE(unversioned.set({3, 3, 3}, 3));
+	ASSERT_EQ(octree.nodeCount(), unversioned.nodeCount());
+}
+
+TEST(History, memoryBudget) {
+	Octree<int> octree(64);
+	History<Octree<int>> history(1024 * 1024);
+	history.reset(octree);
+	for (int i = 0; i < 16; i++) {
+		ASSERT_TRUE(octree.set({i * 2 - 15, 1, 1}, i + 1));
+		history.commit(octree);
+	}
+	ASSERT_EQ(history.undoCount(), 16);
+	ASSERT_GT(history.memoryUsage(), 0);
+
+	// Single voxel edits share all but the blocks on their path
+	ASSERT_LT(history.memoryUsage() / history.undoCount(), 8 * 6 * sizeof(Octree<int>::Node));
+
+	const auto budget = history.memoryUsage() / 2;
+	history.setMemoryBudget(octree, budget);
+	ASSERT_LE(history.memoryUsage(), budget);
+	ASSERT_LT(history.undoCount(), 16);
+	ASSERT_GT(history.undoCount(), 0);
+	while (history.undo(octree)) {}
+	ASSERT_EQ(octree.get({-15, 1, 1})->data(), 1);
+}
+
+TEST(History, linearOctree) {
+	LinearOctree<int> octree(64);
+	History<LinearOctree<int>> history(1024 * 1024);
+	history.reset(octree);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	history.commit(octree);
+	ASSERT_TRUE(octree.set({1, 1, 1}, 2));
+	history.commit(octree);
+
+	ASSERT_NE(history.undo(octree), nullptr);
+	ASSERT_EQ(octree.get({1, 1, 1})->data(), 0);
+	ASSERT_NE(history.undo(octree), nullptr);
+	ASSERT_EQ(octree.get({-1, -1, -1})->data(), 0);
+	ASSERT_NE(history.redo(octree), nullptr);
+	ASSERT_EQ(octree.get({-1, -1, -1})->data(), 1);
+}
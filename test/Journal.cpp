@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <tuple>
+#include <vector>
+
+#include <editor/ChamberFile.h>
+#include <editor/Journal.h>
+#include <editor/Octree.h>
+
+namespace {
+
+std::vector<std::tuple<int, int, int, int, int>> getLeaves(const Octree<int>& tree) {
+	std::vector<std::tuple<int, int, int, int, int>> leaves;
+	tree.forEachLeaf([&leaves](const Octree<int>::Node& node, Vec3i position, int halfSize) {
+		leaves.emplace_back(position.x, position.y, position.z, halfSize, node.data());
+	});
+	return leaves;
+}
+
+/// A chamber file with an empty journal, removed again at the end of the test
+struct JournalFile {
+	JournalFile()
+		: path(std::filesystem::temp_directory_path() / "puzzlemaker_ce_journal_test.pzce")
+		, tree(64) {
+		tree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+		EXPECT_TRUE(ChamberFile::save(tree, path));
+		EXPECT_TRUE(journal.rebase(Journal<int>::getPath(path), this->getBase(), 0));
+	}
+
+	~JournalFile() {
+		std::filesystem::remove(path);
+		std::filesystem::remove(Journal<int>::getPath(path));
+	}
+
+	[[nodiscard]] std::uint64_t getBase() const {
+		const auto base = ChamberFile::readChecksum(path);
+		EXPECT_TRUE(base.has_value());
+		return base.value_or(0);
+	}
+
+	void set(Vec3i position, int data) {
+		EXPECT_TRUE(tree.set(position, data));
+		journal.recordSet(position, data);
+	}
+
+	void fill(const AABB& box, int data) {
+		tree.fill(box, data);
+		journal.recordFill(box, data);
+	}
+
+	/// Load the chamber file and its journal as the editor would
+	[[nodiscard]] Octree<int> load(bool recover = false, std::size_t* applied = nullptr) const {
+		Octree<int> loaded(64);
+		EXPECT_TRUE(ChamberFile::load(loaded, path));
+		Journal<int> loadedJournal;
+		const auto count = loadedJournal.replay(loaded, path, this->getBase(), recover);
+		EXPECT_TRUE(loadedJournal.isOpen());
+		if (applied) {
+			*applied = count;
+		}
+		return loaded;
+	}
+
+	std::filesystem::path path;
+	Octree<int> tree;
+	Journal<int> journal;
+};
+
+} // namespace
+
+TEST(Journal, replay) {
+	JournalFile file;
+	const auto saved = getLeaves(file.tree);
+	file.set({1, 1, 1}, 2);
+	file.fill({{-8, 0, -8}, {8, 8, 8}}, 3);
+	file.fill({{-32, -32, -32}, {0, 0, 0}}, 0);
+	ASSERT_TRUE(file.journal.hasPending());
+
+	// Nothing reaches the chamber until the records are flushed
+	ASSERT_EQ(getLeaves(file.load()), saved);
+	ASSERT_TRUE(file.journal.flush(true));
+	ASSERT_FALSE(file.journal.hasPending());
+	ASSERT_EQ(file.journal.size(), std::filesystem::file_size(Journal<int>::getPath(file.path)));
+
+	std::size_t applied = 0;
+	ASSERT_EQ(getLeaves(file.load(false, &applied)), getLeaves(file.tree));
+	ASSERT_EQ(applied, 3);
+}
+
+TEST(Journal, closed) {
+	// Without a journal file the next save writes the chamber in full, edits are not buffered for it
+	Journal<int> journal;
+	journal.recordSet({1, 1, 1}, 2);
+	journal.recordFill({{-8, 0, -8}, {8, 8, 8}}, 3);
+	ASSERT_FALSE(journal.hasPending());
+	ASSERT_FALSE(journal.flush(true));
+}
+
+TEST(Journal, uncommitted) {
+	JournalFile file;
+	file.fill({{-8, 0, -8}, {8, 8, 8}}, 3);
+	ASSERT_TRUE(file.journal.flush(true));
+	const auto saved = getLeaves(file.tree);
+
+	file.set({1, 17, 1}, 4);
+	ASSERT_TRUE(file.journal.flush(false));
+	const auto flushedSize = file.journal.size();
+	file.set({3, 17, 1}, 5);
+	ASSERT_TRUE(file.journal.flush(false));
+
+	// Flushed edits only come back after a crash
+	ASSERT_EQ(getLeaves(file.load(true)), getLeaves(file.tree));
+	ASSERT_EQ(getLeaves(file.load()), saved);
+	// Loading normally threw them away for good
+	ASSERT_EQ(getLeaves(file.load(true)), saved);
+
+	// Closing without saving drops them too
+	file.set({5, 17, 1}, 6);
+	file.journal.discardUncommitted();
+	ASSERT_FALSE(file.journal.hasPending());
+	ASSERT_LT(file.journal.size(), flushedSize);
+	ASSERT_EQ(getLeaves(file.load(true)), saved);
+}
+
+TEST(Journal, damaged) {
+	JournalFile file;
+	file.set({1, 1, 1}, 2);
+	ASSERT_TRUE(file.journal.flush(true));
+	const auto intact = getLeaves(file.tree);
+	const auto intactSize = file.journal.size();
+	file.set({3, 1, 1}, 3);
+	ASSERT_TRUE(file.journal.flush(true));
+
+	// A record cut short by a crash is dropped along with everything after it. The last commit is 9 bytes long,
+	// so this cuts into the set before it
+	const auto journalPath = Journal<int>::getPath(file.path);
+	std::filesystem::resize_file(journalPath, file.journal.size() - 12);
+	std::size_t applied = 0;
+	ASSERT_EQ(getLeaves(file.load(true, &applied)), intact);
+	ASSERT_EQ(applied, 1);
+	ASSERT_EQ(std::filesystem::file_size(journalPath), intactSize);
+
+	// A journal written for another version of the chamber file does not apply
+	Octree<int> loaded(64);
+	ASSERT_TRUE(ChamberFile::load(loaded, file.path));
+	const auto saved = getLeaves(loaded);
+	Journal<int> other;
+	ASSERT_EQ(other.replay(loaded, file.path, file.getBase() + 1, true), 0);
+	ASSERT_EQ(getLeaves(loaded), saved);
+	ASSERT_EQ(std::filesystem::file_size(journalPath), Journal<int>::HEADER_SIZE);
+}
+
+TEST(Journal, rebase) {
+	JournalFile file;
+	file.set({1, 1, 1}, 2);
+	ASSERT_TRUE(file.journal.flush(true));
+
+	// Edits made while the snapshot is written are kept in the new journal
+	const auto snapshot = file.tree;
+	const auto offset = file.journal.snapshot();
+	file.set({3, 1, 1}, 3);
+	ASSERT_TRUE(file.journal.flush(true));
+	file.set({5, 1, 1}, 4);
+	ASSERT_TRUE(file.journal.flush(false));
+	file.set({7, 1, 1}, 5);
+
+	ASSERT_TRUE(ChamberFile::save(snapshot, file.path));
+	ASSERT_TRUE(file.journal.rebase(Journal<int>::getPath(file.path), file.getBase(), offset));
+	ASSERT_TRUE(file.journal.hasPending());
+	ASSERT_TRUE(file.journal.flush(true));
+	ASSERT_EQ(getLeaves(file.load()), getLeaves(file.tree));
+}
+
+TEST(Journal, rebaseClosed) {
+	// Like the first save of an untitled chamber, there is no journal file until the snapshot is written
+	JournalFile file;
+	file.journal.close();
+	file.set({1, 1, 1}, 2);
+	ASSERT_FALSE(file.journal.hasPending());
+
+	const auto snapshot = file.tree;
+	const auto offset = file.journal.snapshot();
+	file.set({3, 1, 1}, 3);
+	file.fill({{-8, 8, -8}, {8, 16, 8}}, 4);
+	ASSERT_TRUE(file.journal.hasPending());
+
+	ASSERT_TRUE(ChamberFile::save(snapshot, file.path));
+	ASSERT_TRUE(file.journal.rebase(Journal<int>::getPath(file.path), file.getBase(), offset));
+	ASSERT_TRUE(file.journal.flush(true));
+	ASSERT_EQ(getLeaves(file.load()), getLeaves(file.tree));
+
+	// A snapshot that is not rebased onto stops the buffering again
+	file.journal.close();
+	static_cast<void>(file.journal.snapshot());
+	file.set({5, 1, 1}, 5);
+	ASSERT_TRUE(file.journal.hasPending());
+	file.journal.abandonSnapshot();
+	ASSERT_FALSE(file.journal.hasPending());
+	file.set({7, 1, 1}, 6);
+	ASSERT_FALSE(file.journal.hasPending());
+}
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <editor/LinearOctree.h>
+
+TEST(LinearOctree, exists) {
+	LinearOctree<int> octree(16);
+
+	ASSERT_TRUE(octree.exists(Vec3i::zero()));
+	ASSERT_FALSE(octree.exists({0, 0, 1}));
+}
+
+TEST(LinearOctree, level3) {
+	LinearOctree<int> octree(16);
+
+	ASSERT_TRUE(octree.set(Vec3i::zero(), 42));
+	ASSERT_EQ(octree.get({0, 0, 0})->data(), 42);
+
+	ASSERT_FALSE(octree.set({4, 4, 6}, 42));
+	ASSERT_FALSE(octree.set({2, 4, 6}, 42));
+
+	ASSERT_TRUE(octree.set({1, 3, 5}, 7));
+	ASSERT_EQ(octree.get({1, 3, 5})->data(), 7);
+	ASSERT_EQ(octree.get({5, 5, 5})->data(), 42);
+	ASSERT_EQ(octree.get({0, 0, 1}), nullptr);
+}
+
+TEST(LinearOctree, forceMerge) {
+	LinearOctree<int> octree(16);
+
+	ASSERT_TRUE(octree.set({1, 3, 5}, 42));
+	ASSERT_EQ(octree.nodeCount(), 22);
+	ASSERT_FALSE(octree.set({4, 4, 4}, 7));
+	ASSERT_TRUE(octree.set({4, 4, 4}, 7, true));
+	ASSERT_EQ(octree.nodeCount(), 8);
+	ASSERT_EQ(octree.get({1, 3, 5})->data(), 7);
+	ASSERT_FALSE(octree.exists({1, 3, 5}));
+}
+
+TEST(LinearOctree, matchesOctree) {
+	Octree<int> octree(64);
+	LinearOctree<int> linear(64);
+
+	std::mt19937 random{1};
+	std::uniform_int_distribution<int> coordinate{-32, 32};
+	std::uniform_int_distribution<int> value{0, 3};
+	for (int i = 0; i < 2000; i++) {
+		const Vec3i position{coordinate(random), coordinate(random), coordinate(random)};
+		const auto data = value(random);
+		const bool forceMerge = i % 7 == 0;
+		ASSERT_EQ(octree.set(position, data, forceMerge), linear.set(position, data, forceMerge));
+	}
+	for (int i = 0; i < 2000; i++) {
+		const Vec3i position{coordinate(random), coordinate(random), coordinate(random)};
+		ASSERT_EQ(octree.exists(position), linear.exists(position));
+		const auto* node = octree.get(position);
+		const auto* leaf = linear.get(position);
+		ASSERT_EQ(node == nullptr, leaf == nullptr);
+		if (node) {
+			ASSERT_EQ(node->data(), leaf->data());
+		}
+	}
+
+	std::vector<std::pair<Vec3i, int>> octreeLeaves, linearLeaves;
+	octree.forEachLeaf([&](const Octree<int>::Node&, Vec3i position, int halfSize) {
+		octreeLeaves.emplace_back(position, halfSize);
+	});
+	linear.forEachLeaf([&](const LinearOctree<int>::Node&, Vec3i position, int halfSize) {
+		linearLeaves.emplace_back(position, halfSize);
+	});
+	ASSERT_EQ(octreeLeaves, linearLeaves);
+}
+
+TEST(LinearOctree, mergeOnSet) {
+	LinearOctree<int> octree(16);
+
+	ASSERT_TRUE(octree.set({1, 3, 5}, 42));
+	ASSERT_EQ(octree.nodeCount(), 22);
+	ASSERT_TRUE(octree.set({1, 3, 5}, 0));
+	ASSERT_EQ(octree.nodeCount(), 1);
+
+	for (int x : {2, 6}) {
+		for (int y : {2, 6}) {
+			for (int z : {2, 6}) {
+				ASSERT_TRUE(octree.set({x, y, z}, 42));
+			}
+		}
+	}
+	ASSERT_EQ(octree.nodeCount(), 8);
+	ASSERT_FALSE(octree.exists({2, 2, 2}));
+	ASSERT_EQ(octree.get({3, 3, 3})->data(), 42);
+
+	octree.simplify();
+	ASSERT_EQ(octree.nodeCount(), 8);
+}
+
+TEST(LinearOctree, fillMatchesOctree) {
+	Octree<int> octree(64);
+	LinearOctree<int> linear(64);
+
+	std::mt19937 random{2};
+	std::uniform_int_distribution<int> coordinate{-34, 34};
+	std::uniform_int_distribution<int> value{0, 3};
+	for (int i = 0; i < 200; i++) {
+		auto x = std::minmax(coordinate(random), coordinate(random));
+		auto y = std::minmax(coordinate(random), coordinate(random));
+		auto z = std::minmax(coordinate(random), coordinate(random));
+		const AABB box{{x.first, y.first, z.first}, {x.second, y.second, z.second}};
+		const auto data = value(random);
+		octree.fill(box, data);
+		linear.fill(box, data);
+
+		std::vector<std::tuple<Vec3i, int, int>> octreeLeaves, linearLeaves;
+		octree.forEachLeaf([&](const Octree<int>::Node& node, Vec3i position, int halfSize) {
+			octreeLeaves.emplace_back(position, halfSize, node.data());
+		});
+		linear.forEachLeaf([&](const LinearOctree<int>::Node& node, Vec3i position, int halfSize) {
+			linearLeaves.emplace_back(position, halfSize, node.data());
+		});
+		ASSERT_EQ(octreeLeaves, linearLeaves);
+	}
+}
+
+TEST(LinearOctree, forEachLeafInBox) {
+	Octree<int> octree(64);
+	LinearOctree<int> linear(64);
+
+	std::mt19937 random{3};
+	std::uniform_int_distribution<int> coordinate{-32, 32};
+	std::uniform_int_distribution<int> value{0, 3};
+	for (int i = 0; i < 2000; i++) {
+		const Vec3i position{coordinate(random), coordinate(random), coordinate(random)};
+		const auto data = value(random);
+		ASSERT_EQ(octree.set(position, data), linear.set(position, data));
+	}
+
+	for (int i = 0; i < 100; i++) {
+		const Vec3i a{coordinate(random), coordinate(random), coordinate(random)};
+		const Vec3i b{coordinate(random), coordinate(random), coordinate(random)};
+		const AABB box{{std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)}, {std::max(a.x, b.x) + 1, std::max(a.y, b.y) + 1, std::max(a.z, b.z) + 1}};
+
+		std::vector<std::pair<Vec3i, int>> expected, octreeLeaves, linearLeaves;
+		octree.forEachLeaf([&](const Octree<int>::Node&, Vec3i position, int halfSize) {
+			if (box.intersects(AABB::fromNode(position, halfSize))) {
+				expected.emplace_back(position, halfSize);
+			}
+		});
+		octree.forEachLeaf(box, [&](const Octree<int>::Node&, Vec3i position, int halfSize) {
+			octreeLeaves.emplace_back(position, halfSize);
+		});
+		linear.forEachLeaf(box, [&](const LinearOctree<int>::Node&, Vec3i position, int halfSize) {
+			linearLeaves.emplace_back(position, halfSize);
+		});
+		ASSERT_EQ(octreeLeaves, expected);
+		ASSERT_EQ(linearLeaves, expected);
+	}
+}
+
+TEST(LinearOctree, raycastMatchesOctree) {
+	Octree<int> octree(64);
+	LinearOctree<int> linear(64);
+
+	std::mt19937 random{5};
+	std::uniform_int_distribution<int> coordinate{-32, 32};
+	std::uniform_int_distribution<int> value{0, 3};
+	for (int i = 0; i < 300; i++) {
+		const Vec3i position{coordinate(random), coordinate(random), coordinate(random)};
+		const auto data = i % 3 ? 0 : value(random);
+		ASSERT_EQ(octree.set(position, data), linear.set(position, data));
+	}
+
+	std::uniform_real_distribution<float> origin{-40.f, 40.f};
+	std::uniform_real_distribution<float> direction{-1.f, 1.f};
+	std::vector<Ray> rays;
+	for (int i = 0; i < 2000; i++) {
+		rays.push_back({{origin(random), origin(random), origin(random)}, {direction(random), direction(random), i % 5 ? direction(random) : 0.f}, 60.f});
+	}
+	ThreadPool pool(4);
+	const auto octreeHits = octree.raycast(rays, &pool);
+	const auto linearHits = linear.raycast(rays);
+	for (std::size_t i = 0; i < rays.size(); i++) {
+		// The nearest solid leaf found by checking all of them
+		std::optional<float> expected;
+		octree.forEachLeaf([&](const Octree<int>::Node& node, Vec3i position, int halfSize) {
+			const auto span = rays[i].intersect(AABB::fromNode(position, halfSize));
+			if (node.data() && span.isHit() && span.exit >= 0.f && span.enter <= rays[i].maxDistance) {
+				const auto distance = std::max(span.enter, 0.f);
+				expected = std::min(expected.value_or(distance), distance);
+			}
+		});
+		ASSERT_EQ(octreeHits[i].has_value(), expected.has_value());
+		ASSERT_EQ(linearHits[i].has_value(), expected.has_value());
+		if (expected) {
+			ASSERT_FLOAT_EQ(octreeHits[i]->distance, *expected);
+			ASSERT_FLOAT_EQ(linearHits[i]->distance, *expected);
+			ASSERT_NE(octreeHits[i]->node->data(), 0);
+			ASSERT_EQ(octreeHits[i]->position, linearHits[i]->position);
+		}
+	}
+}
+
+TEST(LinearOctree, versions) {
+	LinearOctree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	const auto version = octree.saveVersion();
+	ASSERT_TRUE(octree.set({-5, 5, 5}, 3));
+	ASSERT_TRUE(octree.set({3, -3, 3}, 2));
+
+	std::vector<std::pair<Vec3i, int>> differences;
+	octree.forEachDifference(version, [&differences](const LinearOctree<int>::Node&, Vec3i position, int halfSize) {
+		differences.emplace_back(position, halfSize);
+	});
+	const std::vector<std::pair<Vec3i, int>> expected{{{-5, 5, 5}, 1}, {{3, -3, 3}, 1}};
+	ASSERT_EQ(differences, expected);
+
+	octree.restoreVersion(version);
+	ASSERT_EQ(octree.get({-5, 5, 5})->data(), 0);
+	ASSERT_EQ(octree.get({3, -3, 3})->data(), 1);
+	octree.releaseVersion(version);
+	ASSERT_EQ(octree.liveMemoryUsage(), octree.nodeCount() * sizeof(LinearOctree<int>::Node));
+}
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <editor/MaterialPalette.h>
+
+TEST(MaterialPalette, intern) {
+	MaterialPalette palette;
+	ASSERT_EQ(palette.intern(""), MaterialPalette::EMPTY);
+	ASSERT_EQ(palette.size(), 1);
+
+	const auto wall = palette.intern("dev/dev_measurewall01a");
+	const auto floor = palette.intern("dev/dev_measuregeneric01");
+	ASSERT_TRUE(wall && floor);
+	ASSERT_NE(*wall, *floor);
+	ASSERT_NE(*wall, MaterialPalette::EMPTY);
+	ASSERT_EQ(palette.intern(std::string{"dev/"} + "dev_measurewall01a"), wall);
+	ASSERT_EQ(palette.size(), 3);
+
+	ASSERT_EQ(palette.getName(*wall), "dev/dev_measurewall01a");
+	ASSERT_EQ(palette.getName(MaterialPalette::EMPTY), "");
+	ASSERT_EQ(palette.getName(42), "");
+}
+
+TEST(MaterialPalette, full) {
+	MaterialPalette palette;
+	for (std::size_t i = 1; i < MaterialPalette::MAX_SIZE; i++) {
+		ASSERT_TRUE(palette.intern(std::to_string(i)));
+	}
+	ASSERT_EQ(palette.size(), MaterialPalette::MAX_SIZE);
+	ASSERT_FALSE(palette.intern("one too many"));
+	// Names already in the palette are still found
+	ASSERT_EQ(palette.getName(*palette.intern("65535")), "65535");
+}
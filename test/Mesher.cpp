@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <tuple>
+
+#include <editor/BrickOctree.h>
+#include <editor/Mesher.h>
+#include <editor/Octree.h>
+
+namespace {
+
+using UnitFace = std::tuple<int, bool, int, int, int>;
+
+/// Every unit face between a solid and an empty cell, with the material of the solid side
+template<typename Tree>
+std::map<UnitFace, int> getBoundaryFaces(const Tree& octree) {
+	const auto isSolid = [&octree](Vec3i cell) {
+		const int half = octree.size() / 2;
+		if (cell.x < -half || cell.x >= half || cell.y < -half || cell.y >= half || cell.z < -half || cell.z >= half) {
+			return 0;
+		}
+		return octree.get({cell.x + 1, cell.y + 1, cell.z + 1})->data();
+	};
+	std::map<UnitFace, int> faces;
+	const int half = octree.size() / 2;
+	for (int x = -half; x < half; x += 2) {
+		for (int y = -half; y < half; y += 2) {
+			for (int z = -half; z < half; z += 2) {
+				const auto material = isSolid({x, y, z});
+				if (!material) {
+					continue;
+				}
+				for (int axis = 0; axis < 3; axis++) {
+					for (bool positive : {false, true}) {
+						const int offset = positive ? 2 : -2;
+						const Vec3i neighbor{x + (axis == 0) * offset, y + (axis == 1) * offset, z + (axis == 2) * offset};
+						if (isSolid(neighbor)) {
+							continue;
+						}
+						const Vec3i cell{x, y, z};
+						const int plane = Mesher::getComponent(cell, axis) + (positive ? 2 : 0);
+						faces[{axis, positive, plane, Mesher::getComponent(cell, (axis + 1) % 3), Mesher::getComponent(cell, (axis + 2) % 3)}] = material;
+					}
+				}
+			}
+		}
+	}
+	return faces;
+}
+
+/// Split every quad back into unit faces, failing if two quads overlap
+std::map<UnitFace, int> getMeshFaces(const QuadMesh<int>& mesh) {
+	std::map<UnitFace, int> faces;
+	for (const auto& quad : mesh.quads) {
+		for (int u = quad.min.x; u < quad.max.x; u += 2) {
+			for (int v = quad.min.y; v < quad.max.y; v += 2) {
+				EXPECT_TRUE(faces.emplace(UnitFace{quad.axis, quad.positive, quad.plane, u, v}, mesh.materials[quad.material]).second);
+			}
+		}
+	}
+	return faces;
+}
+
+} // namespace
+
+TEST(Mesher, singleVoxel) {
+	Octree<int> octree(16);
+	ASSERT_TRUE(octree.set({1, 3, 5}, 1));
+
+	const auto mesh = Mesher::mesh(octree);
+	ASSERT_EQ(mesh.quads.size(), 6);
+	ASSERT_EQ(getMeshFaces(mesh), getBoundaryFaces(octree));
+	using Vertex = std::pair<Vec3f, Vec2f>;
+	ASSERT_EQ(Mesher::triangulate<Vertex>(mesh.quads, 2.f).size(), 36);
+}
+
+TEST(Mesher, mergesMixedSizes) {
+	Octree<int> octree(16);
+	// One 4 unit node next to eight 2 unit voxels, all the same material
+	octree.fill({{-4, -4, -4}, {0, 0, 0}}, 1);
+	for (int y : {1, 3}) {
+		for (int z : {-3, -1}) {
+			ASSERT_TRUE(octree.set({1, y, z}, 1));
+			ASSERT_TRUE(octree.set({3, y, z}, 1));
+		}
+	}
+
+	const auto mesh = Mesher::mesh(octree);
+	ASSERT_EQ(mesh.quads.size(), 12);
+	ASSERT_EQ(getMeshFaces(mesh), getBoundaryFaces(octree));
+}
+
+TEST(Mesher, carvedRoom) {
+	Octree<int> octree(16);
+	octree.fill({{-8, -8, -8}, {8, 8, 8}}, 1);
+	octree.clear({{-6, -4, -2}, {4, 2, 6}});
+
+	const auto mesh = Mesher::mesh(octree);
+	// 6 outer walls and 6 inner walls
+	ASSERT_EQ(mesh.quads.size(), 12);
+	ASSERT_EQ(getMeshFaces(mesh), getBoundaryFaces(octree));
+}
+
+TEST(Mesher, watertight) {
+	Octree<int> octree(16);
+	octree.fill({{-8, -8, -8}, {8, 0, 8}}, 1);
+	octree.fill({{-6, -2, -6}, {2, 4, 0}}, 2);
+	octree.clear({{-2, -6, -2}, {6, -2, 4}});
+	octree.fill({{0, -4, 0}, {2, -2, 2}}, 3);
+	for (int i = -7; i < 8; i += 4) {
+		ASSERT_TRUE(octree.set({i, 5, -i}, 1 + (i & 1)));
+	}
+
+	const auto mesh = Mesher::mesh(octree);
+	ASSERT_EQ(mesh.materials.size(), 3);
+	ASSERT_EQ(getMeshFaces(mesh), getBoundaryFaces(octree));
+
+	// Triangles face out of the solid
+	using Vertex = std::pair<Vec3f, Vec2f>;
+	const auto vertices = Mesher::triangulate<Vertex>(mesh.quads, 2.f);
+	ASSERT_EQ(vertices.size(), mesh.quads.size() * 6);
+	for (std::size_t i = 0; i < vertices.size(); i += 3) {
+		const auto a = vertices[i + 1].first - vertices[i].first;
+		const auto b = vertices[i + 2].first - vertices[i].first;
+		const Vec3f normal{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+		const auto& quad = mesh.quads[i / 6];
+		const float facing = quad.axis == 0 ? normal.x : quad.axis == 1 ? normal.y : normal.z;
+		ASSERT_EQ(facing > 0, quad.positive);
+	}
+}
+
+TEST(Mesher, bricks) {
+	Octree<int> octree(32);
+	BrickOctree<int> bricks(32);
+	const auto fill = [&octree, &bricks](const AABB& box, int data) {
+		octree.fill(box, data);
+		bricks.fill(box, data);
+	};
+	fill({{-16, -16, -16}, {16, 0, 16}}, 1);
+	fill({{-6, -2, -6}, {2, 4, 0}}, 2);
+	fill({{-2, -6, -2}, {6, -2, 4}}, 0);
+	for (int i = -15; i < 16; i += 4) {
+		ASSERT_TRUE(octree.set({i, 1, -i}, 1 + (i & 1)));
+		ASSERT_TRUE(bricks.set({i, 1, -i}, 1 + (i & 1)));
+	}
+	ASSERT_GT(bricks.brickCount(), 0);
+
+	// Faces between voxels of a brick are culled before merging, the surface is the same
+	const auto mesh = Mesher::mesh(bricks);
+	ASSERT_EQ(getMeshFaces(mesh), getBoundaryFaces(bricks));
+	ASSERT_EQ(getMeshFaces(mesh), getMeshFaces(Mesher::mesh(octree)));
+}
+
+TEST(Mesher, regionsMatchWhole) {
+	Octree<int> octree(32);
+	octree.fill({{-16, -16, -16}, {16, 0, 16}}, 1);
+	octree.fill({{-10, -2, -6}, {6, 8, 0}}, 2);
+	octree.clear({{-2, -14, -2}, {10, -2, 12}});
+	for (int i = -15; i < 16; i += 6) {
+		ASSERT_TRUE(octree.set({i, 9, -i}, 1 + (i & 1)));
+	}
+
+	// Each region keeps its materials, so compare materials by value
+	QuadMesh<int> merged;
+	merged.materials = {0, 1, 2};
+	for (int x = -16; x < 16; x += 8) {
+		for (int y = -16; y < 16; y += 8) {
+			for (int z = -16; z < 16; z += 8) {
+				const auto mesh = Mesher::mesh(octree, {{x, y, z}, {x + 8, y + 8, z + 8}});
+				for (auto quad : mesh.quads) {
+					quad.material = mesh.materials[quad.material];
+					merged.quads.push_back(quad);
+				}
+			}
+		}
+	}
+	ASSERT_EQ(getMeshFaces(merged), getBoundaryFaces(octree));
+}
+
+TEST(Mesher, indexedMatchesTriangulate) {
+	Octree<int> octree(16);
+	octree.fill({{-8, -8, -8}, {8, 0, 8}}, 1);
+	octree.fill({{-6, -2, -6}, {2, 4, 0}}, 2);
+	octree.clear({{-2, -6, -2}, {6, -2, 4}});
+	for (int i = -7; i < 8; i += 4) {
+		ASSERT_TRUE(octree.set({i, 5, -i}, 1 + (i & 1)));
+	}
+
+	const auto mesh = Mesher::mesh(octree);
+	using Vertex = std::pair<Vec3f, Vec2f>;
+	const auto triangles = Mesher::triangulate<Vertex>(mesh.quads, 2.f);
+	const auto indexed = Mesher::index(mesh.quads);
+	ASSERT_EQ(indexed.indices.size(), triangles.size());
+	ASSERT_LT(indexed.vertices.size(), mesh.quads.size() * 4);
+	for (std::size_t i = 0; i < indexed.indices.size(); i++) {
+		ASSERT_LT(indexed.indices[i], indexed.vertices.size());
+		const auto& vertex = indexed.vertices[indexed.indices[i]];
+		const Vec3f position{static_cast<float>(vertex.x), static_cast<float>(vertex.y), static_cast<float>(vertex.z)};
+		ASSERT_EQ(position, triangles[i].first);
+
+		const auto& quad = mesh.quads[i / 6];
+		ASSERT_EQ(vertex.attributes & 0b111, quad.axis * 2 + quad.positive);
+		ASSERT_EQ(vertex.attributes >> 8, quad.material);
+	}
+}
+
+TEST(Mesher, coarseRegions) {
+	Octree<int> octree(32);
+	octree.fill({{-16, -16, -16}, {16, -2, 16}}, 1);
+	octree.fill({{-8, -4, -8}, {0, 8, 0}}, 2);
+	octree.clear({{-6, -14, -6}, {10, -6, 10}});
+	for (int i = -15; i < 16; i += 6) {
+		ASSERT_TRUE(octree.set({i, 9, -i}, 1));
+	}
+
+	// Every 4 unit node is solid when at least half of its cells are
+	Octree<int> coarse(32);
+	for (int x = -16; x < 16; x += 4) {
+		for (int y = -16; y < 16; y += 4) {
+			for (int z = -16; z < 16; z += 4) {
+				std::map<int, int> counts;
+				for (int i = 0; i < 8; i++) {
+					counts[octree.get({x + (i & 4 ? 3 : 1), y + (i & 2 ? 3 : 1), z + (i & 1 ? 3 : 1)})->data()]++;
+				}
+				if (counts[0] <= 4) {
+					coarse.fill({{x, y, z}, {x + 4, y + 4, z + 4}}, counts[1] >= counts[2] ? 1 : 2);
+				}
+			}
+		}
+	}
+
+	QuadMesh<int> merged;
+	merged.materials = {0, 1, 2};
+	for (int x = -16; x < 16; x += 8) {
+		for (int y = -16; y < 16; y += 8) {
+			for (int z = -16; z < 16; z += 8) {
+				const auto mesh = Mesher::mesh(octree, {{x, y, z}, {x + 8, y + 8, z + 8}}, 2);
+				for (auto quad : mesh.quads) {
+					ASSERT_EQ(quad.plane % 4, 0);
+					quad.material = mesh.materials[quad.material];
+					merged.quads.push_back(quad);
+				}
+			}
+		}
+	}
+	ASSERT_EQ(getMeshFaces(merged), getBoundaryFaces(coarse));
+}
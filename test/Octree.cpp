@@ -1,5 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 #include <editor/Octree.h>
 
 TEST(Octree, exists) {
@@ -38,3 +47,533 @@ TEST(Octree, level3) {
 	ASSERT_TRUE(octree.set({1, 3, 5}, 42));
 	ASSERT_EQ(octree.get({1, 3, 5})->data(), 42);
 }
+
+TEST(Octree, subdivideKeepsData) {
+	Octree<int> octree(16);
+
+	ASSERT_TRUE(octree.set(Vec3i::zero(), 42));
+	ASSERT_TRUE(octree.set({1, 3, 5}, 7));
+	ASSERT_EQ(octree.get({1, 3, 5})->data(), 7);
+	ASSERT_EQ(octree.get({-3, -3, -3})->data(), 42);
+	ASSERT_EQ(octree.get({5, 5, 5})->data(), 42);
+	ASSERT_EQ(octree.get({0, 0, 1}), nullptr);
+}
+
+TEST(Octree, forceMerge) {
+	Octree<int> octree(16);
+
+	ASSERT_TRUE(octree.set({1, 3, 5}, 42));
+	ASSERT_FALSE(octree.set({4, 4, 4}, 7));
+	ASSERT_TRUE(octree.set({4, 4, 4}, 7, true));
+	ASSERT_FALSE(octree.get({4, 4, 4})->hasChildren());
+	ASSERT_EQ(octree.get({1, 3, 5})->data(), 7);
+	ASSERT_FALSE(octree.exists({1, 3, 5}));
+}
+
+TEST(Octree, clear) {
+	Octree<int> octree(16);
+
+	ASSERT_TRUE(octree.set({1, 3, 5}, 42));
+	ASSERT_EQ(octree.nodeCount(), 25);
+
+	octree.clear();
+	ASSERT_EQ(octree.nodeCount(), 1);
+	ASSERT_FALSE(octree.root().hasChildren());
+	ASSERT_FALSE(octree.exists({4, 4, 4}));
+	ASSERT_EQ(octree.get({1, 3, 5})->data(), 0);
+}
+
+TEST(Octree, mergeOnSet) {
+	Octree<int> octree(16);
+
+	ASSERT_TRUE(octree.set({1, 3, 5}, 42));
+	ASSERT_EQ(octree.nodeCount(), 25);
+	ASSERT_TRUE(octree.set({1, 3, 5}, 0));
+	ASSERT_EQ(octree.nodeCount(), 1);
+
+	for (int x : {2, 6}) {
+		for (int y : {2, 6}) {
+			for (int z : {2, 6}) {
+				ASSERT_TRUE(octree.set({x, y, z}, 42));
+			}
+		}
+	}
+	ASSERT_EQ(octree.nodeCount(), 9);
+	ASSERT_FALSE(octree.exists({2, 2, 2}));
+	ASSERT_EQ(octree.get({-4, -4, -4})->data(), 0);
+	ASSERT_EQ(octree.get({3, 3, 3})->data(), 42);
+
+	octree.simplify();
+	ASSERT_EQ(octree.nodeCount(), 9);
+}
+
+TEST(Octree, fill) {
+	Octree<int> octree(16);
+
+	octree.fill({{-8, -8, -8}, {0, 8, 8}}, 42);
+	ASSERT_EQ(octree.nodeCount(), 9);
+	ASSERT_EQ(octree.get({-1, 7, 1})->data(), 42);
+	ASSERT_EQ(octree.get({1, 7, 1})->data(), 0);
+
+	octree.clear({{-8, -8, -8}, {0, 8, 8}});
+	ASSERT_EQ(octree.nodeCount(), 1);
+
+	const AABB box{{-3, -1, 0}, {5, 1, 2}};
+	octree.fill(box, 7);
+	for (int x = -7; x < 8; x += 2) {
+		for (int y = -7; y < 8; y += 2) {
+			for (int z = -7; z < 8; z += 2) {
+				ASSERT_EQ(octree.get({x, y, z})->data(), box.contains({x, y, z}) ? 7 : 0);
+			}
+		}
+	}
+}
+
+TEST(Octree, fillMatchesSet) {
+	Octree<int> filled(64);
+	Octree<int> set(64);
+
+	std::mt19937 random{1};
+	std::uniform_int_distribution<int> coordinate{-32, 32};
+	std::uniform_int_distribution<int> value{0, 3};
+	for (int i = 0; i < 50; i++) {
+		auto x = std::minmax(coordinate(random), coordinate(random));
+		auto y = std::minmax(coordinate(random), coordinate(random));
+		auto z = std::minmax(coordinate(random), coordinate(random));
+		const AABB box{{x.first, y.first, z.first}, {x.second, y.second, z.second}};
+		const auto data = value(random);
+
+		filled.fill(box, data);
+		for (int px = -31; px < 32; px += 2) {
+			for (int py = -31; py < 32; py += 2) {
+				for (int pz = -31; pz < 32; pz += 2) {
+					if (box.contains({px, py, pz})) {
+						ASSERT_TRUE(set.set({px, py, pz}, data));
+					}
+				}
+			}
+		}
+	}
+	std::vector<std::tuple<Vec3i, int, int>> filledLeaves, setLeaves;
+	filled.forEachLeaf([&](const Octree<int>::Node& node, Vec3i position, int halfSize) {
+		filledLeaves.emplace_back(position, halfSize, node.data());
+	});
+	set.forEachLeaf([&](const Octree<int>::Node& node, Vec3i position, int halfSize) {
+		setLeaves.emplace_back(position, halfSize, node.data());
+	});
+	ASSERT_EQ(filledLeaves, setLeaves);
+	ASSERT_EQ(filled.nodeCount(), set.nodeCount());
+}
+
+TEST(Octree, raycast) {
+	Octree<int> octree(32);
+	octree.fill({{-16, -16, -16}, {16, -8, 16}}, 1);
+	octree.fill({{4, -8, -4}, {8, 0, 4}}, 2);
+
+	// Straight down onto the floor, across the large empty nodes above it
+	auto hit = octree.raycast({-11.f, 15.f, 3.f}, {0.f, -1.f, 0.f}, 100.f);
+	ASSERT_TRUE(hit);
+	ASSERT_EQ(hit->node->data(), 1);
+	ASSERT_FLOAT_EQ(hit->distance, 23.f);
+	ASSERT_EQ(hit->normal, (Vec3i{0, 1, 0}));
+
+	// Sideways into the pillar
+	hit = octree.raycast({-15.f, -3.f, 1.f}, {1.f, 0.f, 0.f}, 100.f);
+	ASSERT_TRUE(hit);
+	ASSERT_EQ(hit->node->data(), 2);
+	ASSERT_FLOAT_EQ(hit->distance, 19.f);
+	ASSERT_EQ(hit->normal, (Vec3i{-1, 0, 0}));
+
+	// Too short, and past the pillar
+	ASSERT_FALSE(octree.raycast({-15.f, -3.f, 1.f}, {1.f, 0.f, 0.f}, 18.f));
+	ASSERT_FALSE(octree.raycast({9.f, -3.f, 1.f}, {1.f, 0.f, 0.f}, 100.f));
+
+	// From outside the world
+	hit = octree.raycast({40.f, -12.f, 0.f}, {-1.f, 0.f, 0.f}, 100.f);
+	ASSERT_TRUE(hit);
+	ASSERT_FLOAT_EQ(hit->distance, 24.f);
+	ASSERT_EQ(hit->normal, (Vec3i{1, 0, 0}));
+
+	// Starting inside a solid leaf
+	hit = octree.raycast({0.f, -12.f, 0.f}, {0.f, 1.f, 0.f}, 100.f);
+	ASSERT_TRUE(hit);
+	ASSERT_FLOAT_EQ(hit->distance, 0.f);
+	ASSERT_EQ(hit->normal, Vec3i::zero());
+}
+
+TEST(Octree, copy) {
+	Octree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	ASSERT_TRUE(octree.set({3, 3, 3}, 2));
+
+	const Octree<int> copy = octree;
+	ASSERT_EQ(copy.nodeCount(), octree.nodeCount());
+
+	// Edits after the copy stay out of it
+	octree.clear({{-32, -32, -32}, {32, 32, 32}});
+	ASSERT_TRUE(octree.set({5, 5, 5}, 3));
+	ASSERT_EQ(copy.get({3, 3, 3})->data(), 2);
+	ASSERT_EQ(copy.get({-5, -5, -5})->data(), 1);
+	ASSERT_EQ(copy.get({5, 5, 5})->data(), 0);
+}
+
+TEST(Octree, versions) {
+	Octree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	ASSERT_TRUE(octree.set({3, 3, 3}, 2));
+	const auto nodeCount = octree.nodeCount();
+	const auto version = octree.saveVersion();
+
+	// Only the blocks on the path to the edit are copied
+	ASSERT_TRUE(octree.set({-5, 5, 5}, 3));
+	const auto editedNodeCount = octree.nodeCount();
+	ASSERT_LT(editedNodeCount - nodeCount, 8 * 6);
+	ASSERT_EQ(octree.get({3, 3, 3})->data(), 2);
+
+	int differences = 0;
+	octree.forEachDifference(version, [&differences](const Octree<int>::Node&, Vec3i position, int halfSize) {
+		ASSERT_TRUE(AABB::fromNode(position, halfSize).contains({-5, 5, 5}));
+		differences++;
+	});
+	ASSERT_GT(differences, 0);
+
+	const auto edited = octree.saveVersion();
+	octree.restoreVersion(version);
+	ASSERT_EQ(octree.get({-5, 5, 5})->data(), 0);
+	ASSERT_EQ(octree.get({3, 3, 3})->data(), 2);
+	octree.restoreVersion(edited);
+	ASSERT_EQ(octree.get({-5, 5, 5})->data(), 3);
+
+	// Once nothing uses them, the copied blocks are freed
+	octree.releaseVersion(edited);
+	octree.releaseVersion(version);
+	Octree<int> unversioned(64);
+	unversioned.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	ASSERT_TRUE(unversioned.set({3, 3, 3}, 2));
+	ASSERT_TRUE(unversioned.set({-5, 5, 5}, 3));
+	ASSERT_LT(octree.nodeCount(), editedNodeCount);
+	ASSERT_EQ(octree.nodeCount(), unversioned.nodeCount());
+	octree.fill({{-32, -32, -32}, {32, 32, 32}}, 0);
+	ASSERT_EQ(octree.nodeCount(), 1);
+}
+
+TEST(Octree, leaves) {
+	Octree<int> octree(64);
+	ASSERT_EQ(std::distance(octree.leaves().begin(), octree.leaves().end()), 1);
+
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	ASSERT_TRUE(octree.set({1, 1, 1}, 2));
+	ASSERT_TRUE(octree.set({-7, 9, 3}, 3));
+
+	// The same leaves in the same order as a walk down from the root
+	std::vector<std::tuple<int, int, int, int, int>> visited;
+	octree.visit([&visited](const Octree<int>::Node& node, Vec3i position, int halfSize, int) {
+		if (!node.hasChildren()) {
+			visited.emplace_back(position.x, position.y, position.z, halfSize, node.data());
+		}
+		return true;
+	});
+	std::vector<std::tuple<int, int, int, int, int>> iterated;
+	for (const auto& [node, position, halfSize] : octree.leaves()) {
+		ASSERT_FALSE(node.hasChildren());
+		iterated.emplace_back(position.x, position.y, position.z, halfSize, node.data());
+	}
+	ASSERT_EQ(iterated, visited);
+	ASSERT_GT(iterated.size(), 8);
+}
+
+TEST(Octree, visit) {
+	Octree<int> octree(64);
+	ASSERT_TRUE(octree.set({1, 1, 1}, 2));
+
+	// Splitting a unit voxel off the root takes 5 levels of 8 children
+	int nodes = 0;
+	octree.visit([&nodes](const Octree<int>::Node&, Vec3i, int, int) {
+		nodes++;
+		return true;
+	});
+	ASSERT_EQ(nodes, 1 + 8 * 5);
+
+	int shallow = 0;
+	octree.visit([&shallow](const Octree<int>::Node&, Vec3i, int, int depth) {
+		EXPECT_LE(depth, 2);
+		shallow++;
+		return true;
+	}, 2);
+	ASSERT_EQ(shallow, 1 + 8 * 2);
+
+	// Children of a node the visitor returns false for are skipped
+	int pruned = 0;
+	octree.visit([&pruned](const Octree<int>::Node&, Vec3i position, int halfSize, int) {
+		pruned++;
+		return halfSize > 1 && AABB::fromNode(position, halfSize).contains({1, 1, 1});
+	});
+	ASSERT_EQ(pruned, 1 + 8 * 5);
+	pruned = 0;
+	octree.visit([&pruned](const Octree<int>::Node&, Vec3i position, int, int) {
+		pruned++;
+		return position == Vec3i::zero();
+	});
+	ASSERT_EQ(pruned, 1 + 8);
+}
+
+TEST(Octree, neighbor) {
+	Octree<int> octree(64);
+	ASSERT_TRUE(octree.set({1, 1, 1}, 2));
+
+	// A node of the same size
+	const auto same = octree.getNeighbor({3, 1, 1}, 1, 0, false);
+	ASSERT_TRUE(same.has_value());
+	ASSERT_EQ(same->position, Vec3i(1, 1, 1));
+	ASSERT_EQ(same->halfSize, 1);
+	ASSERT_EQ(same->node.data(), 2);
+
+	// A larger leaf
+	const auto larger = octree.getNeighbor({1, 1, 1}, 1, 0, false);
+	ASSERT_TRUE(larger.has_value());
+	ASSERT_EQ(larger->position, Vec3i(-16, 16, 16));
+	ASSERT_EQ(larger->halfSize, 16);
+	ASSERT_FALSE(larger->node.hasChildren());
+
+	// A split node as large as the one it neighbors
+	const auto split = octree.getNeighbor({16, -16, 16}, 16, 1, true);
+	ASSERT_TRUE(split.has_value());
+	ASSERT_EQ(split->position, Vec3i(16, 16, 16));
+	ASSERT_EQ(split->halfSize, 16);
+	ASSERT_TRUE(split->node.hasChildren());
+
+	// Nothing past the edge
+	ASSERT_FALSE(octree.getNeighbor({31, 1, 1}, 1, 0, true).has_value());
+	ASSERT_FALSE(octree.getNeighbor({16, 16, -16}, 16, 2, false).has_value());
+	ASSERT_FALSE(octree.getNeighbor(Vec3i::zero(), 32, 1, true).has_value());
+}
+
+TEST(Octree, occupancy) {
+	// Compared against probing every unit voxel, after edits that split, merge, copy and restore nodes
+	const auto countSolid = [](const Octree<int>& octree, const AABB& box) {
+		std::uint64_t count = 0;
+		for (int x = -31; x < 32; x += 2) {
+			for (int y = -31; y < 32; y += 2) {
+				for (int z = -31; z < 32; z += 2) {
+					if (box.contains({x, y, z}) && octree.get({x, y, z})->data() != 0) {
+						count++;
+					}
+				}
+			}
+		}
+		return count;
+	};
+	const std::vector<AABB> boxes{
+		{{-32, -32, -32}, {32, 32, 32}},
+		{{-32, -32, -32}, {32, 0, 32}},
+		{{-7, -3, 2}, {12, 19, 5}},
+		{{0, 0, 0}, {1, 1, 1}},
+		{{-30, 5, -9}, {-29, 31, 30}},
+	};
+
+	Octree<int> octree(64);
+	ASSERT_EQ(octree.occupancy(boxes[0]), 0);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	ASSERT_EQ(octree.occupancy(boxes[0]), 32 * 16 * 32);
+
+	std::mt19937 random{7};
+	std::uniform_int_distribution<int> coordinate{-16, 15};
+	std::uniform_int_distribution<int> value{0, 2};
+	for (int i = 0; i < 40; i++) {
+		const Vec3i min{coordinate(random), coordinate(random), coordinate(random)};
+		octree.fill({min, {min.x + 9, min.y + 5, min.z + 13}}, value(random));
+		static_cast<void>(octree.set({coordinate(random) * 2 + 1, coordinate(random) * 2 + 1, coordinate(random) * 2 + 1}, value(random)));
+	}
+	for (const auto& box : boxes) {
+		ASSERT_EQ(octree.occupancy(box), countSolid(octree, box));
+	}
+
+	const auto version = octree.saveVersion();
+	const auto saved = octree.occupancy(boxes[0]);
+	const Octree<int> copy = octree;
+	octree.clear({{-32, -32, -32}, {0, 32, 32}});
+	ASSERT_TRUE(octree.set({1, 1, 1}, 2));
+	for (const auto& box : boxes) {
+		ASSERT_EQ(octree.occupancy(box), countSolid(octree, box));
+	}
+	ASSERT_EQ(copy.occupancy(boxes[0]), saved);
+	octree.restoreVersion(version);
+	ASSERT_EQ(octree.occupancy(boxes[0]), saved);
+	octree.releaseVersion(version);
+}
+
+TEST(Octree, leavesInBox) {
+	Octree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	ASSERT_TRUE(octree.set({1, 1, 1}, 2));
+	ASSERT_TRUE(octree.set({-7, 9, 3}, 3));
+
+	// Every leaf sharing volume with the box, and no other
+	const AABB box{{-8, -2, 0}, {4, 12, 4}};
+	std::vector<std::tuple<int, int, int, int>> expected;
+	octree.forEachLeaf([&box, &expected](const Octree<int>::Node&, Vec3i position, int halfSize) {
+		if (box.intersects(AABB::fromNode(position, halfSize))) {
+			expected.emplace_back(position.x, position.y, position.z, halfSize);
+		}
+	});
+	std::vector<std::tuple<int, int, int, int>> found;
+	octree.forEachLeaf(box, [&found](const Octree<int>::Node&, Vec3i position, int halfSize) {
+		found.emplace_back(position.x, position.y, position.z, halfSize);
+	});
+	ASSERT_EQ(found, expected);
+}
+
+TEST(Octree, batch) {
+	Octree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	ASSERT_TRUE(octree.set({1, 1, 1}, 2));
+	ASSERT_TRUE(octree.set({-7, 9, 3}, 3));
+	octree.fill({{-20, 4, -12}, {-4, 20, 8}}, 4);
+
+	// Node centers, unit voxels, positions on node surfaces and outside the octree, in a count that
+	// leaves the last batch partly empty
+	std::vector<Vec3i> positions{{0, 0, 0}, {16, 16, 16}, {-8, 8, 8}, {1, 1, 1}, {2, 2, 2}, {32, 0, 0}, {-40, 1, 1}};
+	std::mt19937 random{3};
+	std::uniform_int_distribution<int> coordinate{-33, 33};
+	while (positions.size() < 1000) {
+		positions.push_back({coordinate(random), coordinate(random), coordinate(random)});
+	}
+
+	std::vector<const Octree<int>::Node*> nodes(positions.size());
+	octree.getBatch(positions, nodes);
+	const auto exists = std::make_unique<bool[]>(positions.size());
+	octree.existsBatch(positions, {exists.get(), positions.size()});
+	for (std::size_t i = 0; i < positions.size(); i++) {
+		ASSERT_EQ(nodes[i], octree.get(positions[i])) << i;
+		ASSERT_EQ(exists[i], octree.exists(positions[i])) << i;
+	}
+}
+
+TEST(Octree, fixedDepth) {
+	Octree<int> octree(64);
+	Octree<int, 6> fixed(64);
+	ASSERT_EQ(fixed.size(), 64);
+
+	// Positions that are node centers at every level, unit voxels, on node surfaces and outside the octree
+	std::vector<Vec3i> positions{{0, 0, 0}, {16, 16, 16}, {-8, 8, 8}, {1, 1, 1}, {2, 2, 2}, {2, 4, 2}, {32, 0, 0}, {-40, 1, 1}, {31, 31, -31}};
+	std::mt19937 random{4};
+	std::uniform_int_distribution<int> coordinate{-33, 33};
+	std::uniform_int_distribution<int> value{0, 2};
+	while (positions.size() < 4000) {
+		positions.push_back({coordinate(random), coordinate(random), coordinate(random)});
+	}
+
+	const auto compare = [&octree, &fixed, &positions] {
+		for (std::size_t i = 0; i < positions.size(); i++) {
+			const auto* node = octree.get(positions[i]);
+			const auto* fixedNode = fixed.get(positions[i]);
+			ASSERT_EQ(node == nullptr, fixedNode == nullptr) << i;
+			if (node) {
+				ASSERT_EQ(node->data(), fixedNode->data()) << i;
+			}
+			ASSERT_EQ(octree.exists(positions[i]), fixed.exists(positions[i])) << i;
+		}
+		ASSERT_EQ(octree.nodeCount(), fixed.nodeCount());
+		ASSERT_EQ(octree.occupancy({{-32, -32, -32}, {32, 32, 32}}), fixed.occupancy({{-32, -32, -32}, {32, 32, 32}}));
+	};
+
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	fixed.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	compare();
+	for (std::size_t i = 0; i < positions.size(); i++) {
+		const auto data = value(random);
+		const auto forceMerge = i % 3 == 0;
+		ASSERT_EQ(octree.set(positions[i], data, forceMerge), fixed.set(positions[i], data, forceMerge)) << i;
+	}
+	compare();
+}
+
+TEST(Octree, snapshots) {
+	Octree<int> octree(64);
+	octree.fill({{-32, -32, -32}, {32, 0, 32}}, 1);
+	// Nothing is published yet
+	ASSERT_EQ(octree.snapshot()->get({-5, -5, -5})->data(), 0);
+	octree.publish();
+	{
+		const auto snapshot = octree.snapshot();
+		octree.clear({{-32, -32, -32}, {32, 32, 32}});
+		ASSERT_TRUE(octree.set({3, 3, 3}, 2));
+		octree.publish();
+
+		// The pinned snapshot keeps the nodes it was published with, a new one sees the edits
+		ASSERT_EQ(snapshot->get({-5, -5, -5})->data(), 1);
+		ASSERT_EQ(snapshot->get({3, 3, 3})->data(), 0);
+		ASSERT_EQ(octree.snapshot()->get({3, 3, 3})->data(), 2);
+		ASSERT_EQ(octree.snapshot()->get({-5, -5, -5})->data(), 0);
+		ASSERT_GT(octree.nodeCount(), Octree<int>(octree).nodeCount());
+	}
+
+	// Once it is gone, the blocks only it reached are reused
+	octree.publish();
+	ASSERT_EQ(octree.nodeCount(), Octree<int>(octree).nodeCount());
+}
+
+TEST(Octree, concurrentSnapshots) {
+	// Every round fills both boxes with its number, readers must never see them disagree or go back
+	constexpr int ROUNDS = 2000;
+	constexpr int READERS = 4;
+	const AABB first{{-32, -32, -32}, {-8, -8, -8}};
+	const AABB second{{8, 8, 8}, {20, 32, 32}};
+	Octree<int> octree(64);
+	octree.publish();
+
+	std::atomic<bool> done = false;
+	std::atomic<int> failures = 0;
+	std::atomic<int> reads = 0;
+	std::vector<std::thread> readers;
+	for (int i = 0; i < READERS; i++) {
+		readers.emplace_back([&] {
+			int lastRound = 0;
+			while (!done.load()) {
+				const auto snapshot = octree.snapshot();
+				const auto round = snapshot->get({-31, -31, -31})->data();
+				std::uint64_t volume = 0;
+				for (const auto& [node, position, halfSize] : snapshot->leaves()) {
+					volume += static_cast<std::uint64_t>(halfSize) * halfSize * halfSize * 8;
+				}
+				const std::uint64_t solid = round > 0 ? 1 : 0;
+				if (round < lastRound || snapshot->get({19, 31, 9})->data() != round || volume != 64 * 64 * 64 ||
+				    snapshot->occupancy(first) != solid * 12 * 12 * 12 || snapshot->occupancy(second) != solid * 6 * 12 * 12) {
+					failures++;
+				}
+				lastRound = round;
+				reads++;
+			}
+		});
+	}
+
+	std::mt19937 random{5};
+	std::uniform_int_distribution<int> coordinate{-32, 31};
+	for (int round = 1; round <= ROUNDS; round++) {
+		if (round % 64 == 0) {
+			octree.clear();
+		}
+		// Scattered edits, half of them undone, between the publishes
+		const auto version = octree.saveVersion();
+		for (int i = 0; i < 16; i++) {
+			std::ignore = octree.set({coordinate(random) * 2 + 1, coordinate(random) * 2 + 1, coordinate(random) * 2 + 1}, -round);
+		}
+		if (round % 2 == 0) {
+			octree.restoreVersion(version);
+		}
+		octree.releaseVersion(version);
+		octree.fill(first, round);
+		octree.fill(second, round);
+		octree.publish();
+	}
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	ASSERT_EQ(failures.load(), 0);
+	ASSERT_GT(reads.load(), 0);
+
+	// Nothing is left retired once every reader is gone
+	octree.publish();
+	ASSERT_EQ(octree.nodeCount(), Octree<int>(octree).nodeCount());
+}
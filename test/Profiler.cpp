@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <editor/Profiler.h>
+
+TEST(Profiler, zones) {
+	Profiler profiler;
+	{
+		const Profiler::Zone outer("outer", profiler);
+		const Profiler::Zone inner("inner", profiler);
+	}
+	const auto events = profiler.collect();
+	ASSERT_EQ(events.size(), 2);
+	ASSERT_STREQ(events[0].name, "outer");
+	ASSERT_STREQ(events[1].name, "inner");
+	ASSERT_EQ(events[0].thread, events[1].thread);
+	// The inner zone is closed first and lies within the outer one
+	ASSERT_LE(events[0].start, events[1].start);
+	ASSERT_GE(events[0].start + events[0].duration, events[1].start + events[1].duration);
+
+	profiler.clear();
+	ASSERT_TRUE(profiler.collect().empty());
+}
+
+TEST(Profiler, threads) {
+	Profiler profiler;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; i++) {
+		threads.emplace_back([&profiler] {
+			for (int j = 0; j < 100; j++) {
+				const Profiler::Zone zone("work", profiler);
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	const auto events = profiler.collect();
+	ASSERT_EQ(events.size(), 400);
+	for (std::size_t i = 1; i < events.size(); i++) {
+		ASSERT_LE(events[i - 1].start, events[i].start);
+	}
+}
+
+TEST(Profiler, ring) {
+	Profiler profiler;
+	for (std::size_t i = 0; i < Profiler::RING_SIZE + 10; i++) {
+		profiler.record(i < 10 ? "old" : "new", static_cast<std::int64_t>(i), 1);
+	}
+	// Only the newest zones are kept
+	const auto events = profiler.collect();
+	ASSERT_EQ(events.size(), Profiler::RING_SIZE);
+	ASSERT_STREQ(events.front().name, "new");
+	ASSERT_EQ(events.front().start, 10);
+}
+
+TEST(Profiler, chromeTrace) {
+	Profiler profiler;
+	profiler.record("ChunkedMesh::update", 1500, 2000250);
+	profiler.record("a \"quoted\" zone", 3000000, 10);
+	std::ostringstream stream;
+	ASSERT_TRUE(profiler.writeChromeTrace(stream));
+	const auto trace = stream.str();
+	ASSERT_NE(trace.find(R"({"name":"ChunkedMesh::update","ph":"X","pid":1,"tid":1,"ts":1.500,"dur":2000.250})"), std::string::npos);
+	ASSERT_NE(trace.find(R"("name":"a \"quoted\" zone")"), std::string::npos);
+	ASSERT_EQ(trace.rfind("{\"traceEvents\":[", 0), 0);
+}
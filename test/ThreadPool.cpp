@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include <editor/ThreadPool.h>
+
+TEST(ThreadPool, runsEveryIndexOnce) {
+	for (unsigned threads : {1u, 2u, 8u}) {
+		ThreadPool pool(threads);
+		ASSERT_EQ(pool.threadCount(), threads);
+		for (std::size_t count : {0u, 1u, 7u, 1000u}) {
+			std::vector<std::atomic<int>> calls(count);
+			pool.parallelFor(count, [&calls](std::size_t i) {
+				calls[i]++;
+			});
+			for (const auto& call : calls) {
+				ASSERT_EQ(call.load(), 1);
+			}
+		}
+	}
+}
+
+TEST(ThreadPool, reusable) {
+	ThreadPool pool(4);
+	std::atomic<std::size_t> sum = 0;
+	for (int round = 0; round < 100; round++) {
+		pool.parallelFor(64, [&sum](std::size_t i) {
+			sum += i;
+		});
+	}
+	ASSERT_EQ(sum.load(), 100 * (63 * 64 / 2));
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <editor/Octree.h>
+#include <editor/VmfFile.h>
+
+template<>
+struct VmfMaterial<int> {
+	[[nodiscard]] static std::string_view get(int data) {
+		return data == 1 ? "dev/dev_measuregeneric01" : "dev/dev_measurewall01a";
+	}
+};
+
+namespace {
+
+/// The data of the only brush covering the unit voxel, 0 if none does and -1 if several do
+int getBrushData(const std::vector<VmfFile::Brush<int>>& brushes, Vec3i position) {
+	int data = 0;
+	for (const auto& brush : brushes) {
+		if (brush.box.contains(position)) {
+			if (data) {
+				return -1;
+			}
+			data = brush.data;
+		}
+	}
+	return data;
+}
+
+std::size_t countOccurrences(const std::string& text, std::string_view pattern) {
+	std::size_t count = 0;
+	for (auto i = text.find(pattern); i != std::string::npos; i = text.find(pattern, i + 1)) {
+		count++;
+	}
+	return count;
+}
+
+} // namespace
+
+TEST(VmfFile, mergeBox) {
+	Octree<int> octree(64);
+	// Off the node grid, so the box is made of leaves of several sizes
+	octree.fill({{-30, -4, -18}, {22, 10, 26}}, 1);
+	const auto solids = VmfFile::getSolids(octree);
+	ASSERT_GT(solids.size(), 1);
+
+	const auto brushes = VmfFile::getBrushes(solids);
+	ASSERT_EQ(brushes.size(), 1);
+	ASSERT_EQ(brushes[0].box.min, Vec3i(-30, -4, -18));
+	ASSERT_EQ(brushes[0].box.max, Vec3i(22, 10, 26));
+	ASSERT_EQ(brushes[0].data, 1);
+
+	// Materials are never merged together
+	octree.fill({{-30, -4, -18}, {22, 10, 0}}, 2);
+	ASSERT_EQ(VmfFile::getBrushes(VmfFile::getSolids(octree)).size(), 2);
+}
+
+TEST(VmfFile, brushesMatchVoxels) {
+	Octree<int> octree(32);
+	octree.fill({{-16, -16, -16}, {16, 0, 16}}, 1);
+	std::mt19937 random{6};
+	std::uniform_int_distribution<int> coordinate{-8, 7};
+	std::uniform_int_distribution<int> value{0, 2};
+	for (int i = 0; i < 600; i++) {
+		std::ignore = octree.set({coordinate(random) * 2 + 1, coordinate(random) * 2 + 1, coordinate(random) * 2 + 1}, value(random));
+	}
+	const auto solids = VmfFile::getSolids(octree);
+	const auto brushes = VmfFile::getBrushes(solids);
+	ASSERT_LT(brushes.size(), solids.size());
+
+	// Every unit voxel is in exactly one brush of its data if solid, and in none if empty
+	for (int x = -15; x < 16; x += 2) {
+		for (int y = -15; y < 16; y += 2) {
+			for (int z = -15; z < 16; z += 2) {
+				ASSERT_EQ(getBrushData(brushes, {x, y, z}), octree.get({x, y, z})->data()) << x << ' ' << y << ' ' << z;
+			}
+		}
+	}
+}
+
+TEST(VmfFile, write) {
+	const std::vector<VmfFile::Brush<int>> brushes{
+		{{{-64, 0, -32}, {64, 128, 32}}, 1},
+		{{{64, 0, -32}, {96, 16, 0}}, 2},
+	};
+	std::ostringstream stream;
+	ASSERT_TRUE(VmfFile::write(brushes, stream));
+	const auto vmf = stream.str();
+	ASSERT_EQ(countOccurrences(vmf, "\tsolid\n"), 2);
+	ASSERT_EQ(countOccurrences(vmf, "\t\tside\n"), 12);
+	ASSERT_EQ(countOccurrences(vmf, "\"material\" \"dev/dev_measuregeneric01\""), 6);
+	ASSERT_EQ(countOccurrences(vmf, "\"material\" \"dev/dev_measurewall01a\""), 6);
+
+	// Chamber y is map z, the top of the first brush is clockwise seen from above
+	ASSERT_NE(vmf.find("\"plane\" \"(-64 -32 128) (-64 32 128) (64 -32 128)\""), std::string::npos);
+	ASSERT_NE(vmf.find("\"plane\" \"(-64 -32 0) (64 -32 0) (-64 32 0)\""), std::string::npos);
+
+	// Every side points away from the middle of its brush
+	const auto box = VmfFile::toMap(brushes[0].box);
+	for (int axis = 0; axis < 3; axis++) {
+		for (const bool positive : {false, true}) {
+			const auto [p1, p2, p3] = VmfFile::getSidePoints(box, axis, positive);
+			const Vec3i a{p3.x - p1.x, p3.y - p1.y, p3.z - p1.z};
+			const Vec3i b{p2.x - p1.x, p2.y - p1.y, p2.z - p1.z};
+			const Vec3i normal{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+			const auto component = axis == 0 ? normal.x : axis == 1 ? normal.y : normal.z;
+			ASSERT_EQ(component > 0, positive) << axis;
+			ASSERT_EQ(normal.x * (axis != 0) + normal.y * (axis != 1) + normal.z * (axis != 2), 0) << axis;
+		}
+	}
+}
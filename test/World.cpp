@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <memory>
+
+#include <editor/World.h>
+
+TEST(World, unchangedSet) {
+	const auto path = std::filesystem::temp_directory_path() / "puzzlemaker_ce_world_test.pzce";
+	World world;
+	ASSERT_TRUE(world.save(path));
+	ASSERT_TRUE(world.load(path));
+	ASSERT_TRUE(world.getJournal().isOpen());
+	world.update();
+
+	// Empty space is already empty
+	ASSERT_TRUE(world.set({64, 64, 64}, {}));
+	ASSERT_FALSE(world.getHistory().canUndo());
+	ASSERT_FALSE(world.getJournal().hasPending());
+	ASSERT_EQ(world.update(), 0);
+
+	const auto data = VoxelData::fromTexture("dev/dev_measuregeneric01b");
+	ASSERT_TRUE(data);
+	ASSERT_TRUE(world.set({64, 64, 64}, *data));
+	ASSERT_EQ(world.getHistory().undoCount(), 1);
+	ASSERT_TRUE(world.getJournal().flush(true));
+	ASSERT_GT(world.update(), 0);
+	const auto journalSize = world.getJournal().size();
+
+	ASSERT_TRUE(world.set({64, 64, 64}, *data));
+	ASSERT_EQ(world.getHistory().undoCount(), 1);
+	ASSERT_FALSE(world.getJournal().hasPending());
+	ASSERT_TRUE(world.getJournal().flush(true));
+	ASSERT_EQ(world.getJournal().size(), journalSize);
+	ASSERT_EQ(world.update(), 0);
+
+	std::filesystem::remove(path);
+	std::filesystem::remove(Journal<VoxelData>::getPath(path));
+}
+
+TEST(World, chamberSnapshot) {
+	auto world = std::make_shared<World>();
+	const auto data = VoxelData::fromTexture("dev/dev_measurewall01a");
+	ASSERT_TRUE(data);
+	world->fill({{0, 0, 0}, {256, 128, 256}}, *data);
+	const auto snapshot = World::getChamberSnapshot(world);
+
+	// Later edits don't show in it, and it stays valid once the world is dropped
+	world->clear({{0, 0, 0}, {128, 128, 128}});
+	ASSERT_TRUE(world->set({64, 192, 64}, *data));
+	world.reset();
+	ASSERT_EQ(snapshot->get({33, 33, 33})->data(), *data);
+	ASSERT_EQ(snapshot->get({65, 193, 65})->data(), VoxelData{});
+}